@@ -0,0 +1,131 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * 在Linux上运行固件的rotctld服务和目标邮箱，电机任务用固定耗时代替
+ * RMT发送，用于配合rotctld_loadgen测量服务器吞吐和延迟
+ *
+ * 用法: rotctld_host [-m move_ms] [-s stats_s]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "tcp_server.h"
+#include "setpoint.h"
+#include "latency_stats.h"
+
+#define TAG "rotctld_host"
+
+unsigned char LedStatus = NOTCONNECTED;
+TaskHandle_t tcp_server_handler;
+
+static volatile sig_atomic_t stop = 0;
+static int move_ms = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+// 模拟电机任务，流程与rotator_controller一致，规划和提交各计一次时间戳
+static void sim_rotator_task(void *pvParameters)
+{
+    rot_setpoint_t sp;
+
+    setpoint_bind_consumer();
+    while (1)
+    {
+        if (!setpoint_take(&sp, portMAX_DELAY))
+        {
+            continue;
+        }
+        int64_t take_us = esp_timer_get_time();
+        if ((take_us - sp.time_us) / 1000 > SETPOINT_MAX_AGE_MS)
+        {
+            continue;
+        }
+        int64_t plan_us = esp_timer_get_time();
+        int64_t submit_us = esp_timer_get_time();
+        latency_record(&sp, take_us, plan_us, submit_us);
+        // 移动期间到达的目标合并为最新的一个
+        if (move_ms > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(move_ms));
+        }
+    }
+}
+
+static void print_stats(void)
+{
+    setpoint_stats_t st;
+    setpoint_get_stats(&st);
+    printf("setpoints: posted %u, taken %u, overwritten %u\n",
+           (unsigned)st.posted, (unsigned)st.taken, (unsigned)st.overwritten);
+    latency_stats_print();
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int stats_s = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                move_ms = atoi(optarg);
+                break;
+            case 's':
+                stats_s = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-m move_ms] [-s stats_s]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    xTaskCreatePinnedToCore(sim_rotator_task, "rotator_controller", 4096, NULL, 5, NULL, 1);
+    xTaskCreatePinnedToCore(tcp_server_task, "tcp_server", 4096, NULL, 5, &tcp_server_handler, 0);
+    ESP_LOGI(TAG, "rotctld on port %d, %d clients, move %d ms", PORT, ROTCTLD_MAX_CLIENTS, move_ms);
+
+    int64_t last = esp_timer_get_time();
+    while (!stop)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        if (stats_s > 0 && esp_timer_get_time() - last >= (int64_t)stats_s * 1000000)
+        {
+            last = esp_timer_get_time();
+            print_stats();
+        }
+    }
+    print_stats();
+    return 0;
+}
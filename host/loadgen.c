@@ -0,0 +1,440 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * rotctld负载发生器，每个客户端一个线程，按扩展应答模式(+)发送命令，
+ * 读到RPRT行即为一次完整的回复
+ *
+ * 用法: rotctld_loadgen [-h host] [-p port] [-c clients] [-d seconds] [-r rate] [-t trace]
+ *   -r  每个客户端每秒的命令数，0表示收到回复后立即发送下一条
+ *   -t  命令轨迹文件，每行"<offset_ms> <command>"或"<command>"，按偏移时间重放，
+ *       重放完后从头循环；不指定时交替发送P和p
+ *
+ * 输出命令吞吐、回复延迟分位数，以及没有得到RPRT 0的设置命令（丢失的目标）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define LOADGEN_REPLY_TIMEOUT_MS    2000
+#define LOADGEN_CMD_LEN             128
+#define LOADGEN_MAX_TRACE           65536
+
+typedef struct
+{
+    int64_t offset_us;          // 相对本轮开始的发送时刻，-1表示按速率发送
+    char cmd[LOADGEN_CMD_LEN];
+} trace_entry_t;
+
+typedef struct
+{
+    int id;
+    pthread_t thread;
+    bool connected;
+    uint64_t sent;
+    uint64_t replies;
+    uint64_t errors;            // RPRT非0
+    uint64_t timeouts;
+    uint64_t set_sent;
+    uint64_t set_dropped;       // 设置命令没有得到RPRT 0
+    uint32_t *lat_us;           // 每条命令的回复延迟
+    size_t lat_len;
+    size_t lat_cap;
+} client_t;
+
+static const char *host = "127.0.0.1";
+static const char *port = "4533";
+static int duration_s = 5;
+static double rate = 0;
+static trace_entry_t *trace;
+static size_t trace_len;
+static int64_t start_us;
+static int64_t stop_us;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until(int64_t t_us)
+{
+    int64_t d = t_us - now_us();
+    if (d > 0)
+    {
+        struct timespec ts = { .tv_sec = d / 1000000, .tv_nsec = (d % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int load_trace(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[LOADGEN_CMD_LEN + 32];
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    trace = calloc(LOADGEN_MAX_TRACE, sizeof(trace_entry_t));
+    while (trace_len < LOADGEN_MAX_TRACE && fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *p = line;
+        line[strcspn(line, "\r\n")] = '\0';
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        if (*p == '\0' || *p == '#')
+        {
+            continue;
+        }
+        trace_entry_t *e = &trace[trace_len++];
+        e->offset_us = -1;
+        if (isdigit((unsigned char)*p))
+        {
+            char *end;
+            double ms = strtod(p, &end);
+            if (isspace((unsigned char)*end))
+            {
+                e->offset_us = (int64_t)(ms * 1000);
+                p = end;
+                while (isspace((unsigned char)*p))
+                {
+                    p++;
+                }
+            }
+        }
+        snprintf(e->cmd, sizeof(e->cmd), "%.*s", LOADGEN_CMD_LEN - 1, p);
+    }
+    fclose(fp);
+    if (trace_len == 0)
+    {
+        fprintf(stderr, "%s: no commands\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// 会投递目标的命令，回复不是RPRT 0即视为目标丢失
+static bool is_set_command(const char *cmd)
+{
+    if (strchr("+;|,", *cmd) != NULL)
+    {
+        cmd++;
+    }
+    if (*cmd == '\\')
+    {
+        cmd++;
+        return strncmp(cmd, "set_pos", 7) == 0 || strncmp(cmd, "park", 4) == 0 ||
+               strncmp(cmd, "stop", 4) == 0 || strncmp(cmd, "move", 4) == 0 ||
+               ((cmd[0] == 'P' || cmd[0] == 'K' || cmd[0] == 'S' || cmd[0] == 'M') &&
+                (cmd[1] == '\0' || cmd[1] == ' '));
+    }
+    return *cmd == 'P' || *cmd == 'K' || *cmd == 'S' || *cmd == 'M';
+}
+
+static int client_connect(void)
+{
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    int sock = -1;
+
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+    {
+        return -1;
+    }
+    for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next)
+    {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0)
+        {
+            continue;
+        }
+        if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            break;
+        }
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock >= 0)
+    {
+        int opt = 1;
+        struct timeval tv = { .tv_sec = LOADGEN_REPLY_TIMEOUT_MS / 1000,
+                              .tv_usec = (LOADGEN_REPLY_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return sock;
+}
+
+/**
+ * @brief   读到RPRT行为止
+ * @return  RPRT的返回码，超时或连接断开时返回INT32_MIN
+ */
+static int read_reply(int sock)
+{
+    char buf[512];
+    size_t len = 0;
+
+    while (1)
+    {
+        ssize_t n = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0)
+        {
+            return INT32_MIN;
+        }
+        len += n;
+        buf[len] = '\0';
+        char *line = buf;
+        char *nl;
+        while ((nl = strchr(line, '\n')) != NULL)
+        {
+            if (strncmp(line, "RPRT ", 5) == 0)
+            {
+                return atoi(line + 5);
+            }
+            line = nl + 1;
+        }
+        // 保留不完整的行
+        len = strlen(line);
+        memmove(buf, line, len);
+        if (len >= sizeof(buf) - 1)
+        {
+            len = 0;
+        }
+    }
+}
+
+static void record_latency(client_t *c, uint32_t us)
+{
+    if (c->lat_len == c->lat_cap)
+    {
+        c->lat_cap = c->lat_cap ? c->lat_cap * 2 : 4096;
+        c->lat_us = realloc(c->lat_us, c->lat_cap * sizeof(uint32_t));
+    }
+    c->lat_us[c->lat_len++] = us;
+}
+
+// 合成命令：各客户端错开方位角，每步变化0.5度以免被服务器当作重复目标忽略，每4条插入一次查询
+static void synth_command(client_t *c, uint64_t n, char *cmd, size_t size)
+{
+    if (n % 4 == 3)
+    {
+        snprintf(cmd, size, "p");
+        return;
+    }
+    double az = (c->id * 37 + n * 0.5);
+    az -= 360.0 * (int)(az / 360.0);
+    snprintf(cmd, size, "P %.2f %.2f", az, (double)((c->id + n) % 90));
+}
+
+static void *client_thread(void *arg)
+{
+    client_t *c = arg;
+    char cmd[LOADGEN_CMD_LEN];
+    char out[LOADGEN_CMD_LEN + 2];
+    int64_t period_us = rate > 0 ? (int64_t)(1000000 / rate) : 0;
+    int64_t next_us = now_us();
+    int64_t round_us = start_us;
+    size_t trace_pos = 0;
+
+    int sock = client_connect();
+    if (sock < 0)
+    {
+        return NULL;
+    }
+    c->connected = true;
+
+    while (now_us() < stop_us)
+    {
+        if (trace != NULL)
+        {
+            const trace_entry_t *e = &trace[trace_pos];
+            snprintf(cmd, sizeof(cmd), "%s", e->cmd);
+            if (e->offset_us >= 0)
+            {
+                sleep_until(round_us + e->offset_us);
+                if (now_us() >= stop_us)
+                {
+                    break;
+                }
+            }
+            if (++trace_pos == trace_len)
+            {
+                trace_pos = 0;
+                round_us = now_us();
+            }
+        }
+        else
+        {
+            synth_command(c, c->sent, cmd, sizeof(cmd));
+        }
+        if (period_us > 0)
+        {
+            sleep_until(next_us);
+            next_us += period_us;
+        }
+
+        bool set = is_set_command(cmd);
+        int len = snprintf(out, sizeof(out), strchr("+;|,", cmd[0]) ? "%s\n" : "+%s\n", cmd);
+        int64_t t0 = now_us();
+        if (send(sock, out, len, MSG_NOSIGNAL) != len)
+        {
+            break;
+        }
+        c->sent++;
+        c->set_sent += set;
+        int ret = read_reply(sock);
+        if (ret == INT32_MIN)
+        {
+            // 超时或被服务器断开，本条及以后的命令都不再有回复
+            c->timeouts++;
+            c->set_dropped += set;
+            break;
+        }
+        record_latency(c, (uint32_t)(now_us() - t0));
+        c->replies++;
+        if (ret != 0)
+        {
+            c->errors++;
+            c->set_dropped += set;
+        }
+    }
+    close(sock);
+    return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-h host] [-p port] [-c clients] [-d seconds] [-r rate] [-t trace]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int nclients = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:c:d:r:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                host = optarg;
+                break;
+            case 'p':
+                port = optarg;
+                break;
+            case 'c':
+                nclients = atoi(optarg);
+                break;
+            case 'd':
+                duration_s = atoi(optarg);
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 't':
+                if (load_trace(optarg) != 0)
+                {
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (nclients <= 0 || duration_s <= 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    client_t *clients = calloc(nclients, sizeof(client_t));
+    start_us = now_us();
+    stop_us = start_us + (int64_t)duration_s * 1000000;
+    for (int i = 0; i < nclients; i++)
+    {
+        clients[i].id = i;
+        pthread_create(&clients[i].thread, NULL, client_thread, &clients[i]);
+    }
+
+    client_t total = { 0 };
+    int connected = 0;
+    for (int i = 0; i < nclients; i++)
+    {
+        client_t *c = &clients[i];
+        pthread_join(c->thread, NULL);
+        connected += c->connected;
+        total.sent += c->sent;
+        total.replies += c->replies;
+        total.errors += c->errors;
+        total.timeouts += c->timeouts;
+        total.set_sent += c->set_sent;
+        total.set_dropped += c->set_dropped;
+        for (size_t j = 0; j < c->lat_len; j++)
+        {
+            record_latency(&total, c->lat_us[j]);
+        }
+        free(c->lat_us);
+    }
+    double elapsed = (now_us() - start_us) / 1e6;
+    qsort(total.lat_us, total.lat_len, sizeof(uint32_t), cmp_u32);
+
+#define PCT(p) (total.lat_len ? total.lat_us[(size_t)((total.lat_len - 1) * (p) / 100)] : 0)
+    printf("clients:    %d connected, %d refused\n", connected, nclients - connected);
+    printf("commands:   %llu sent, %llu replied in %.2f s, %.1f cmds/s\n",
+           (unsigned long long)total.sent, (unsigned long long)total.replies, elapsed, total.replies / elapsed);
+    printf("latency:    p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+           PCT(50), PCT(90), PCT(99), total.lat_len ? total.lat_us[total.lat_len - 1] : 0);
+    printf("errors:     %llu RPRT errors, %llu timeouts\n",
+           (unsigned long long)total.errors, (unsigned long long)total.timeouts);
+    printf("setpoints:  %llu sent, %llu dropped\n",
+           (unsigned long long)total.set_sent, (unsigned long long)total.set_dropped);
+#undef PCT
+
+    free(total.lat_us);
+    free(clients);
+    free(trace);
+    return (connected == nclients && total.replies > 0 && total.set_dropped == 0) ? 0 : 2;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// CLOCK_MONOTONIC，微秒
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,3 @@
+#pragma once
+
+#define configTICK_RATE_HZ      1000
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+// 每个任务对应一个分离的线程，通知计数用互斥锁和条件变量实现
+struct host_task
+{
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+};
+
+static pthread_key_t task_key;
+static pthread_once_t task_key_once = PTHREAD_ONCE_INIT;
+
+static void task_key_init(void)
+{
+    pthread_key_create(&task_key, NULL);
+}
+
+static struct host_task *task_new(void)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&task->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return task;
+}
+
+static void *task_entry(void *arg)
+{
+    struct host_task *task = arg;
+    pthread_setspecific(task_key, task);
+    task->fn(task->arg);
+    return NULL;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)name; (void)stack; (void)prio; (void)core;
+    pthread_once(&task_key_once, task_key_init);
+    struct host_task *task = task_new();
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+// 只支持删除自身，任务结构保留，其他线程可能还持有句柄
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == xTaskGetCurrentTaskHandle())
+    {
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { .tv_sec = ticks / configTICK_RATE_HZ,
+                           .tv_nsec = (long)(ticks % configTICK_RATE_HZ) * (1000000000L / configTICK_RATE_HZ) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+// 不是由xTaskCreatePinnedToCore创建的线程（如main）第一次调用时补建任务结构
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    pthread_once(&task_key_once, task_key_init);
+    struct host_task *task = pthread_getspecific(task_key);
+    if (task == NULL)
+    {
+        task = task_new();
+        task->thread = pthread_self();
+        pthread_setspecific(task_key, task);
+    }
+    return task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (wait != portMAX_DELAY)
+    {
+        int64_t ns = deadline.tv_nsec + (int64_t)wait * (1000000000LL / configTICK_RATE_HZ);
+        deadline.tv_sec += ns / 1000000000LL;
+        deadline.tv_nsec = ns % 1000000000LL;
+    }
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notify == 0 && wait != 0)
+    {
+        if (wait == portMAX_DELAY)
+        {
+            pthread_cond_wait(&task->cond, &task->lock);
+        }
+        else if (pthread_cond_timedwait(&task->cond, &task->lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    uint32_t value = task->notify;
+    if (value != 0)
+    {
+        task->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// lwIP的BSD socket接口在主机上直接对应POSIX socket
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define inet_ntoa_r(addr, buf, len)     inet_ntop(AF_INET, &(addr), buf, len)
+#define inet6_ntoa_r(addr, buf, len)    inet_ntop(AF_INET6, &(addr), buf, len)
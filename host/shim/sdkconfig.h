@@ -0,0 +1,10 @@
+#pragma once
+
+// 主机构建使用的配置，与固件的sdkconfig保持一致
+#define CONFIG_EXAMPLE_IPV4                 1
+#ifndef CONFIG_EXAMPLE_PORT
+#define CONFIG_EXAMPLE_PORT                 4533    // 可在cmake中用-DROTCTLD_PORT覆盖
+#endif
+#define CONFIG_EXAMPLE_KEEPALIVE_IDLE       5
+#define CONFIG_EXAMPLE_KEEPALIVE_INTERVAL   5
+#define CONFIG_EXAMPLE_KEEPALIVE_COUNT      3
@@ -0,0 +1,35 @@
+#!/bin/sh
+# 启动rotctld_host，分别用合成命令和轨迹文件压测，检查没有丢失的目标，
+# 且电机任务取走的目标计入了各阶段的延迟统计
+# 用法: smoke_test.sh <rotctld_host> <rotctld_loadgen> <port> <trace>
+set -e
+server=$1
+loadgen=$2
+port=$3
+trace=$4
+
+stats=$(mktemp)
+"$server" -m 5 >"$stats" &
+pid=$!
+trap 'kill $pid 2>/dev/null; rm -f "$stats"' EXIT
+
+# 等待端口开始监听
+i=0
+while ! "$loadgen" -p "$port" -c 1 -d 1 -r 1 >/dev/null 2>&1; do
+    i=$((i + 1))
+    [ $i -lt 20 ] || { echo "rotctld_host did not start"; exit 1; }
+    sleep 0.2
+done
+
+"$loadgen" -p "$port" -c 16 -d 2
+"$loadgen" -p "$port" -c 4 -d 2 -t "$trace"
+
+kill -INT $pid
+wait $pid
+cat "$stats"
+for stage in parse post handoff plan submit total; do
+    awk -v s=$stage '$1 == s && $2 > 0 { found = 1 } END { exit !found }' "$stats" ||
+        { echo "no latency samples for stage $stage"; exit 1; }
+done
+rm -f "$stats"
+trap - EXIT
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARENA_ALIGN             8
+#define ARENA_DEFAULT_BLOCK     4096
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    uint8_t data[];
+} arena_block_t;
+
+/**
+ * 区域分配器：从大块内存中顺序切分，不支持单独释放，用完后整体复位或释放。
+ * 适合一次操作过程中产生的大量小对象（哈希表节点、字符串等），
+ * 复位后保留已申请的块，重复执行同样的操作不再访问堆
+ */
+typedef struct
+{
+    arena_block_t *first;
+    arena_block_t *current;     // 正在切分的块，之后的块在复位后等待复用
+    size_t block_size;
+    size_t total;               // 已向堆申请的字节数
+} arena_t;
+
+void arena_init(arena_t *arena, size_t block_size);
+
+/**
+ * @brief   分配size字节（按ARENA_ALIGN对齐），失败返回NULL
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+void *arena_calloc(arena_t *arena, size_t size);
+
+char *arena_strdup(arena_t *arena, const char *str);
+
+/**
+ * @brief   O(1)复位，之前分配的对象全部失效，块保留给后续分配
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief   把全部块还给堆
+ */
+void arena_release(arena_t *arena);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+#define ASSETS_PARTITION_LABEL  "assets"
+#define ASSETS_MAGIC            0x53414e54      // "TNAS"
+#define ASSETS_VERSION          1
+#define ASSETS_NAME_LEN         24
+
+// 资源分区中的条目名，由mkassets.py打包
+#define ASSET_CATALOG           "tle_eph.txt"       // 出厂TLE目录
+#define ASSET_TRSP_DB           "transponders.db"   // 与TRSP_DB_PATH相同格式的转发器数据库
+
+/*
+ * 分区布局：header | entries[count] | 数据（每项按16字节对齐）
+ * 整个镜像通过esp_partition_mmap映射到数据地址空间，条目直接返回flash中的指针
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t total_size;        // 镜像大小，映射时只映射这部分
+} assets_header_t;
+
+typedef struct __attribute__((packed))
+{
+    char name[ASSETS_NAME_LEN];
+    uint32_t offset;            // 相对镜像起始
+    uint32_t size;
+} assets_entry_t;
+
+/**
+ * @brief   映射资源分区，分区不存在或内容无效时返回错误，其余接口都返回未找到
+ */
+esp_err_t assets_init(void);
+
+/**
+ * @brief   查找资源，返回映射后的只读指针，不复制也不占用堆
+ */
+const void *assets_find(const char *name, size_t *size);
+
+/**
+ * @brief   将LVGL二进制图片（lv_img_header_t + 像素数据）包装成图片描述符，像素数据留在flash中
+ */
+bool assets_image(const char *name, lv_img_dsc_t *dsc);
+
+/**
+ * @brief   以只读FILE打开资源，供按文件解析的代码（Input_Tle_Set等）使用
+ */
+FILE *assets_fopen(const char *name);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#define BOOT_PROF_MAX_EVENTS    24
+
+// 启动阶段，完成后置位，依赖它的任务用boot_stage_wait等待
+#define BOOT_STAGE_STORAGE      BIT0    // LittleFS已挂载
+#define BOOT_STAGE_DISPLAY      BIT1    // 屏幕和LVGL已初始化，GUI任务已创建
+#define BOOT_STAGE_NVS          BIT2    // NVS已初始化，跟踪快照已读取
+
+typedef struct
+{
+    const char *name;
+    int64_t start_us;           // 自上电起的时间
+    int64_t end_us;             // 里程碑事件与start_us相同，未结束为0
+    int core;
+} boot_prof_event_t;
+
+/**
+ * @brief   创建启动阶段事件组并记录进入app_main的时间，应最先调用
+ */
+void boot_prof_init(void);
+
+/**
+ * @brief   开始记录一个启动阶段，可以在任意任务中调用
+ * @return  阶段编号，交给boot_prof_end；记录已满时返回-1
+ */
+int boot_prof_begin(const char *name);
+
+void boot_prof_end(int id);
+
+/**
+ * @brief   记录里程碑（首帧、首次指向等），同名只记录第一次
+ */
+void boot_prof_mark(const char *name);
+
+void boot_stage_done(EventBits_t stages);
+
+/**
+ * @brief   阻塞等待启动阶段完成，boot_prof_init之前调用时直接返回
+ */
+void boot_stage_wait(EventBits_t stages);
+
+/**
+ * @brief   打印各阶段的起止时间、耗时和运行的核心
+ */
+void boot_prof_report(void);
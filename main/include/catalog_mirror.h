@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define MIRROR_MANIFEST_PATH    "/littlefs/mirror_manifest.json"
+#define MIRROR_DELTA_PATH       "/littlefs/mirror_delta.txt"
+#define CATALOG_VERSION_PATH    "/littlefs/catalog_version.txt"  // 本地目录对应的镜像版本，0表示来自上游
+
+/**
+ * @brief   从局域网镜像刷新TLE和转发器目录
+ *          本地版本有对应的增量包时只下载增量，否则下载完整包
+ * @return
+ *      - ESP_OK 已是最新或刷新成功
+ *      - ESP_ERR_NOT_SUPPORTED 未配置镜像
+ *      - 其他 镜像不可达或数据错误，调用者应回退到上游下载
+ */
+esp_err_t catalog_mirror_refresh(void);
+
+uint32_t catalog_mirror_get_version(void);
+
+void catalog_mirror_set_version(uint32_t version);
+
+/**
+ * @brief   将增量包合并进TLE目录：删除"-catnr"行列出的卫星，替换或追加其余TLE
+ */
+esp_err_t catalog_apply_delta(const char *catalog_path, const char *delta_path);
+
+/**
+ * @brief   检查TLE目录文件，每组TLE都必须是"名称+两行根数"且通过Good_Elements校验，
+ *          空行和update_tle.py写入的更新时间行被忽略
+ * @return  有效TLE组数，文件无法打开、存在无效组或为空时返回负数
+ */
+int catalog_validate(const char *path);
+
+/**
+ * @brief   校验临时文件后原子替换目标目录，校验失败时删除临时文件
+ */
+esp_err_t catalog_install(const char *tmp_path, const char *dest_path, int *count);
+
+/**
+ * @brief   目录版本计数，每次catalog_install成功后加一，跟踪任务据此重新读取根数
+ */
+uint32_t catalog_generation(void);
+
+/**
+ * @brief   将下载得到的目录复制到临时文件，校验后替换跟踪使用的目录
+ */
+esp_err_t catalog_publish(const char *src_path, const char *dest_path);
+
+/**
+ * @brief   打开跟踪使用的TLE目录，LittleFS中没有时退回资源分区中的出厂目录
+ */
+FILE *catalog_open(void);
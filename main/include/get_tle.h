@@ -29,27 +29,24 @@
 #include "esp_http_client.h"
 #include "esp_http_server.h"
 #include "esp_crt_bundle.h"
-#include "esp_sntp.h"
-#include "esp_netif_sntp.h"
 
 #include "littlefs.h"
 #include "globals.h"
+#include "http_session.h"
 // #include "uart.h"
 
 #define ISS_URL                 "https://celestrak.org/NORAD/elements/gp.php?CATNR=25544&FORMAT=tle"
 #define AMATEUR_URL             "https://celestrak.org/NORAD/elements/gp.php?GROUP=amateur&FORMAT=tle"
+#define WEATHER_URL             "https://celestrak.org/NORAD/elements/gp.php?GROUP=weather&FORMAT=tle"
+#define CUBESAT_URL             "https://celestrak.org/NORAD/elements/gp.php?GROUP=cubesat&FORMAT=tle"
+#define TLE_GROUP_URLS          { AMATEUR_URL, WEATHER_URL, CUBESAT_URL }
 
 #define FLASH_FILE_PATH         "/littlefs/tle_eph.txt"  // 从本地编辑文件并烧录  
 #define FILE_PATH               "/littlefs/tle_data.txt"  // 通过下载功能下载文件，推荐一周更新一次
+#define TLE_DOWNLOAD_TMP_PATH   FILE_PATH ".part"  // 各分组全部下载成功后才改名为FILE_PATH
 #define LATEST_TIME_PATH        "/littlefs/latest_time.txt"  // 保存着上次下载数据的更新时间
 #define WIFI_CONNECTED_BIT      BIT0
 
 
-void sntp_netif_sync_time_init(void);
-
-void sntp_netif_sync_time(void);
-
-esp_err_t _http_event_handler(esp_http_client_event_t *evt);
-
 void download_tle_task(void);
 
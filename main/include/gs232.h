@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#define GS232_LINE_LEN          32      // 最长的命令为"W360 090"，留足余量
+#define GS232_REPLY_LEN         32
+#define GS232_RX_BUF_SIZE       256     // UART驱动的接收缓冲，不能小于硬件FIFO
+#define GS232_EVENT_QUEUE_LEN   16
+#define GS232_RX_TIMEOUT        3       // 接收超时，单位为字符时间，短命令不必等FIFO满就产生事件
+#define GS232_MAX_AZ            450     // GS-232的450度模式
+#define GS232_MAX_EL            180     // 仰角超过90度时翻转方位
+
+typedef struct
+{
+    uint32_t commands;
+    uint32_t errors;            // 无法识别的命令，回复"?>"
+    uint32_t overflows;         // 接收缓冲溢出或超长行
+} gs232_stats_t;
+
+/**
+ * @brief   执行一条GS-232命令（不含行结束符）
+ * @param   recv_us     命令所在数据的接收时刻，用于延迟统计
+ * @return  回复的字节数，0表示不需要回复
+ */
+int gs232_exec(const char *line, int64_t recv_us, char *reply, size_t size);
+
+/**
+ * @brief   GS-232仿真任务，占用CONFIG_TALLNECK_GS232_UART_NUM，
+ *          由UART事件队列驱动，收到行结束符立即执行并回复
+ */
+void gs232_task(void *pvParameters);
+
+void gs232_get_stats(gs232_stats_t *stats);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#include "arena.h"
+
+typedef enum
+{
+    HASH_MAP_KEY_INT,
+    HASH_MAP_KEY_STR,           // 插入时键复制到区域中，调用者的缓冲区可以复用
+} hash_map_key_type_t;
+
+typedef struct
+{
+    uint32_t hash;              // 0表示空槽
+    union
+    {
+        int32_t i;
+        const char *s;
+    } key;
+    void *value;
+} hash_map_entry_t;
+
+/**
+ * 开放寻址哈希表（robin hood线性探测），槽位数组和字符串键都分配在调用者提供的区域中，
+ * 不单独释放，随区域一起整体复位或释放。负载超过3/4时容量翻倍，旧数组留在区域中直到区域释放
+ */
+typedef struct
+{
+    arena_t *arena;
+    hash_map_key_type_t type;
+    hash_map_entry_t *entries;
+    uint32_t capacity;          // 2的幂
+    uint32_t count;
+} hash_map_t;
+
+/**
+ * @brief   初始化哈希表
+ * @param   capacity 预计元素个数，0使用默认值
+ */
+esp_err_t hash_map_init(hash_map_t *map, arena_t *arena, hash_map_key_type_t type, uint32_t capacity);
+
+/**
+ * @brief   插入或替换键对应的值
+ */
+esp_err_t hash_map_put_int(hash_map_t *map, int32_t key, void *value);
+
+esp_err_t hash_map_put_str(hash_map_t *map, const char *key, void *value);
+
+/**
+ * @brief   查找键对应的值，不存在时返回NULL
+ */
+void *hash_map_get_int(const hash_map_t *map, int32_t key);
+
+void *hash_map_get_str(const hash_map_t *map, const char *key);
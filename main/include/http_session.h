@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+
+#include "inflate_stream.h"
+
+#define HTTP_ACCEPT_ENCODING    "gzip, deflate"
+#define HTTP_SESSION_MAX_HOSTS  3       // celestrak、satnogs、局域网镜像
+#define HTTP_SESSION_HOST_LEN   64
+
+// 单次下载到文件的状态，作为HTTP客户端的user_data传入事件处理函数
+typedef struct
+{
+    const char *path;               // 目标文件
+    bool append;                    // 追加写入，用于多个分组合并到同一个文件
+    inflate_sink_t sink;            // 不为NULL时解压后的数据交给sink处理，不写文件
+    void *sink_ctx;
+    bool started;                   // 已收到响应体
+    FILE *fp;
+    inflate_encoding_t encoding;
+    inflate_stream_t inflater;
+    esp_err_t err;
+} http_download_ctx_t;
+
+// 每个主机保留一个客户端，连接和TLS会话票据在多次请求之间复用
+typedef struct
+{
+    char host[HTTP_SESSION_HOST_LEN];   // scheme://host[:port]
+    esp_http_client_handle_t client;
+    uint32_t requests;
+} http_session_t;
+
+esp_err_t http_session_event_handler(esp_http_client_event_t *evt);
+
+/**
+ * @brief   创建会话互斥锁，在任何下载任务启动前由app_main调用一次
+ */
+esp_err_t http_session_init(void);
+
+/**
+ * @brief   通过共享会话下载url到文件，同一主机的后续请求复用已有连接
+ */
+esp_err_t http_session_download(const char *url, http_download_ctx_t *dl);
+
+/**
+ * @brief   一轮刷新结束后关闭空闲连接，客户端和TLS会话票据保留，
+ *          下一轮刷新重连时走简化握手
+ */
+void http_session_close_idle(void);
+
+/**
+ * @brief   释放全部会话
+ */
+void http_session_cleanup(void);
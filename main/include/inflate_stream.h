@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "rom/miniz.h"
+
+// HTTP响应的Content-Encoding类型
+typedef enum
+{
+    INFLATE_ENCODING_IDENTITY = 0,  // 未压缩，直接透传
+    INFLATE_ENCODING_GZIP,          // gzip封装（RFC1952）
+    INFLATE_ENCODING_DEFLATE,       // zlib封装（RFC1950）
+} inflate_encoding_t;
+
+/**
+ * @brief   解压后数据的输出回调，每次最多输出一个窗口(32KB)的数据
+ *          返回非ESP_OK时解压中止
+ */
+typedef esp_err_t (*inflate_sink_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct
+{
+    inflate_encoding_t encoding;
+    inflate_sink_t sink;
+    void *sink_ctx;
+
+    tinfl_decompressor *decomp;     // ROM tinfl解压器状态
+    uint8_t *dict;                  // 32KB环形输出窗口，同时作为LZ77字典
+    size_t dict_ofs;
+
+    int state;                      // gzip头/数据/尾部解析状态
+    uint8_t flags;                  // gzip头部FLG字段
+    uint16_t skip;                  // 头部中需要跳过的剩余字节数
+    uint8_t trailer[8];             // gzip尾部：CRC32 + ISIZE
+    uint8_t trailer_len;
+    uint32_t crc;
+    uint32_t total_out;
+    uint32_t total_in;
+} inflate_stream_t;
+
+/**
+ * @brief   根据Content-Encoding头部的值判断压缩格式
+ */
+inflate_encoding_t inflate_encoding_from_header(const char *value);
+
+esp_err_t inflate_stream_init(inflate_stream_t *s, inflate_encoding_t encoding, inflate_sink_t sink, void *ctx);
+
+/**
+ * @brief   输入一段压缩数据，解压结果通过sink输出，可重复调用
+ */
+esp_err_t inflate_stream_feed(inflate_stream_t *s, const uint8_t *data, size_t len);
+
+/**
+ * @brief   输入结束，检查数据流是否完整（gzip会校验CRC32和长度）
+ */
+esp_err_t inflate_stream_finish(inflate_stream_t *s);
+
+void inflate_stream_deinit(inflate_stream_t *s);
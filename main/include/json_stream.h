@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define JSON_STREAM_TOKEN_MAX   128     // 单个字符串/数字的最大长度，超出部分截断
+#define JSON_STREAM_MAX_DEPTH   32
+
+typedef enum
+{
+    JSON_EVT_OBJECT_START,
+    JSON_EVT_OBJECT_END,
+    JSON_EVT_ARRAY_START,
+    JSON_EVT_ARRAY_END,
+    JSON_EVT_KEY,
+    JSON_EVT_STRING,
+    JSON_EVT_NUMBER,
+    JSON_EVT_TRUE,
+    JSON_EVT_FALSE,
+    JSON_EVT_NULL,
+} json_event_t;
+
+/**
+ * @brief   解析事件回调
+ * @param   depth   值所在的层级，顶层为0；对象的键和成员位于对象层级+1
+ * @param   text    KEY/STRING/NUMBER的文本（已转义，以'\0'结尾），其他事件为NULL
+ *          返回非ESP_OK时解析中止
+ */
+typedef esp_err_t (*json_stream_cb_t)(json_event_t evt, int depth, const char *text, void *ctx);
+
+/**
+ * 增量式（SAX）JSON解析器：数据可以任意切分后分多次输入，
+ * 内存占用固定为一个token缓冲区，不建立DOM
+ */
+typedef struct
+{
+    json_stream_cb_t cb;
+    void *ctx;
+
+    uint8_t state;
+    uint8_t depth;
+    uint32_t containers;        // 第i位为1表示第i层是对象，否则是数组
+    bool expect_key;
+    bool is_key;
+
+    char token[JSON_STREAM_TOKEN_MAX];
+    size_t token_len;
+    uint32_t unicode;           // \uXXXX转义
+    uint8_t unicode_len;
+    uint32_t high_surrogate;
+
+    size_t offset;              // 已处理的字节数，用于定位错误
+    esp_err_t err;
+} json_stream_t;
+
+void json_stream_init(json_stream_t *js, json_stream_cb_t cb, void *ctx);
+
+esp_err_t json_stream_feed(json_stream_t *js, const char *data, size_t len);
+
+/**
+ * @brief   输入结束，检查文档是否完整
+ */
+esp_err_t json_stream_finish(json_stream_t *js);
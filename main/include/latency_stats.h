@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "setpoint.h"
+
+#define LATENCY_WINDOW          128     // 每个阶段保留最近的样本数
+
+// 命令到电机动作的各阶段，每段为相邻两个时间戳之差
+typedef enum
+{
+    LAT_STAGE_PARSE = 0,        // socket收到 -> 命令解析完成
+    LAT_STAGE_POST,             // 解析完成 -> 投递到目标邮箱
+    LAT_STAGE_HANDOFF,          // 投递 -> 电机任务取走
+    LAT_STAGE_PLAN,             // 取走 -> 运动规划完成
+    LAT_STAGE_SUBMIT,           // 规划完成 -> rmt_transmit返回
+    LAT_STAGE_TOTAL,            // socket收到 -> rmt_transmit返回
+    LAT_STAGE_COUNT,
+} latency_stage_t;
+
+// 最近LATENCY_WINDOW个样本的统计，单位微秒
+typedef struct
+{
+    uint32_t samples;           // 累计样本数
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;            // 窗口内最大值
+    uint32_t max_all_us;        // 启动以来最大值
+} latency_summary_t;
+
+/**
+ * @brief   记录一次网络命令从接收到提交电机动作的各阶段时间，由电机任务调用
+ *          recv_us为0的目标（跟踪任务、控制台）不计入
+ */
+void latency_record(const rot_setpoint_t *sp, int64_t take_us, int64_t plan_us, int64_t submit_us);
+
+void latency_get(latency_stage_t stage, latency_summary_t *summary);
+
+const char *latency_stage_name(latency_stage_t stage);
+
+/**
+ * @brief   以JSON格式输出全部阶段的统计，供网络接口使用
+ * @return  写入的字节数
+ */
+int latency_format_json(char *buf, size_t size);
+
+void latency_stats_print(void);
@@ -11,6 +11,7 @@
 #include "esp_log.h"
 
 #include "get_tle.h"
+#include "time_sync.h"
 #include "globals.h"
 #include "sgp4sdp4.h"
 
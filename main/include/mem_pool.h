@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+/**
+ * 固定大小的内存块池，存储区由调用者静态提供，分配和释放都是O(1)且不访问堆。
+ * 用于在任务之间传递的消息等大小固定、数量有上限的对象
+ */
+typedef struct mem_pool
+{
+    const char *name;
+    uint8_t *storage;
+    size_t block_size;
+    uint16_t count;
+    uint16_t used;
+    uint16_t peak;              // 最高占用块数
+    uint32_t allocs;
+    uint32_t failures;          // 池已满导致的分配失败
+    void *free_list;
+    portMUX_TYPE lock;
+    struct mem_pool *next;      // 已注册池的链表，供统计使用
+} mem_pool_t;
+
+// 分配器层的堆调用计数，稳定跟踪时heap_allocs和heap_frees应当不再增长
+typedef struct
+{
+    uint32_t heap_allocs;
+    uint32_t heap_frees;
+    uint32_t heap_failures;
+    uint32_t arena_resets;
+} mem_stats_t;
+
+/**
+ * @brief   初始化内存块池并注册到统计链表
+ * @param   storage 至少block_size * count字节，按指针对齐
+ * @param   block_size 块大小，不小于一个指针
+ */
+esp_err_t mem_pool_init(mem_pool_t *pool, const char *name, void *storage, size_t block_size, size_t count);
+
+/**
+ * @brief   取出一块，池已满时返回NULL
+ */
+void *mem_pool_alloc(mem_pool_t *pool);
+
+void mem_pool_free(mem_pool_t *pool, void *block);
+
+/**
+ * @brief   块是否属于该池的存储区
+ */
+bool mem_pool_owns(const mem_pool_t *pool, const void *block);
+
+/**
+ * @brief   计数的堆分配，分配器层所有的堆调用都经过这里
+ */
+void *mem_heap_alloc(size_t size);
+
+void *mem_heap_calloc(size_t n, size_t size);
+
+void mem_heap_free(void *ptr);
+
+// arena_reset调用时计数
+void mem_stats_note_arena_reset(void);
+
+void mem_stats_get(mem_stats_t *stats);
+
+/**
+ * @brief   打印堆计数、各内存块池的占用和系统剩余堆
+ */
+void mem_stats_print(void);
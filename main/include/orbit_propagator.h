@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sgp4sdp4.h"
+
+// 观测站位置：哈尔滨 45.4915N, 126.3848E, 海拔0.15km（深圳: 22.3349, 114.1036）
+#define OBSERVER_LAT_DEG        45.4915
+#define OBSERVER_LON_DEG        126.3848
+#define OBSERVER_ALT_KM         0.15
+
+#define PASS_SEARCH_STEP_MIN    1.0     // 过境搜索步长（分钟）
+
+/**
+ * @brief   经过select_ephemeris预处理的一组根数
+ *          SGP4/SDP4的内部状态是静态变量和全局标志位，不可重入，
+ *          多个任务通过本模块共享同一份传播器，切换卫星时重新初始化
+ */
+typedef struct
+{
+    tle_t tle;
+    bool deep_space;
+} orbit_t;
+
+esp_err_t orbit_propagator_init(void);
+
+/**
+ * @brief   从TLE文件中读取卫星根数并预处理
+ * @return  Input_Tle_Set的返回值，0表示成功
+ */
+int orbit_load(orbit_t *orb, FILE *fp, char *sat_name);
+
+/**
+ * @brief   距根数历元的时间（分钟）
+ */
+double orbit_tsince(const orbit_t *orb, double jul_utc);
+
+/**
+ * @brief   计算jul_utc时刻卫星的位置速度（km, km/s）以及相对观测站的方位、仰角、距离和距离变化率
+ */
+void orbit_observe(orbit_t *orb, double jul_utc, geodetic_t *obs, vector_t *pos, vector_t *vel, vector_t *obs_set);
+
+/**
+ * @brief   太阳相对观测站的方位和仰角，Calculate_Obs会修改共享标志位，因此也需要加锁
+ */
+void orbit_observe_sun(double jul_utc, geodetic_t *obs, vector_t *solar_vector, vector_t *solar_set);
+
+/**
+ * @brief   从jul_start开始在span_days天内搜索下一次过境
+ *          jul_start时卫星已在地平线以上时，aos即为jul_start
+ * @return  找到过境返回true
+ */
+bool orbit_next_pass(orbit_t *orb, geodetic_t *obs, double jul_start, double span_days, double *jul_aos, double *jul_los);
+
+/**
+ * @brief   在aos到los之间找出仰角不低于min_ele_deg的时段和过境最大仰角
+ * @return  最大仰角低于min_ele_deg时返回false
+ */
+bool orbit_pass_window(orbit_t *orb, geodetic_t *obs, double jul_aos, double jul_los, double min_ele_deg,
+                       double *jul_start, double *jul_end, double *max_ele_deg);
+
+/**
+ * @brief   jul_utc时刻卫星的方位角和仰角（度）
+ */
+void orbit_pointing(orbit_t *orb, geodetic_t *obs, double jul_utc, double *azi_deg, double *ele_deg);
+
+void orbit_observer_geodetic(geodetic_t *obs);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "sgp4sdp4.h"
+#include "tle_prefetch.h"
+
+#define PASS_SCHED_PATH             "/littlefs/sched.txt"
+#define PASS_SCHED_MAX_WATCH        TLE_PREFETCH_MAX_WATCH
+#define PASS_SCHED_MAX_CANDIDATES   96      // 规划时段内所有卫星的候选过境
+#define PASS_SCHED_MAX_PRIORITY     10
+
+// 调度任务的通知位
+#define PASS_SCHED_REBUILD          0x01    // 监视列表变化或时钟跳变，重新规划
+#define PASS_SCHED_ENABLE           0x02
+#define PASS_SCHED_DISABLE          0x04
+
+// 监视列表中的一颗卫星，文件中每行为"优先级 最低仰角 卫星名"
+typedef struct
+{
+    char name[SAT_NMAE_LENGTH];
+    uint8_t priority;           // 1..PASS_SCHED_MAX_PRIORITY
+    float min_ele;              // 度，低于该仰角的部分不计入可用时间
+} pass_watch_t;
+
+// 时间线上的一次过境，时间为儒略日
+typedef struct
+{
+    uint8_t watch;              // 监视列表下标，只在规划时的监视列表版本内有效
+    double launch;              // 发出跟踪命令的时间，提前量用于旋转器转到入境方位
+    double start;               // 仰角达到min_ele
+    double end;
+    float max_ele;
+    float start_azi, start_ele;
+    float end_azi, end_ele;
+    float weight;               // 优先级 x 可用分钟数
+} pass_slot_t;
+
+/**
+ * @brief   过境调度任务：从监视列表预测规划时段内的过境，用带权区间调度选出
+ *          总权重最大、且相邻过境之间留有旋转器转动时间的一组过境，按时间线
+ *          自动开始和结束跟踪
+ */
+void pass_sched_task(void *pvParameter);
+
+/**
+ * @brief   串口命令：sched list | sched on | sched off |
+ *          sched add <priority> <min_ele> <name> | sched del <name>
+ */
+void pass_sched_command(const char *line);
+
+/**
+ * @brief   两个指向之间旋转器的转动时间（秒），包括稳定时间
+ */
+double pass_sched_slew_s(float azi_from, float ele_from, float azi_to, float ele_to);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define SETPOINT_MAX_AGE_MS     3000    // 电机任务忽略早于此时间的目标
+
+typedef enum
+{
+    SETPOINT_SRC_TCP = 0,
+    SETPOINT_SRC_TRACKER,
+    SETPOINT_SRC_CONSOLE,
+    SETPOINT_SRC_TRAJECTORY,
+    SETPOINT_SRC_SERIAL,        // GS-232串口
+} setpoint_source_t;
+
+// 转台目标位置，按值传递
+typedef struct
+{
+    uint32_t seq;               // 每次投递加一，0表示还没有目标
+    uint8_t source;             // setpoint_source_t
+    int64_t time_us;            // 投递时刻，esp_timer时间
+    int64_t recv_us;            // 网络命令的接收时刻，其他来源为0
+    int64_t parse_us;           // 网络命令的解析完成时刻
+    float azimuth;              // 度
+    float elevation;
+} rot_setpoint_t;
+
+typedef struct
+{
+    uint32_t posted;
+    uint32_t taken;
+    uint32_t overwritten;       // 电机任务取走之前就被新目标覆盖的次数
+} setpoint_stats_t;
+
+/**
+ * @brief   绑定电机任务，之后的投递会通知该任务，由电机任务调用
+ */
+void setpoint_bind_consumer(void);
+
+/**
+ * @brief   投递新目标，覆盖尚未取走的旧目标，不分配内存、不阻塞，可由任意任务调用
+ * @return  本次目标的序号
+ */
+uint32_t setpoint_post(float azimuth, float elevation, setpoint_source_t source);
+
+/**
+ * @brief   同setpoint_post，附带接收和解析时刻，用于统计命令到电机动作的延迟
+ */
+uint32_t setpoint_post_stamped(float azimuth, float elevation, setpoint_source_t source,
+                               int64_t recv_us, int64_t parse_us);
+
+/**
+ * @brief   取走最新的目标，没有新目标时最多等待wait，由电机任务调用
+ * @return  取到新目标时返回true
+ */
+bool setpoint_take(rot_setpoint_t *sp, TickType_t wait);
+
+/**
+ * @brief   读取最近投递的目标，不影响电机任务
+ * @return  还没有投递过目标时返回false
+ */
+bool setpoint_last(rot_setpoint_t *sp);
+
+void setpoint_get_stats(setpoint_stats_t *stats);
@@ -13,6 +13,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <stdbool.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/FreeRTOSConfig.h"
@@ -186,6 +187,8 @@ extern float longitude;
 
 // 跟踪线程
 void orbit_trking_task(void);
+// 跟踪任务正在跟踪某颗卫星（尚未收到结束命令）
+bool orbit_trking_busy(void);
 /* Funtion prototypes produced by cproto */
 /* main.c */
 int main(int argc, char *argv[]);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define STATE_FLAG_ECLIPSED     0x01
+#define STATE_FLAG_DEEP_SPACE   0x02    // SDP4
+#define STATE_FLAG_IN_PASS      0x04    // 仰角不低于0度
+
+/**
+ * 跟踪任务每次计算后发布的卫星状态，只含数值。卫星名称很少变化，单独保存，
+ * target计数变化时才需要用state_bus_read_target重新读取
+ */
+typedef struct
+{
+    uint32_t generation;        // 每次发布加一，0表示还没有数据
+    uint32_t target;            // 跟踪目标切换计数
+    int32_t catnr;
+    uint8_t flags;
+    int64_t time_ms;            // UTC，毫秒
+    float azi;                  // 度
+    float ele;
+    float range;                // km
+    float range_rate;           // km/s
+    float lat;                  // 度
+    float lon;
+    float alt;                  // km
+    float vel;                  // km/s
+    float eclipse_depth;        // 度
+} track_state_t;
+
+/**
+ * @brief   切换跟踪目标，只能由跟踪任务调用
+ */
+void state_bus_set_target(const char *name, int32_t catnr);
+
+/**
+ * @brief   发布最新状态，只能由跟踪任务调用。generation、target和catnr由总线填写
+ */
+void state_bus_publish(const track_state_t *state);
+
+/**
+ * @brief   最新状态的发布计数，与上次读取的generation比较即可判断是否有更新
+ */
+uint32_t state_bus_generation(void);
+
+/**
+ * @brief   读取最新状态，不加锁也不会取走数据，任意核心上的任意多个读者互不影响
+ * @return  还没有发布过状态时返回false
+ */
+bool state_bus_read(track_state_t *state);
+
+/**
+ * @brief   读取当前跟踪目标的名称
+ * @return  目标切换计数，与track_state_t.target对应
+ */
+uint32_t state_bus_read_target(char *name, size_t size);
@@ -11,6 +11,7 @@
 #include "driver/rmt_tx.h"
 #include "tcp_server.h"
 #include "globals.h"
+#include "setpoint.h"
 
 ///////////////////////////////Change the following configurations according to your board//////////////////////////////
 
@@ -23,8 +24,8 @@
 #define STEP_MOTOR_SPIN_DIR_COUNTERCLOCKWISE !STEP_MOTOR_SPIN_DIR_CLOCKWISE
 
 #define STEP_MOTOR_RESOLUTION_HZ 1000000 // 1MHz resolution
-
-extern QueueHandle_t RotQueueHandler;
+#define STEP_MOTOR_STEPS_PER_DEG (200 * 16 / 360.0f) // 200 steps/rev, 1/16 microstepping, direct drive
+#define STEP_MOTOR_CABLE_WRAP_DEG 270 // Max azimuth travel either way from the power-on position
 
 /**
  * @brief Stepper motor curve encoder configuration
@@ -69,6 +70,9 @@ esp_err_t rmt_new_stepper_motor_uniform_encoder(const stepper_motor_uniform_enco
 
 void stepper_motor_encoder_init(void);
 
+/**
+ * @brief   电机任务，从目标邮箱取最新的目标位置
+ */
 void rotator_controller(void *pvParameters);
 
 
@@ -6,25 +6,10 @@
 #include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
-#include "freertos/timers.h"
-#include "esp_system.h"
-#include "esp_wifi.h"
-#include "esp_event.h"
 #include "esp_log.h"
-#include "nvs_flash.h"
-#include "esp_netif.h"
-#include "protocol_examples_common.h"
-#include "driver/rmt_tx.h"
-#include "driver/gpio.h"
-
-#include "lwip/err.h"
 #include "lwip/sockets.h"
-#include "lwip/sys.h"
-#include <lwip/netdb.h>
-
-#include "driver/gpio.h"
 #include "globals.h"
+#include "setpoint.h"
 
 
 #define NOT_TRACKING_FARSIDE    0
@@ -36,11 +21,25 @@
 #define KEEPALIVE_INTERVAL  CONFIG_EXAMPLE_KEEPALIVE_INTERVAL
 #define KEEPALIVE_COUNT     CONFIG_EXAMPLE_KEEPALIVE_COUNT
 
-typedef struct
-{
-    float Azimuth; 
-    float Elevation; 
-}Tcp_Sentence;
+// rotctld服务
+#ifndef ROTCTLD_MAX_CLIENTS
+#define ROTCTLD_MAX_CLIENTS     4       // 同时连接的客户端数，同时作为listen的backlog，主机构建压测时可加大
+#endif
+#define ROTCTLD_LINE_LEN        128     // 每个客户端的行缓冲
+#define ROTCTLD_PROT_VER        1       // dump_state中的协议版本
+#define ROTCTLD_MODEL           1
+#define ROTCTLD_MIN_AZ          0.0f
+#define ROTCTLD_MAX_AZ          360.0f
+#define ROTCTLD_MIN_EL          0.0f
+#define ROTCTLD_MAX_EL          90.0f
+#define ROTCTLD_PARK_AZ         0.0f
+#define ROTCTLD_PARK_EL         0.0f
+
+// Hamlib返回码，以RPRT n回复客户端
+#define RIG_OK                  0
+#define RIG_EINVAL              -1
+#define RIG_ENIMPL              -4
+#define RIG_EPROTO              -8
 
 typedef enum
 {
@@ -49,7 +48,13 @@ typedef enum
     RECVIVING,
 }Connection_Status;
 
-void do_retransmit(const int sock);
+// 每个客户端连接的状态
+typedef struct
+{
+    int sock;                           // -1表示空闲
+    size_t len;                         // 行缓冲中已有的字节数
+    char line[ROTCTLD_LINE_LEN];
+} rotctld_client_t;
 
 void tcp_server_task(void *pvParameters);
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define TIME_SYNC_NVS_NAMESPACE     "time_sync"
+#define TIME_SYNC_NVS_DRIFT_KEY     "drift_ppb"
+#define TIME_SYNC_MAX_CBS           4
+#define TIME_SYNC_SLEW_MAX_US       ((int64_t)CONFIG_TALLNECK_TIME_SLEW_MAX_MS * 1000)  // 超过此偏差直接跳变
+#define TIME_SYNC_DRIFT_PERIOD_S    60      // 两次同步之间按漂移估计补偿时钟的周期
+#define TIME_SYNC_DRIFT_MIN_S       600     // 同步间隔短于此时偏差主要是网络抖动，不更新漂移估计
+#define TIME_SYNC_DRIFT_MAX_PPB     100000  // 超出的估计值视为异常，晶振标称误差远小于此
+#define TIME_SYNC_DRIFT_GAIN        2       // 后续估计按1/GAIN的权重并入
+
+// 一次同步的结果，传给回调
+typedef struct
+{
+    int64_t offset_us;          // NTP时间减去本地时间（含尚未完成的校正），正值表示本地时钟慢
+    bool stepped;               // 偏差过大，直接设置了时钟
+    int32_t drift_ppb;          // 更新后的漂移估计，正值表示本地时钟走慢
+} time_sync_event_t;
+
+typedef void (*time_sync_cb_t)(const time_sync_event_t *event, void *ctx);
+
+typedef struct
+{
+    bool synced;                // 启动后至少同步过一次
+    uint32_t syncs;
+    uint32_t steps;
+    int64_t last_sync_us;       // 最近一次同步的esp_timer时间
+    int64_t last_offset_us;
+    int32_t drift_ppb;
+    int64_t drift_applied_us;   // 最近一次同步以来按漂移估计补偿的累计时间
+    int64_t pending_us;         // 尚未完成的平滑校正
+} time_sync_status_t;
+
+/**
+ * @brief   初始化SNTP并在后台开始同步，不阻塞。载入保存的漂移估计并启动漂移补偿定时器
+ *          偏差不超过CONFIG_TALLNECK_TIME_SLEW_MAX_MS时用adjtime平滑校正，跟踪过程中时间不跳变
+ */
+esp_err_t time_sync_init(void);
+
+/**
+ * @brief   请求立即重新同步，不等待结果，结果通过回调通知
+ */
+esp_err_t time_sync_request(void);
+
+/**
+ * @brief   注册同步完成回调，在lwIP线程中调用，不能阻塞
+ */
+esp_err_t time_sync_register_cb(time_sync_cb_t cb, void *ctx);
+
+void time_sync_get_status(time_sync_status_t *status);
+
+void time_sync_print(void);
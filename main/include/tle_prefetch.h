@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#define TLE_PREFETCH_MAX_WATCH      8
+#define TLE_PREFETCH_SPAN_DAYS      1.0     // 过境预测的时间范围
+#define TLE_PREFETCH_MAX_BACKOFF_MIN (24 * 60)  // 刷新后根数仍过期时，重试间隔加倍的上限
+
+/**
+ * @brief   TLE下载任务：收到UPDATE_TLE通知时立即下载，否则定期检查监视列表中
+ *          各卫星在下一次过境时的根数时效，超过CONFIG_TALLNECK_TLE_MAX_AGE_HOURS之前
+ *          在两次过境之间的空闲时段预先刷新
+ */
+void tle_prefetch_task(void *pvParameter);
+
+/**
+ * @brief   将卫星加入监视列表（跟踪或计划跟踪的卫星），列表满时替换最早加入的
+ */
+void tle_prefetch_watch(const char *sat_name);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define TRACK_REC_DIR           "/littlefs/rec"
+#define TRACK_REC_PATH          TRACK_REC_DIR "/track.bin"
+#define TRACK_REC_FILE_MAX      (128 * 1024)    // 超过后轮转为track.1.bin ...
+#define TRACK_REC_FILES         4               // 保留的文件数（含当前文件）
+#define TRACK_REC_BLOCK_SIZE    1024
+#define TRACK_REC_BLOCKS        16              // 环形缓冲区16KB，约1500条记录
+#define TRACK_REC_MAGIC         0x5254          // "TR"
+#define TRACK_REC_VERSION       1
+#define TRACK_REC_FIELDS        7
+
+// 旋转器状态
+typedef enum
+{
+    TRACK_REC_ROT_IDLE = 0,     // 卫星在地平线以下，等待过境
+    TRACK_REC_ROT_TRACKING,
+} track_rec_rot_state_t;
+
+/*
+ * 块格式：header | records
+ * 每条记录是TRACK_REC_FIELDS个zigzag变长整数，依次为
+ * 时间(ms)、指令方位、指令仰角、计算方位、计算仰角（0.01度）、距离变化率(m/s)、旋转器状态，
+ * 块内第一条记录相对0编码，之后相对上一条记录编码，每个块可以单独解码
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t fields;
+    uint16_t count;             // 记录条数
+    uint16_t length;            // 记录部分的字节数
+    int32_t catnr;
+    uint32_t reserved;
+} track_rec_block_hdr_t;
+
+typedef struct
+{
+    int64_t time_ms;            // UTC毫秒
+    double azi_cmd;             // 下发给旋转器的方位和仰角（度）
+    double ele_cmd;
+    double azi;                 // 计算得到的方位和仰角（度）
+    double ele;
+    double range_rate;          // km/s
+    uint8_t rot_state;          // track_rec_rot_state_t
+} track_rec_sample_t;
+
+/**
+ * @brief   开始记录一颗卫星，之后的记录写入新的块
+ */
+void track_recorder_start(int catnr);
+
+/**
+ * @brief   追加一条记录，只写内存；缓冲区写满时覆盖最早的未写入块
+ */
+void track_recorder_append(const track_rec_sample_t *sample);
+
+/**
+ * @brief   过境之外（或缓冲区快满时）把缓冲区中的块整块写入记录文件
+ */
+void track_recorder_poll(bool in_pass);
+
+/**
+ * @brief   立即写入全部未写入的块
+ */
+esp_err_t track_recorder_flush(void);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "orbit_propagator.h"
+
+#define TRACK_SNAPSHOT_NAMESPACE    "track"
+#define TRACK_SNAPSHOT_KEY          "snapshot"
+#define TRACK_SNAPSHOT_VERSION      1
+#define TRACK_SNAPSHOT_PERIOD_S     CONFIG_TALLNECK_TRACK_SNAPSHOT_PERIOD_S
+
+typedef enum
+{
+    TRACK_MODE_IDLE = 0,
+    TRACK_MODE_AUTO,            // 按根数自动跟踪
+} track_mode_t;
+
+// 写入NVS的跟踪会话，根数是select_ephemeris预处理之后的，恢复时不必再读TLE文件
+typedef struct
+{
+    uint32_t version;
+    uint8_t mode;               // track_mode_t
+    char sat_name[SAT_NMAE_LENGTH];     // 跟踪命令中输入的卫星名
+    orbit_t orb;
+    geodetic_t obs;
+    float rot_azi;              // 最近一次下发给旋转器的方位和仰角（度）
+    float rot_ele;
+    int64_t saved_at;           // 写入时的系统时间（秒）
+} track_snapshot_t;
+
+/**
+ * @brief   启动时尽早调用：初始化NVS并读取上次的跟踪会话
+ *          系统时间落后于快照写入时间时（时钟被复位）先把时间推到快照时间，等SNTP校准
+ * @return  ESP_OK 存在可恢复的会话，ESP_ERR_NOT_FOUND 上次未在跟踪
+ */
+esp_err_t track_snapshot_restore(void);
+
+/**
+ * @brief   取出启动时恢复的会话，只返回一次
+ */
+bool track_snapshot_resume(track_snapshot_t *snap);
+
+/**
+ * @brief   开始跟踪或根数更新时立即写入快照
+ */
+esp_err_t track_snapshot_begin(const char *sat_name, const orbit_t *orb, const geodetic_t *obs);
+
+/**
+ * @brief   跟踪循环中调用，记录旋转器指向，距上次写入超过TRACK_SNAPSHOT_PERIOD_S才写NVS
+ */
+void track_snapshot_update(float rot_azi, float rot_ele);
+
+/**
+ * @brief   停止跟踪，删除快照
+ */
+esp_err_t track_snapshot_clear(void);
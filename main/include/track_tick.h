@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define TRACK_TICK_BEAM_FRACTION    0.1     // 两次指向之间允许转过的角度占波束宽度的比例
+
+// 抖动统计，单位微秒
+typedef struct
+{
+    uint32_t ticks;
+    uint32_t overruns;          // 计算超过周期、截止时间已过的次数
+    uint32_t period_ms;         // 当前周期
+    int64_t jitter_sum_us;      // 唤醒时刻相对截止时间的延迟
+    int64_t jitter_max_us;
+    int64_t work_max_us;        // 单次跟踪计算耗时
+} track_tick_stats_t;
+
+/**
+ * @brief   创建截止时间定时器，到期时向调用任务发送TRACK_TICK通知，由跟踪任务调用
+ */
+esp_err_t track_tick_init(void);
+
+/**
+ * @brief   立即产生第一次节拍，之后的截止时间从此刻起累加，不随计算耗时漂移
+ */
+void track_tick_start(void);
+
+void track_tick_stop(void);
+
+/**
+ * @brief   收到TRACK_TICK通知后调用，记录唤醒延迟
+ */
+void track_tick_woke(void);
+
+/**
+ * @brief   本次计算结束后调用，在上一个截止时间的基础上安排下一次节拍
+ */
+void track_tick_schedule(uint32_t period_ms);
+
+/**
+ * @brief   根据轴角速度选择周期：转过的角度不超过波束宽度的一部分，
+ *          过境中限制在最小、最大周期之间；地平线以下按仰角变化估计入境时间，最长为空闲周期
+ * @param   azi_rate, ele_rate 度/秒
+ */
+uint32_t track_tick_period(double azi_rate, double ele_rate, double ele);
+
+void track_tick_get_stats(track_tick_stats_t *stats);
+
+void track_tick_stats_print(void);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define TRAJECTORY_URI          "/trajectory"
+#define TRAJ_MAX_POINTS         2048    // 1秒一个点可覆盖34分钟
+#define TRAJ_LINE_LEN           96
+#define TRAJ_STEP_MS            100     // 执行时插值和投递目标的周期
+#define TRAJ_MAX_GAP_MS         600000  // 相邻两点的最大间隔
+
+// 轨迹点，8字节。时间相对第一个点，角度单位0.01度
+typedef struct
+{
+    uint32_t t_ms;
+    uint16_t azi_cdeg;          // 0..36000
+    int16_t ele_cdeg;           // -9000..18000
+} traj_point_t;
+
+typedef enum
+{
+    TRAJ_IDLE = 0,
+    TRAJ_LOADING,               // 正在上传
+    TRAJ_ARMED,                 // 已预置到第一个点，等待开始时间
+    TRAJ_RUNNING,
+    TRAJ_DONE,
+} traj_state_t;
+
+typedef struct
+{
+    traj_state_t state;
+    int points;
+    int64_t start_ms;           // UTC毫秒
+    int64_t end_ms;
+    uint32_t posted;            // 本次执行投递的目标数
+} traj_status_t;
+
+/**
+ * @brief   开始上传新轨迹，写入暂存区，正在执行的轨迹在traj_load_end成功前继续执行
+ */
+void traj_load_begin(void);
+
+/**
+ * @brief   解析一行"<unix时间(秒，可带小数)> <方位角> <仰角>"并追加，空行和#开头的行忽略
+ * @return  ESP_ERR_INVALID_ARG：格式或范围错误，时间不递增；ESP_ERR_NO_MEM：点数超过TRAJ_MAX_POINTS
+ */
+esp_err_t traj_load_line(const char *line);
+
+/**
+ * @brief   结束上传，至少两个点时替换当前轨迹并交给执行任务，否则丢弃上传，当前轨迹不变
+ */
+esp_err_t traj_load_end(void);
+
+/**
+ * @brief   丢弃未完成的上传，不影响当前轨迹
+ */
+void traj_load_abort(void);
+
+/**
+ * @brief   取消正在执行或等待开始的轨迹，上传中调用时丢弃已上传的点
+ */
+void traj_stop(void);
+
+/**
+ * @brief   轨迹已就绪或正在执行，期间跟踪任务不向转台投递目标
+ */
+bool traj_active(void);
+
+void traj_get_status(traj_status_t *status);
+
+/**
+ * @brief   执行任务：按系统时钟（SNTP校准）在相邻轨迹点之间线性插值，
+ *          每TRAJ_STEP_MS向目标邮箱投递一次，网络延迟不进入指向回路
+ */
+void traj_task(void *pvParameters);
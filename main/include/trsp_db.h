@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "trsp_update.h"
+#include "hash_map.h"
+
+#define TRSP_DB_PATH        "/littlefs/conf/trsp/transponders.db"
+#define TRSP_DB_MAGIC       0x42445254      // "TRDB"
+#define TRSP_DB_VERSION     1
+
+/*
+ * 文件布局：header | index[sat_count] | records[record_count] | strings
+ * index和records都按编号排序，同一颗卫星的转发器连续存放，
+ * 描述和模式名在字符串表中只存一份，记录里保存偏移
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t sat_count;
+    uint32_t record_count;
+    uint32_t strtab_size;
+    uint32_t index_offset;
+    uint32_t record_offset;
+    uint32_t strtab_offset;
+} trsp_db_header_t;
+
+typedef struct __attribute__((packed)) {
+    int32_t catnr;
+    uint32_t first;         // 第一条记录的序号
+    uint16_t count;
+    uint16_t reserved;
+} trsp_db_index_t;
+
+typedef struct __attribute__((packed)) {
+    int32_t catnr;
+    uint32_t description;   // 字符串表偏移
+    uint32_t mode;
+    int64_t uplink_low;
+    int64_t uplink_high;
+    int64_t downlink_low;
+    int64_t downlink_high;
+    float baud;
+    uint8_t invert;
+    uint8_t alive;
+    uint16_t reserved;
+} trsp_db_record_t;
+
+// 排序用的(编号, 到达顺序)对，记录本身暂存在临时文件中
+typedef struct {
+    int32_t catnr;
+    uint32_t seq;
+} trsp_db_order_t;
+
+// 字符串驻留链，哈希值相同的不同字符串挂在同一个键下
+typedef struct trsp_db_str {
+    uint32_t offset;
+    uint16_t len;
+    const char* str;        // 写入器arena中的副本，哈希命中时在内存中比较
+    struct trsp_db_str* next;
+} trsp_db_str_t;
+
+typedef struct {
+    FILE* records;          // 按到达顺序写入的记录
+    FILE* strings;          // 驻留后的字符串表
+    uint32_t record_count;
+    uint32_t strtab_size;
+    trsp_db_order_t* order;
+    size_t order_cap;
+    arena_t arena;          // 驻留链节点、字符串副本和哈希表槽位
+    hash_map_t strtab;      // 字符串哈希 -> trsp_db_str_t链
+    esp_err_t err;
+} trsp_db_writer_t;
+
+esp_err_t trsp_db_writer_begin(trsp_db_writer_t* w);
+
+/**
+ * @brief   追加一条转发器记录，内存中只保留编号和序号
+ */
+esp_err_t trsp_db_writer_add(trsp_db_writer_t* w, const struct transponder* t);
+
+/**
+ * @brief   排序后一次顺序写出数据库，再原子替换TRSP_DB_PATH
+ */
+esp_err_t trsp_db_writer_commit(trsp_db_writer_t* w);
+
+void trsp_db_writer_abort(trsp_db_writer_t* w);
+
+/**
+ * @brief   查询一颗卫星的转发器：在索引上二分查找，再一次读出全部记录
+ * @return  写入out的条数，数据库不存在或没有该卫星时返回0
+ */
+int trsp_db_lookup(int catnr, struct transponder* out, int max);
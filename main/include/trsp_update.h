@@ -15,7 +15,7 @@
 
 #include "esp_log.h"
 #include "nxjson.h"
-#include "hash_table.h"
+#include "hash_map.h"
 
 // 转发器数据结构
 struct transponder {
@@ -53,3 +53,7 @@ typedef struct {
 
 
 bool trsp_update_files(const char* input_file);
+
+bool download_trsp_data(void);
+
+bool download_trsp_data_from(const char *url);
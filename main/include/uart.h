@@ -11,6 +11,20 @@
 
 #include "globals.h"
 #include "sgp4sdp4.h"
+#include "trsp_db.h"
+#include "mem_pool.h"
+#include "boot_prof.h"
+#include "state_bus.h"
+#include "track_tick.h"
+#include "pass_sched.h"
+#include "setpoint.h"
+#include "latency_stats.h"
+#include "udp_stream.h"
+#include "ws_feed.h"
+#include "trajectory.h"
+#include "gs232.h"
+#include "time_sync.h"
+#include "esp_timer.h"
 #include "wifi_manager.h"
 
 void echo_task(void *pvParameter);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#define UDP_STREAM_MAGIC        0x4E54  // "TN"
+#define UDP_STREAM_VERSION      1
+#define UDP_STREAM_MAX_DEST     4
+#define UDP_STREAM_MIN_HZ       1
+#define UDP_STREAM_MAX_HZ       50
+
+#define UDP_FLAG_TRACKING       0x01    // 跟踪数据有效
+#define UDP_FLAG_ECLIPSED       0x02
+#define UDP_FLAG_DEEP_SPACE     0x04
+#define UDP_FLAG_IN_PASS        0x08
+#define UDP_FLAG_ROTATOR        0x10    // 转台位置有效
+
+/**
+ * 状态广播数据包，固定布局，小端。字段顺序与track_udp.py一致，修改时同步更新版本号
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t seq;               // 每个包加一，接收方据此统计丢包
+    int64_t time_ms;            // 状态的UTC时间，毫秒
+    int32_t catnr;
+    float azi;                  // 度
+    float ele;
+    float range;                // km
+    float range_rate;           // km/s
+    float lat;                  // 度
+    float lon;
+    float alt;                  // km
+    float rot_azi;              // 转台目标位置，度
+    float rot_ele;
+} udp_state_packet_t;
+
+_Static_assert(sizeof(udp_state_packet_t) == 56, "udp_state_packet_t layout changed");
+
+typedef struct
+{
+    uint32_t sent;
+    uint32_t errors;            // sendto失败，未联网时也计入
+    uint32_t rate_hz;
+    int dest_count;
+} udp_stream_stats_t;
+
+/**
+ * @brief   按CONFIG_TALLNECK_UDP_STREAM_HZ向CONFIG_TALLNECK_UDP_STREAM_DEST中的
+ *          单播或组播地址发送状态包，发送开销与接收方数量无关
+ */
+void udp_stream_task(void *pvParameters);
+
+/**
+ * @brief   运行时修改发送频率，范围UDP_STREAM_MIN_HZ到UDP_STREAM_MAX_HZ
+ */
+esp_err_t udp_stream_set_rate(uint32_t hz);
+
+void udp_stream_get_stats(udp_stream_stats_t *stats);
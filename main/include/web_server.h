@@ -0,0 +1,19 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+#define CATALOG_UPLOAD_URI      "/catalog"
+#define CATALOG_UPLOAD_TMP_PATH "/littlefs/tle_eph.upload"
+#define CATALOG_UPLOAD_BLOCK    1024    // 每次从socket读取的块大小
+#define LATENCY_URI             "/latency"
+#define LATENCY_JSON_SIZE       1024
+
+/**
+ * @brief   启动设备上的HTTP服务器（端口CONFIG_TALLNECK_WEB_SERVER_PORT），
+ *          注册目录上传、轨迹上传、延迟统计和WebSocket跟踪推送接口，重复调用时直接返回
+ */
+esp_err_t web_server_start(void);
+
+void web_server_stop(void);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+#define WS_FEED_URI             "/ws"
+#define WS_FEED_PAGE_URI        "/live"     // 浏览器直接打开的简单显示页
+#define WS_FEED_MAX_CLIENTS     4
+#define WS_FEED_FRAME_SIZE      512
+#define WS_FEED_POLL_MS         50          // 检查状态总线是否有新数据的间隔
+#define WS_FEED_MAX_BACKOFF     4           // 慢客户端最低每16帧收到一帧
+
+typedef struct
+{
+    int clients;
+    uint32_t frames;            // 序列化的帧数
+    uint32_t sent;
+    uint32_t dropped;           // 客户端上一帧还没发完或发送缓冲已满而跳过的帧
+} ws_feed_stats_t;
+
+/**
+ * @brief   在server上注册WebSocket跟踪数据推送接口并启动推送任务，重复调用时直接返回
+ *          每个新状态只序列化一次，由HTTP服务器任务逐个客户端异步发送
+ */
+esp_err_t ws_feed_start(httpd_handle_t server);
+
+/**
+ * @brief   HTTP服务器的close_fn，会话关闭时释放客户端位置并关闭socket
+ */
+void ws_feed_on_close(httpd_handle_t hd, int sockfd);
+
+void ws_feed_get_stats(ws_feed_stats_t *stats);
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "arena.h"
+#include "mem_pool.h"
+
+#define ALIGN_UP(n)     (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+void arena_init(arena_t *arena, size_t block_size)
+{
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->total = 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    arena_block_t *block = arena->current;
+    size = ALIGN_UP(size ? size : 1);
+
+    if (block == NULL || block->size - block->used < size)
+    {
+        arena_block_t *next = block ? block->next : NULL;
+        if (next != NULL && next->size >= size)
+        {
+            // 复位前留下的块，进入时才清空
+            next->used = 0;
+            block = next;
+        }
+        else
+        {
+            // 超过块大小的请求单独占一块
+            size_t block_size = size > arena->block_size ? size : arena->block_size;
+            arena_block_t *grown = mem_heap_alloc(sizeof(arena_block_t) + block_size);
+            if (grown == NULL)
+            {
+                return NULL;
+            }
+            grown->size = block_size;
+            grown->used = 0;
+            grown->next = next;
+            if (block != NULL)
+            {
+                block->next = grown;
+            }
+            else
+            {
+                arena->first = grown;
+            }
+            arena->total += sizeof(arena_block_t) + block_size;
+            block = grown;
+        }
+        arena->current = block;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void *arena_calloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+char *arena_strdup(arena_t *arena, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *dup = arena_alloc(arena, len);
+    if (dup != NULL)
+    {
+        memcpy(dup, str, len);
+    }
+    return dup;
+}
+
+void arena_reset(arena_t *arena)
+{
+    if (arena->first != NULL)
+    {
+        arena->first->used = 0;
+    }
+    arena->current = arena->first;
+    mem_stats_note_arena_reset();
+}
+
+void arena_release(arena_t *arena)
+{
+    arena_block_t *block = arena->first;
+    while (block != NULL)
+    {
+        arena_block_t *next = block->next;
+        mem_heap_free(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->total = 0;
+}
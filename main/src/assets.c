@@ -0,0 +1,131 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "assets.h"
+
+#define TAG "assets"
+
+static const uint8_t *assets_base = NULL;
+static const assets_header_t *assets_hdr = NULL;
+static const assets_entry_t *assets_entries = NULL;
+static esp_partition_mmap_handle_t assets_map;
+
+esp_err_t assets_init(void)
+{
+    const esp_partition_t *part;
+    const void *ptr;
+    assets_header_t hdr;
+    esp_err_t err;
+
+    if (assets_base != NULL)
+    {
+        return ESP_OK;
+    }
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSETS_PARTITION_LABEL);
+    if (part == NULL)
+    {
+        ESP_LOGW(TAG, "No %s partition", ASSETS_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    err = esp_partition_read(part, 0, &hdr, sizeof(hdr));
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (hdr.magic != ASSETS_MAGIC || hdr.version != ASSETS_VERSION ||
+        hdr.total_size > part->size || hdr.total_size < sizeof(hdr) + hdr.count * sizeof(assets_entry_t))
+    {
+        ESP_LOGW(TAG, "Asset partition is empty or invalid");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 只映射镜像实际占用的部分，节省MMU页
+    err = esp_partition_mmap(part, 0, hdr.total_size, ESP_PARTITION_MMAP_DATA, &ptr, &assets_map);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map assets: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const assets_entry_t *entries = (const assets_entry_t *)((const uint8_t *)ptr + sizeof(hdr));
+    for (int i = 0; i < hdr.count; i++)
+    {
+        if (entries[i].offset > hdr.total_size || entries[i].size > hdr.total_size - entries[i].offset ||
+            memchr(entries[i].name, '\0', ASSETS_NAME_LEN) == NULL)
+        {
+            ESP_LOGE(TAG, "Corrupted asset entry %d", i);
+            esp_partition_munmap(assets_map);
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    assets_base = ptr;
+    assets_hdr = ptr;
+    assets_entries = entries;
+    ESP_LOGI(TAG, "Mapped %u assets, %lu bytes", hdr.count, (unsigned long)hdr.total_size);
+    return ESP_OK;
+}
+
+const void *assets_find(const char *name, size_t *size)
+{
+    if (assets_base == NULL)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < assets_hdr->count; i++)
+    {
+        if (strncmp(assets_entries[i].name, name, ASSETS_NAME_LEN) == 0)
+        {
+            if (size != NULL)
+            {
+                *size = assets_entries[i].size;
+            }
+            return assets_base + assets_entries[i].offset;
+        }
+    }
+    return NULL;
+}
+
+bool assets_image(const char *name, lv_img_dsc_t *dsc)
+{
+    size_t size;
+    const uint8_t *data = assets_find(name, &size);
+    if (data == NULL || size <= sizeof(lv_img_header_t))
+    {
+        return false;
+    }
+    memcpy(&dsc->header, data, sizeof(lv_img_header_t));
+    dsc->data = data + sizeof(lv_img_header_t);
+    dsc->data_size = size - sizeof(lv_img_header_t);
+    return true;
+}
+
+FILE *assets_fopen(const char *name)
+{
+    size_t size;
+    const void *data = assets_find(name, &size);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+    // 只读打开，不会写入映射区域
+    return fmemopen((void *)data, size, "r");
+}
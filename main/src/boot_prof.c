@@ -0,0 +1,135 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "boot_prof.h"
+
+#define TAG "boot_prof"
+
+static boot_prof_event_t events[BOOT_PROF_MAX_EVENTS];
+static int event_count = 0;
+static portMUX_TYPE prof_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t boot_events = NULL;
+
+static int add_event(const char *name, int64_t now, bool milestone)
+{
+    int id = -1;
+    taskENTER_CRITICAL(&prof_lock);
+    if (milestone)
+    {
+        for (int i = 0; i < event_count; i++)
+        {
+            if (events[i].start_us == events[i].end_us && strcmp(events[i].name, name) == 0)
+            {
+                taskEXIT_CRITICAL(&prof_lock);
+                return -1;
+            }
+        }
+    }
+    if (event_count < BOOT_PROF_MAX_EVENTS)
+    {
+        id = event_count++;
+        events[id].name = name;
+        events[id].start_us = now;
+        events[id].end_us = milestone ? now : 0;
+        events[id].core = xPortGetCoreID();
+    }
+    taskEXIT_CRITICAL(&prof_lock);
+    return id;
+}
+
+void boot_prof_init(void)
+{
+    boot_events = xEventGroupCreate();
+    if (boot_events == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create boot event group");
+    }
+    add_event("app_main", esp_timer_get_time(), true);
+}
+
+int boot_prof_begin(const char *name)
+{
+    return add_event(name, esp_timer_get_time(), false);
+}
+
+void boot_prof_end(int id)
+{
+    if (id < 0 || id >= BOOT_PROF_MAX_EVENTS)
+    {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&prof_lock);
+    events[id].end_us = now;
+    taskEXIT_CRITICAL(&prof_lock);
+}
+
+void boot_prof_mark(const char *name)
+{
+    int64_t now = esp_timer_get_time();
+    if (add_event(name, now, true) >= 0)
+    {
+        ESP_LOGI(TAG, "%s at %lld ms", name, now / 1000);
+    }
+}
+
+void boot_stage_done(EventBits_t stages)
+{
+    if (boot_events != NULL)
+    {
+        xEventGroupSetBits(boot_events, stages);
+    }
+}
+
+void boot_stage_wait(EventBits_t stages)
+{
+    if (boot_events != NULL)
+    {
+        xEventGroupWaitBits(boot_events, stages, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+}
+
+void boot_prof_report(void)
+{
+    boot_prof_event_t snap[BOOT_PROF_MAX_EVENTS];
+    taskENTER_CRITICAL(&prof_lock);
+    int count = event_count;
+    memcpy(snap, events, count * sizeof(snap[0]));
+    taskEXIT_CRITICAL(&prof_lock);
+
+    printf("%-16s %10s %10s %10s  core\n", "stage", "start ms", "end ms", "took ms");
+    for (int i = 0; i < count; i++)
+    {
+        boot_prof_event_t *e = &snap[i];
+        if (e->start_us == e->end_us)
+        {
+            printf("%-16s %10.1f %10s %10s  %d\n", e->name, e->start_us / 1000.0, "-", "-", e->core);
+        }
+        else if (e->end_us == 0)
+        {
+            printf("%-16s %10.1f %10s %10s  %d\n", e->name, e->start_us / 1000.0, "running", "-", e->core);
+        }
+        else
+        {
+            printf("%-16s %10.1f %10.1f %10.1f  %d\n", e->name, e->start_us / 1000.0,
+                   e->end_us / 1000.0, (e->end_us - e->start_us) / 1000.0, e->core);
+        }
+    }
+}
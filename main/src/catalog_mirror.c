@@ -0,0 +1,496 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+
+#include "catalog_mirror.h"
+#include "get_tle.h"
+#include "http_session.h"
+#include "trsp_update.h"
+#include "nxjson.h"
+#include "sgp4sdp4.h"
+#include "assets.h"
+#include "boot_prof.h"
+
+#define TAG "catalog_mirror"
+
+#define MIRROR_URL_LEN      192
+#define TLE_LINE_LEN        130
+#define CATALOG_TMP_SUFFIX  ".tmp"
+#define CATALOG_COPY_BLOCK  512
+
+static volatile uint32_t catalog_gen = 0;
+
+uint32_t catalog_generation(void)
+{
+    return catalog_gen;
+}
+
+uint32_t catalog_mirror_get_version(void)
+{
+    unsigned long version = 0;
+    FILE *fp = fopen(CATALOG_VERSION_PATH, "r");
+    if (fp != NULL)
+    {
+        if (fscanf(fp, "%lu", &version) != 1)
+        {
+            version = 0;
+        }
+        fclose(fp);
+    }
+    return version;
+}
+
+void catalog_mirror_set_version(uint32_t version)
+{
+    FILE *fp = fopen(CATALOG_VERSION_PATH, "w");
+    if (fp == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open the catalog version file.");
+        return;
+    }
+    fprintf(fp, "%lu\n", (unsigned long)version);
+    fclose(fp);
+}
+
+static int compare_catnr(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+// TLE第一行的第3-7列为编号
+static int tle_line_catnr(const char *line)
+{
+    char buff[6];
+    strncpy(buff, &line[2], 5);
+    buff[5] = '\0';
+    return atoi(buff);
+}
+
+static bool is_tle_line(const char *line, char number)
+{
+    return line[0] == number && line[1] == ' ' && strlen(line) > 60;
+}
+
+// update_tle.py在目录末尾追加一行"YYYY-mm-dd HH:MM:SS"更新时间
+static bool is_update_stamp(const char *line)
+{
+    int y, mo, d, h, mi, sec, n = 0;
+
+    if (sscanf(line, "%4d-%2d-%2d %2d:%2d:%2d%n", &y, &mo, &d, &h, &mi, &sec, &n) != 6 || n != 19)
+        return false;
+    return line[n] == '\0' || line[n] == '\r' || line[n] == '\n';
+}
+
+// 收集增量包中涉及的全部编号（删除和替换），排序后用于二分查找
+static int *collect_delta_catnrs(FILE *delta, size_t *count)
+{
+    char line[TLE_LINE_LEN];
+    size_t cap = 64, n = 0;
+    int *catnrs = malloc(cap * sizeof(int));
+    if (catnrs == NULL)
+    {
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), delta))
+    {
+        int catnr = -1;
+        if (line[0] == '-')
+            catnr = atoi(&line[1]);
+        else if (is_tle_line(line, '1'))
+            catnr = tle_line_catnr(line);
+        if (catnr < 0)
+            continue;
+
+        if (n == cap)
+        {
+            int *grown = realloc(catnrs, cap * 2 * sizeof(int));
+            if (grown == NULL)
+            {
+                free(catnrs);
+                return NULL;
+            }
+            catnrs = grown;
+            cap *= 2;
+        }
+        catnrs[n++] = catnr;
+    }
+    qsort(catnrs, n, sizeof(int), compare_catnr);
+    *count = n;
+    return catnrs;
+}
+
+esp_err_t catalog_apply_delta(const char *catalog_path, const char *delta_path)
+{
+    char tmp_path[64];
+    char lines[3][TLE_LINE_LEN];
+    int filled = 0, kept = 0, added = 0;
+    size_t count = 0;
+    esp_err_t ret = ESP_OK;
+
+    FILE *delta = fopen(delta_path, "r");
+    if (delta == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    int *catnrs = collect_delta_catnrs(delta, &count);
+    if (catnrs == NULL)
+    {
+        fclose(delta);
+        return ESP_ERR_NO_MEM;
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", catalog_path, CATALOG_TMP_SUFFIX);
+    FILE *in = fopen(catalog_path, "r");
+    FILE *out = fopen(tmp_path, "w");
+    if (in == NULL || out == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open the catalog for merging");
+        ret = ESP_FAIL;
+        goto CLEAN_UP;
+    }
+
+    // 以三行为窗口扫描原目录，未被增量包涉及的TLE原样保留
+    while (fgets(lines[filled], TLE_LINE_LEN, in))
+    {
+        if (lines[filled][0] == '\n' || lines[filled][0] == '\r')
+            continue;
+        if (++filled < 3)
+            continue;
+
+        if (is_tle_line(lines[1], '1') && is_tle_line(lines[2], '2'))
+        {
+            int catnr = tle_line_catnr(lines[1]);
+            if (bsearch(&catnr, catnrs, count, sizeof(int), compare_catnr) == NULL)
+            {
+                fputs(lines[0], out);
+                fputs(lines[1], out);
+                fputs(lines[2], out);
+                kept++;
+            }
+            filled = 0;
+        }
+        else
+        {
+            // 窗口没有对齐到一组TLE，丢弃第一行继续
+            memmove(lines[0], lines[1], sizeof(lines[0]) * 2);
+            filled = 2;
+        }
+    }
+
+    // 追加增量包中的新TLE
+    rewind(delta);
+    while (fgets(lines[0], TLE_LINE_LEN, delta))
+    {
+        if (lines[0][0] == '-' || lines[0][0] == '\n')
+            continue;
+        fputs(lines[0], out);
+        if (is_tle_line(lines[0], '1'))
+            added++;
+    }
+    if (ferror(out))
+    {
+        ret = ESP_FAIL;
+    }
+
+CLEAN_UP:
+    if (in != NULL)
+        fclose(in);
+    if (out != NULL)
+        fclose(out);
+    fclose(delta);
+    free(catnrs);
+
+    if (ret == ESP_OK)
+    {
+        remove(catalog_path);
+        if (rename(tmp_path, catalog_path) != 0)
+        {
+            ESP_LOGE(TAG, "Failed to replace %s", catalog_path);
+            ret = ESP_FAIL;
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Delta merged: %d satellites kept, %d added or replaced", kept, added);
+        }
+    }
+    else
+    {
+        remove(tmp_path);
+    }
+    return ret;
+}
+
+int catalog_validate(const char *path)
+{
+    char lines[3][TLE_LINE_LEN];
+    char tle_set[139];
+    int filled = 0, count = 0, line_no = 0;
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    while (fgets(lines[filled], TLE_LINE_LEN, fp))
+    {
+        line_no++;
+        if (lines[filled][0] == '\n' || lines[filled][0] == '\r')
+            continue;
+        // 更新时间行在最后一组TLE之后，出现在名称行的位置上
+        if (filled == 0 && is_update_stamp(lines[0]))
+            continue;
+        if (++filled < 3)
+            continue;
+
+        // 与Input_Tle_Set相同的拼接方式：第一行占0-68，第二行从69开始
+        // Good_Elements同时检查了行号和校验和
+        memcpy(tle_set, lines[1], 69);
+        memcpy(&tle_set[69], lines[2], 69);
+        tle_set[138] = '\0';
+        if (strlen(lines[1]) < 69 || strlen(lines[2]) < 69 || !Good_Elements(tle_set))
+        {
+            ESP_LOGE(TAG, "Invalid TLE set ending at line %d", line_no);
+            fclose(fp);
+            return -1;
+        }
+        count++;
+        filled = 0;
+    }
+    fclose(fp);
+
+    if (filled != 0)
+    {
+        ESP_LOGE(TAG, "Truncated TLE set at the end of %s", path);
+        return -1;
+    }
+    return count > 0 ? count : -1;
+}
+
+esp_err_t catalog_install(const char *tmp_path, const char *dest_path, int *count)
+{
+    int sets = catalog_validate(tmp_path);
+    if (count != NULL)
+    {
+        *count = sets;
+    }
+    if (sets < 0)
+    {
+        remove(tmp_path);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // littlefs的rename会原子地覆盖目标，跟踪任务要么读到旧目录要么读到新目录
+    if (rename(tmp_path, dest_path) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to replace %s", dest_path);
+        remove(tmp_path);
+        return ESP_FAIL;
+    }
+    catalog_gen++;
+    ESP_LOGI(TAG, "Installed %d TLE sets into %s", sets, dest_path);
+    return ESP_OK;
+}
+
+esp_err_t catalog_publish(const char *src_path, const char *dest_path)
+{
+    char tmp_path[64];
+    char block[CATALOG_COPY_BLOCK];
+    size_t n;
+    esp_err_t ret = ESP_OK;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", dest_path, CATALOG_TMP_SUFFIX);
+    FILE *in = fopen(src_path, "r");
+    if (in == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FILE *out = fopen(tmp_path, "w");
+    if (out == NULL)
+    {
+        fclose(in);
+        return ESP_FAIL;
+    }
+    while ((n = fread(block, 1, sizeof(block), in)) > 0)
+    {
+        if (fwrite(block, 1, n, out) != n)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+    }
+    fclose(in);
+    if (fclose(out) != 0 || ret != ESP_OK)
+    {
+        remove(tmp_path);
+        return ESP_FAIL;
+    }
+    return catalog_install(tmp_path, dest_path, NULL);
+}
+
+// 读取镜像清单，nxjson会原地修改文本，因此整体读入内存（清单只有几百字节）
+static char *read_manifest(void)
+{
+    FILE *fp = fopen(MIRROR_MANIFEST_PATH, "r");
+    if (fp == NULL)
+    {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+    char *text = (len > 0) ? malloc(len + 1) : NULL;
+    if (text != NULL)
+    {
+        if (fread(text, 1, len, fp) != len)
+        {
+            free(text);
+            text = NULL;
+        }
+        else
+        {
+            text[len] = '\0';
+        }
+    }
+    fclose(fp);
+    return text;
+}
+
+static esp_err_t mirror_download(const char *base, const char *path, const char *dest)
+{
+    char url[MIRROR_URL_LEN];
+    if (snprintf(url, sizeof(url), "%s%s", base, path) >= sizeof(url))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    http_download_ctx_t dl = { .path = dest };
+    return http_session_download(url, &dl);
+}
+
+esp_err_t catalog_mirror_refresh(void)
+{
+    const char *base = CONFIG_TALLNECK_MIRROR_URL;
+    char local_str[12];
+    esp_err_t err;
+
+    if (base[0] == '\0')
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    err = mirror_download(base, "/manifest.json", MIRROR_MANIFEST_PATH);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Mirror %s unreachable", base);
+        return err;
+    }
+
+    char *text = read_manifest();
+    const nx_json *manifest = text ? nx_json_parse(text, 0) : NULL;
+    if (manifest == NULL)
+    {
+        ESP_LOGE(TAG, "Invalid mirror manifest");
+        free(text);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint32_t version = nx_json_get(manifest, "version")->int_value;
+    uint32_t local = catalog_mirror_get_version();
+    if (version == 0)
+    {
+        err = ESP_ERR_INVALID_RESPONSE;
+        goto CLEAN_UP;
+    }
+    if (version == local)
+    {
+        ESP_LOGI(TAG, "Catalog already at mirror version %lu", (unsigned long)version);
+        goto CLEAN_UP;
+    }
+
+    // 优先下载增量包，本地版本过旧或来自上游时下载完整包
+    snprintf(local_str, sizeof(local_str), "%lu", (unsigned long)local);
+    const nx_json *delta = nx_json_get(nx_json_get(manifest, "deltas"), local_str);
+    err = ESP_FAIL;
+    if (local != 0 && delta->type == NX_JSON_STRING)
+    {
+        err = mirror_download(base, delta->text_value, MIRROR_DELTA_PATH);
+        if (err == ESP_OK)
+        {
+            err = catalog_apply_delta(FILE_PATH, MIRROR_DELTA_PATH);
+        }
+        remove(MIRROR_DELTA_PATH);
+        ESP_LOGI(TAG, "Delta %lu -> %lu: %s", (unsigned long)local, (unsigned long)version, esp_err_to_name(err));
+    }
+    const nx_json *full = nx_json_get(manifest, "tle");
+    if (err != ESP_OK && full->type == NX_JSON_STRING)
+    {
+        // 先下载到临时文件，校验通过后再替换，下载中断时保留原目录
+        char tmp_path[64];
+        snprintf(tmp_path, sizeof(tmp_path), "%s%s", FILE_PATH, CATALOG_TMP_SUFFIX);
+        err = mirror_download(base, full->text_value, tmp_path);
+        if (err == ESP_OK)
+        {
+            err = catalog_install(tmp_path, FILE_PATH, NULL);
+        }
+        else
+        {
+            remove(tmp_path);
+        }
+    }
+    if (err != ESP_OK)
+    {
+        goto CLEAN_UP;
+    }
+
+    // 转发器列表只有完整包
+    const nx_json *trsp = nx_json_get(manifest, "trsp");
+    if (trsp->type == NX_JSON_STRING)
+    {
+        char url[MIRROR_URL_LEN];
+        snprintf(url, sizeof(url), "%s%s", base, trsp->text_value);
+        if (!download_trsp_data_from(url))
+        {
+            ESP_LOGW(TAG, "Transponder package from the mirror failed");
+        }
+    }
+
+    catalog_mirror_set_version(version);
+    ESP_LOGI(TAG, "Catalog updated to mirror version %lu", (unsigned long)version);
+
+CLEAN_UP:
+    nx_json_free(manifest);
+    free(text);
+    return err;
+}
+
+FILE *catalog_open(void)
+{
+    boot_stage_wait(BOOT_STAGE_STORAGE);  // 跟踪任务在文件系统挂载前就已启动
+    FILE *fp = fopen(FLASH_FILE_PATH, "r");
+    if (fp == NULL)
+    {
+        fp = assets_fopen(ASSET_CATALOG);
+        if (fp != NULL)
+        {
+            ESP_LOGW(TAG, "%s missing, using the factory catalog", FLASH_FILE_PATH);
+        }
+    }
+    return fp;
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gs232.h"
+#include "setpoint.h"
+
+#define TAG "gs232"
+
+#define GS232_UART              CONFIG_TALLNECK_GS232_UART_NUM
+#define GS232_REPLY_EOM         "\r\n"
+#define GS232_REPLY_ERROR       "?>" GS232_REPLY_EOM
+#if CONFIG_TALLNECK_GS232_B
+#define GS232_DIALECT           "B"
+#else
+#define GS232_DIALECT           "A"
+#endif
+
+static gs232_stats_t stats;
+
+// 最近一次投递的目标位置，不限来源。转台没有位置反馈，C/C2/B以此作答
+static void rotator_last(int *az, int *el)
+{
+    rot_setpoint_t sp;
+    if (setpoint_last(&sp))
+    {
+        *az = (int)(sp.azimuth + 0.5f);
+        *el = (int)(sp.elevation + 0.5f);
+    }
+    else
+    {
+        *az = 0;
+        *el = 0;
+    }
+}
+
+// 把450度方位和180度仰角换算到转台的0-360、0-90后投递
+static void rotator_send(int az, int el, int64_t recv_us)
+{
+    if (el > 90)
+    {
+        el = 180 - el;
+        az += 180;
+    }
+    az %= 360;
+    setpoint_post_stamped(az, el, SETPOINT_SRC_SERIAL, recv_us, esp_timer_get_time());
+}
+
+static int reply_position(char *reply, size_t size, bool with_az, bool with_el)
+{
+    int az, el;
+    rotator_last(&az, &el);
+#if CONFIG_TALLNECK_GS232_B
+    if (with_az && with_el)
+    {
+        return snprintf(reply, size, "AZ=%03d  EL=%03d" GS232_REPLY_EOM, az, el);
+    }
+    return snprintf(reply, size, "%s=%03d" GS232_REPLY_EOM, with_az ? "AZ" : "EL", with_az ? az : el);
+#else
+    if (with_az && with_el)
+    {
+        return snprintf(reply, size, "+0%03d+0%03d" GS232_REPLY_EOM, az, el);
+    }
+    return snprintf(reply, size, "+0%03d" GS232_REPLY_EOM, with_az ? az : el);
+#endif
+}
+
+int gs232_exec(const char *line, int64_t recv_us, char *reply, size_t size)
+{
+    int az, el, rot_az, rot_el;
+    char cmd[GS232_LINE_LEN];
+    size_t len = 0;
+
+    // 命令不区分大小写，PstRotator等软件有时在数字之间不加空格
+    while (*line == ' ')
+    {
+        line++;
+    }
+    for (; line[len] != '\0' && len < sizeof(cmd) - 1; len++)
+    {
+        cmd[len] = toupper((unsigned char)line[len]);
+    }
+    cmd[len] = '\0';
+    if (len == 0)
+    {
+        return 0;
+    }
+    stats.commands++;
+
+    switch (cmd[0])
+    {
+        // Waaa eee，转到指定方位和仰角
+        case 'W':
+            if (sscanf(cmd + 1, "%d %d", &az, &el) != 2 ||
+                az < 0 || az > GS232_MAX_AZ || el < 0 || el > GS232_MAX_EL)
+            {
+                break;
+            }
+            rotator_send(az, el, recv_us);
+            return 0;
+        // Maaa，只转方位
+        case 'M':
+            if (sscanf(cmd + 1, "%d", &az) != 1 || az < 0 || az > GS232_MAX_AZ)
+            {
+                break;
+            }
+            rotator_last(&rot_az, &rot_el);
+            rotator_send(az, rot_el, recv_us);
+            return 0;
+        // C为方位，C2为方位和仰角
+        case 'C':
+            if (cmd[1] == '\0')
+            {
+                return reply_position(reply, size, true, false);
+            }
+            if (strcmp(cmd, "C2") == 0)
+            {
+                return reply_position(reply, size, true, true);
+            }
+            break;
+        case 'B':
+            if (cmd[1] == '\0')
+            {
+                return reply_position(reply, size, false, true);
+            }
+            break;
+        // 全部停止、方位停止、仰角停止。没有位置反馈，停止即保持在最近的目标位置
+        case 'S':
+        case 'A':
+        case 'E':
+            if (cmd[1] != '\0')
+            {
+                break;
+            }
+            rotator_last(&rot_az, &rot_el);
+            rotator_send(rot_az, rot_el, recv_us);
+            return 0;
+        // 连续转动，转台转速固定，转到限位，由S停止
+        case 'R':
+        case 'L':
+        case 'U':
+        case 'D':
+            if (cmd[1] != '\0')
+            {
+                break;
+            }
+            rotator_last(&rot_az, &rot_el);
+            if (cmd[0] == 'R')
+            {
+                rotator_send(359, rot_el, recv_us);
+            }
+            else if (cmd[0] == 'L')
+            {
+                rotator_send(0, rot_el, recv_us);
+            }
+            else
+            {
+                rotator_send(rot_az, cmd[0] == 'U' ? 90 : 0, recv_us);
+            }
+            return 0;
+        // 速度选择X1-X4、360/450度模式P36/P45、校准O/F/O2/F2、南北中心Z，转台不支持，接受后忽略
+        case 'X':
+        case 'P':
+        case 'O':
+        case 'F':
+        case 'Z':
+            return 0;
+        default:
+            break;
+    }
+
+    stats.errors++;
+    ESP_LOGD(TAG, "Unknown command: %s", cmd);
+    return snprintf(reply, size, GS232_REPLY_ERROR);
+}
+
+void gs232_get_stats(gs232_stats_t *out)
+{
+    *out = stats;
+}
+
+void gs232_task(void *pvParameters)
+{
+    QueueHandle_t uart_queue;
+    uart_event_t event;
+    uint8_t rx[GS232_RX_BUF_SIZE];
+    char line[GS232_LINE_LEN];
+    char reply[GS232_REPLY_LEN];
+    size_t len = 0;
+    bool overflow = false;
+
+    uart_config_t uart_config = {
+        .baud_rate = CONFIG_TALLNECK_GS232_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity    = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    int intr_alloc_flags = 0;
+
+#if CONFIG_UART_ISR_IN_IRAM
+    intr_alloc_flags = ESP_INTR_FLAG_IRAM;
+#endif
+
+#if GS232_UART == 0
+    // 与控制台共用UART0，关闭日志，避免打乱回复
+    ESP_LOGW(TAG, "UART0 handed over to GS-232, logging disabled");
+    esp_log_level_set("*", ESP_LOG_NONE);
+#endif
+    // 不使用发送缓冲，回复很短，直接写入硬件FIFO后返回
+    ESP_ERROR_CHECK(uart_driver_install(GS232_UART, GS232_RX_BUF_SIZE, 0, GS232_EVENT_QUEUE_LEN, &uart_queue, intr_alloc_flags));
+    ESP_ERROR_CHECK(uart_param_config(GS232_UART, &uart_config));
+#if GS232_UART != 0
+    ESP_ERROR_CHECK(uart_set_pin(GS232_UART, CONFIG_TALLNECK_GS232_TXD, CONFIG_TALLNECK_GS232_RXD,
+                                 UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+#endif
+    // 默认的接收超时约为10个字符时间，缩短后命令的最后几个字节能更快送到任务
+    ESP_ERROR_CHECK(uart_set_rx_timeout(GS232_UART, GS232_RX_TIMEOUT));
+    ESP_LOGI(TAG, "GS-232" GS232_DIALECT " on UART%d, %d baud", GS232_UART, CONFIG_TALLNECK_GS232_BAUD);
+
+    while (1)
+    {
+        if (xQueueReceive(uart_queue, &event, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        switch (event.type)
+        {
+            case UART_DATA:
+            {
+                int64_t recv_us = esp_timer_get_time();
+                int n = uart_read_bytes(GS232_UART, rx, MIN(event.size, sizeof(rx)), 0);
+                for (int i = 0; i < n; i++)
+                {
+                    // 以CR结束一条命令，也接受LF
+                    if (rx[i] == '\r' || rx[i] == '\n')
+                    {
+                        int reply_len = 0;
+                        if (overflow)
+                        {
+                            stats.overflows++;
+                            reply_len = snprintf(reply, sizeof(reply), GS232_REPLY_ERROR);
+                        }
+                        else if (len > 0)
+                        {
+                            line[len] = '\0';
+                            reply_len = gs232_exec(line, recv_us, reply, sizeof(reply));
+                        }
+                        if (reply_len > 0)
+                        {
+                            uart_write_bytes(GS232_UART, reply, MIN(reply_len, sizeof(reply) - 1));
+                        }
+                        len = 0;
+                        overflow = false;
+                    }
+                    else if (len < sizeof(line) - 1)
+                    {
+                        line[len++] = rx[i];
+                    }
+                    else
+                    {
+                        overflow = true;
+                    }
+                }
+                break;
+            }
+            // 接收溢出时丢弃已收到的数据，从下一条命令重新开始
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "RX overflow");
+                uart_flush_input(GS232_UART);
+                xQueueReset(uart_queue);
+                stats.overflows++;
+                len = 0;
+                overflow = false;
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "hash_map.h"
+
+#define HASH_MAP_MIN_CAPACITY   16
+
+// murmur3的最终混合步骤，连续的编号也能均匀分布
+static uint32_t hash_int(int32_t key)
+{
+    uint32_t h = (uint32_t)key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h ? h : 1;
+}
+
+// FNV-1a
+static uint32_t hash_str(const char *key)
+{
+    uint32_t h = 2166136261u;
+    while (*key)
+    {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+static bool key_equals(const hash_map_t *map, const hash_map_entry_t *e, uint32_t hash, int32_t ikey, const char *skey)
+{
+    if (e->hash != hash)
+    {
+        return false;
+    }
+    return map->type == HASH_MAP_KEY_INT ? e->key.i == ikey : strcmp(e->key.s, skey) == 0;
+}
+
+// 槽位到理想位置的距离
+static uint32_t probe_distance(const hash_map_t *map, uint32_t hash, uint32_t slot)
+{
+    return (slot - (hash & (map->capacity - 1))) & (map->capacity - 1);
+}
+
+// 插入一个确定不存在的元素：探测距离更短的元素让位给距离更长的（robin hood）
+static void insert_entry(hash_map_t *map, hash_map_entry_t entry)
+{
+    uint32_t mask = map->capacity - 1;
+    uint32_t slot = entry.hash & mask;
+    uint32_t dist = 0;
+
+    while (map->entries[slot].hash != 0)
+    {
+        uint32_t existing = probe_distance(map, map->entries[slot].hash, slot);
+        if (existing < dist)
+        {
+            hash_map_entry_t tmp = map->entries[slot];
+            map->entries[slot] = entry;
+            entry = tmp;
+            dist = existing;
+        }
+        slot = (slot + 1) & mask;
+        dist++;
+    }
+    map->entries[slot] = entry;
+    map->count++;
+}
+
+static esp_err_t alloc_entries(hash_map_t *map, uint32_t capacity)
+{
+    hash_map_entry_t *entries = arena_calloc(map->arena, capacity * sizeof(hash_map_entry_t));
+    if (entries == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    map->entries = entries;
+    map->capacity = capacity;
+    map->count = 0;
+    return ESP_OK;
+}
+
+static esp_err_t grow(hash_map_t *map)
+{
+    hash_map_entry_t *old = map->entries;
+    uint32_t old_capacity = map->capacity;
+
+    esp_err_t err = alloc_entries(map, old_capacity * 2);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    for (uint32_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i].hash != 0)
+        {
+            insert_entry(map, old[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+static hash_map_entry_t *find(const hash_map_t *map, uint32_t hash, int32_t ikey, const char *skey)
+{
+    uint32_t mask = map->capacity - 1;
+    uint32_t slot = hash & mask;
+
+    for (uint32_t dist = 0; ; dist++)
+    {
+        hash_map_entry_t *e = &map->entries[slot];
+        // 遇到空槽或距离比当前更短的元素，说明键不存在
+        if (e->hash == 0 || probe_distance(map, e->hash, slot) < dist)
+        {
+            return NULL;
+        }
+        if (key_equals(map, e, hash, ikey, skey))
+        {
+            return e;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+static esp_err_t put(hash_map_t *map, uint32_t hash, int32_t ikey, const char *skey, void *value)
+{
+    hash_map_entry_t *e = find(map, hash, ikey, skey);
+    if (e != NULL)
+    {
+        e->value = value;
+        return ESP_OK;
+    }
+
+    if ((map->count + 1) * 4 > map->capacity * 3)
+    {
+        esp_err_t err = grow(map);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    hash_map_entry_t entry = { .hash = hash, .value = value };
+    if (map->type == HASH_MAP_KEY_INT)
+    {
+        entry.key.i = ikey;
+    }
+    else
+    {
+        entry.key.s = arena_strdup(map->arena, skey);
+        if (entry.key.s == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    insert_entry(map, entry);
+    return ESP_OK;
+}
+
+esp_err_t hash_map_init(hash_map_t *map, arena_t *arena, hash_map_key_type_t type, uint32_t capacity)
+{
+    uint32_t cap = HASH_MAP_MIN_CAPACITY;
+    // 按3/4负载换算成2的幂
+    while (cap * 3 < capacity * 4)
+    {
+        cap <<= 1;
+    }
+    map->arena = arena;
+    map->type = type;
+    return alloc_entries(map, cap);
+}
+
+esp_err_t hash_map_put_int(hash_map_t *map, int32_t key, void *value)
+{
+    return put(map, hash_int(key), key, NULL, value);
+}
+
+esp_err_t hash_map_put_str(hash_map_t *map, const char *key, void *value)
+{
+    return put(map, hash_str(key), 0, key, value);
+}
+
+void *hash_map_get_int(const hash_map_t *map, int32_t key)
+{
+    hash_map_entry_t *e = find(map, hash_int(key), key, NULL);
+    return e ? e->value : NULL;
+}
+
+void *hash_map_get_str(const hash_map_t *map, const char *key)
+{
+    hash_map_entry_t *e = find(map, hash_str(key), 0, key);
+    return e ? e->value : NULL;
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "http_session.h"
+
+#define TAG "http_session"
+
+static http_session_t sessions[HTTP_SESSION_MAX_HOSTS];
+static SemaphoreHandle_t session_mux = NULL;
+
+// 写入目标文件的解压输出回调
+static esp_err_t download_file_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    http_download_ctx_t *dl = (http_download_ctx_t *)ctx;
+    if (fwrite(data, 1, len, dl->fp) != len)
+    {
+        ESP_LOGE(TAG, "Failed to write %s", dl->path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t http_session_event_handler(esp_http_client_event_t *evt)
+{
+    http_download_ctx_t *dl = (http_download_ctx_t *)evt->user_data;
+    if (dl == NULL)
+    {
+        return ESP_OK;
+    }
+    switch(evt->event_id)
+    {
+        // 每次发出请求（包括重定向）时复位，以最终响应的头部为准
+        case HTTP_EVENT_HEADERS_SENT:
+            dl->encoding = INFLATE_ENCODING_IDENTITY;
+            break;
+        // 响应头部，记录服务器实际使用的压缩格式
+        case HTTP_EVENT_ON_HEADER:
+            if (strcasecmp(evt->header_key, "Content-Encoding") == 0)
+            {
+                dl->encoding = inflate_encoding_from_header(evt->header_value);
+            }
+            break;
+        // HTTP_EVENT_ON_DATA事件在接收到HTTP响应的数据时触发，它可能会被多次触发，每次接受到一部分数据的时候都会执行
+        // 分块传输和普通响应都在这里边收边解压，直接写入文件，不再整体缓存响应
+        case HTTP_EVENT_ON_DATA:
+            if (esp_http_client_get_status_code(evt->client) != 200 || dl->err != ESP_OK)
+            {
+                break;
+            }
+            if (!dl->started)
+            {
+                dl->started = true;
+                if (dl->sink != NULL)
+                {
+                    dl->err = inflate_stream_init(&dl->inflater, dl->encoding, dl->sink, dl->sink_ctx);
+                    if (dl->err != ESP_OK)
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    dl->fp = fopen(dl->path, dl->append ? "a" : "w");
+                    if (dl->fp == NULL)
+                    {
+                        ESP_LOGE(TAG, "Failed to open file for writing");
+                        dl->err = ESP_FAIL;
+                        break;
+                    }
+                    dl->err = inflate_stream_init(&dl->inflater, dl->encoding, download_file_sink, dl);
+                    if (dl->err != ESP_OK)
+                    {
+                        break;
+                    }
+                    ESP_LOGI(TAG, "Writing data to %s (%s).", dl->path,
+                             dl->encoding == INFLATE_ENCODING_IDENTITY ? "identity" : "compressed");
+                }
+            }
+            dl->err = inflate_stream_feed(&dl->inflater, evt->data, evt->data_len);
+            break;
+        // HTTP_EVENT_ON_FINISH事件
+        case HTTP_EVENT_ON_FINISH:
+            if (dl->started && dl->err == ESP_OK)
+            {
+                dl->err = inflate_stream_finish(&dl->inflater);
+            }
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+// 取出url中的scheme://host[:port]部分，作为会话的索引
+static bool url_host(const char *url, char *host, size_t size)
+{
+    const char *p = strstr(url, "://");
+    if (p == NULL)
+    {
+        return false;
+    }
+    p += 3;
+    size_t len = strcspn(p, "/?#") + (p - url);
+    if (len >= size)
+    {
+        return false;
+    }
+    memcpy(host, url, len);
+    host[len] = '\0';
+    return true;
+}
+
+static http_session_t *session_acquire(const char *url)
+{
+    char host[HTTP_SESSION_HOST_LEN];
+    http_session_t *free_slot = NULL;
+
+    if (!url_host(url, host, sizeof(host)))
+    {
+        ESP_LOGE(TAG, "Invalid url: %s", url);
+        return NULL;
+    }
+
+    for (int i = 0; i < HTTP_SESSION_MAX_HOSTS; i++)
+    {
+        if (sessions[i].client != NULL && strcmp(sessions[i].host, host) == 0)
+        {
+            esp_http_client_set_url(sessions[i].client, url);
+            return &sessions[i];
+        }
+        if (sessions[i].client == NULL && free_slot == NULL)
+        {
+            free_slot = &sessions[i];
+        }
+    }
+
+    // 会话表已满时淘汰请求次数最少的主机
+    if (free_slot == NULL)
+    {
+        free_slot = &sessions[0];
+        for (int i = 1; i < HTTP_SESSION_MAX_HOSTS; i++)
+        {
+            if (sessions[i].requests < free_slot->requests)
+            {
+                free_slot = &sessions[i];
+            }
+        }
+        esp_http_client_cleanup(free_slot->client);
+        free_slot->client = NULL;
+    }
+
+    bool is_https = strncasecmp(url, "https", 5) == 0;
+    esp_http_client_config_t config =
+    {
+        .url = url,
+        .cert_pem = NULL,
+        .skip_cert_common_name_check = true,
+        .transport_type = is_https ? HTTP_TRANSPORT_OVER_SSL : HTTP_TRANSPORT_OVER_TCP,
+        .crt_bundle_attach = is_https ? esp_crt_bundle_attach : NULL,
+        .event_handler = http_session_event_handler,
+        .keep_alive_enable = true,  // TCP保活，刷新期间空闲连接断开能及时发现
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true,  // 重连时用会话票据恢复，不再完整握手
+#endif
+    };
+
+    free_slot->client = esp_http_client_init(&config);
+    if (free_slot->client == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client for %s", host);
+        return NULL;
+    }
+    strlcpy(free_slot->host, host, sizeof(free_slot->host));
+    free_slot->requests = 0;
+    ESP_LOGI(TAG, "New session for %s", host);
+    return free_slot;
+}
+
+esp_err_t http_session_init(void)
+{
+    if (session_mux == NULL)
+    {
+        session_mux = xSemaphoreCreateMutex();
+    }
+    return session_mux != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t http_session_download(const char *url, http_download_ctx_t *dl)
+{
+    if (session_mux == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(session_mux, portMAX_DELAY);
+    http_session_t *session = session_acquire(url);
+    if (session == NULL)
+    {
+        xSemaphoreGive(session_mux);
+        return ESP_FAIL;
+    }
+
+    dl->fp = NULL;
+    dl->started = false;
+    dl->err = ESP_OK;
+    dl->encoding = INFLATE_ENCODING_IDENTITY;
+    memset(&dl->inflater, 0, sizeof(dl->inflater));
+    esp_http_client_set_user_data(session->client, dl);
+    esp_http_client_set_method(session->client, HTTP_METHOD_GET);
+    // 文本数据压缩比很高，请求服务器以gzip传输，减少空口时间
+    esp_http_client_set_header(session->client, "Accept-Encoding", HTTP_ACCEPT_ENCODING);
+
+    esp_err_t err = esp_http_client_perform(session->client);
+    session->requests++;
+    bool got_body = dl->started;
+    if (dl->fp != NULL)
+    {
+        fclose(dl->fp);
+        dl->fp = NULL;
+    }
+    inflate_stream_deinit(&dl->inflater);
+
+    int status_code = esp_http_client_get_status_code(session->client);
+    if (err != ESP_OK)
+    {
+        // 连接出错后关闭，下次请求重新建立
+        esp_http_client_close(session->client);
+    }
+    else if (dl->err != ESP_OK)
+    {
+        err = dl->err;
+        esp_http_client_close(session->client);
+    }
+    else if (status_code != 200 || !got_body)
+    {
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    esp_http_client_set_user_data(session->client, NULL);
+    xSemaphoreGive(session_mux);
+
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "GET %s: %lu bytes on the wire, %lu bytes stored (request #%lu on this session)",
+                 url, (unsigned long)dl->inflater.total_in, (unsigned long)dl->inflater.total_out,
+                 (unsigned long)session->requests);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "GET %s failed: %s (status %d)", url, esp_err_to_name(err), status_code);
+    }
+    return err;
+}
+
+void http_session_close_idle(void)
+{
+    if (session_mux == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(session_mux, portMAX_DELAY);
+    for (int i = 0; i < HTTP_SESSION_MAX_HOSTS; i++)
+    {
+        if (sessions[i].client != NULL)
+        {
+            esp_http_client_close(sessions[i].client);
+        }
+    }
+    xSemaphoreGive(session_mux);
+}
+
+void http_session_cleanup(void)
+{
+    if (session_mux == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(session_mux, portMAX_DELAY);
+    for (int i = 0; i < HTTP_SESSION_MAX_HOSTS; i++)
+    {
+        if (sessions[i].client != NULL)
+        {
+            esp_http_client_cleanup(sessions[i].client);
+            memset(&sessions[i], 0, sizeof(sessions[i]));
+        }
+    }
+    xSemaphoreGive(session_mux);
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "inflate_stream.h"
+
+#define TAG "inflate_stream"
+
+// gzip头部标志位（RFC1952）
+#define GZIP_FHCRC      0x02
+#define GZIP_FEXTRA     0x04
+#define GZIP_FNAME      0x08
+#define GZIP_FCOMMENT   0x10
+
+// 解析状态
+enum
+{
+    ST_MAGIC1 = 0,
+    ST_MAGIC2,
+    ST_METHOD,
+    ST_FLAGS,
+    ST_FIXED,           // MTIME(4) + XFL(1) + OS(1)
+    ST_EXTRA_LEN1,
+    ST_EXTRA_LEN2,
+    ST_EXTRA,
+    ST_NAME,
+    ST_COMMENT,
+    ST_HCRC,
+    ST_BODY,
+    ST_TRAILER,
+    ST_DONE,
+    ST_PASSTHROUGH,
+};
+
+inflate_encoding_t inflate_encoding_from_header(const char *value)
+{
+    if (value == NULL)
+        return INFLATE_ENCODING_IDENTITY;
+    if (strcasecmp(value, "gzip") == 0 || strcasecmp(value, "x-gzip") == 0)
+        return INFLATE_ENCODING_GZIP;
+    if (strcasecmp(value, "deflate") == 0)
+        return INFLATE_ENCODING_DEFLATE;
+    return INFLATE_ENCODING_IDENTITY;
+}
+
+esp_err_t inflate_stream_init(inflate_stream_t *s, inflate_encoding_t encoding, inflate_sink_t sink, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->encoding = encoding;
+    s->sink = sink;
+    s->sink_ctx = ctx;
+
+    if (encoding == INFLATE_ENCODING_IDENTITY)
+    {
+        s->state = ST_PASSTHROUGH;
+        return ESP_OK;
+    }
+
+    // deflate的回溯距离最大为32KB，窗口不能再小，否则无法解出任意合法的数据流
+    s->decomp = malloc(sizeof(tinfl_decompressor));
+    s->dict = malloc(TINFL_LZ_DICT_SIZE);
+    if (s->decomp == NULL || s->dict == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate memory for the inflate window");
+        inflate_stream_deinit(s);
+        return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(s->decomp);
+    s->state = (encoding == INFLATE_ENCODING_GZIP) ? ST_MAGIC1 : ST_BODY;
+    return ESP_OK;
+}
+
+void inflate_stream_deinit(inflate_stream_t *s)
+{
+    free(s->decomp);
+    free(s->dict);
+    s->decomp = NULL;
+    s->dict = NULL;
+}
+
+// 逐字节解析gzip头部，返回消耗的字节数，出错返回-1
+static int parse_gzip_header(inflate_stream_t *s, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && s->state != ST_BODY)
+    {
+        uint8_t c = data[i++];
+        switch (s->state)
+        {
+            case ST_MAGIC1:
+                if (c != 0x1f)
+                    return -1;
+                s->state = ST_MAGIC2;
+                break;
+            case ST_MAGIC2:
+                if (c != 0x8b)
+                    return -1;
+                s->state = ST_METHOD;
+                break;
+            case ST_METHOD:
+                if (c != 8)  // 只支持deflate
+                    return -1;
+                s->state = ST_FLAGS;
+                break;
+            case ST_FLAGS:
+                s->flags = c;
+                s->skip = 6;
+                s->state = ST_FIXED;
+                break;
+            case ST_FIXED:
+                if (--s->skip == 0)
+                    s->state = (s->flags & GZIP_FEXTRA) ? ST_EXTRA_LEN1 : ST_NAME;
+                break;
+            case ST_EXTRA_LEN1:
+                s->skip = c;
+                s->state = ST_EXTRA_LEN2;
+                break;
+            case ST_EXTRA_LEN2:
+                s->skip |= (uint16_t)c << 8;
+                s->state = s->skip ? ST_EXTRA : ST_NAME;
+                break;
+            case ST_EXTRA:
+                if (--s->skip == 0)
+                    s->state = ST_NAME;
+                break;
+            case ST_NAME:
+                if (!(s->flags & GZIP_FNAME) || c == 0)
+                {
+                    s->state = ST_COMMENT;
+                    if (!(s->flags & GZIP_FNAME))
+                        i--;  // 没有文件名字段，当前字节属于下一个字段
+                }
+                break;
+            case ST_COMMENT:
+                if (!(s->flags & GZIP_FCOMMENT) || c == 0)
+                {
+                    s->skip = 2;
+                    s->state = ST_HCRC;
+                    if (!(s->flags & GZIP_FCOMMENT))
+                        i--;
+                }
+                break;
+            case ST_HCRC:
+                if (!(s->flags & GZIP_FHCRC))
+                {
+                    i--;
+                    s->state = ST_BODY;
+                }
+                else if (--s->skip == 0)
+                {
+                    s->state = ST_BODY;
+                }
+                break;
+            default:
+                return -1;
+        }
+    }
+    return i;
+}
+
+// 将输入数据送入tinfl，输出在环形窗口内直接交给sink，不额外拷贝
+static esp_err_t inflate_body(inflate_stream_t *s, const uint8_t *data, size_t len, size_t *consumed)
+{
+    mz_uint32 flags = TINFL_FLAG_HAS_MORE_INPUT;
+    size_t in_ofs = 0;
+
+    if (s->encoding == INFLATE_ENCODING_DEFLATE)
+        flags |= TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32;
+
+    while (1)
+    {
+        size_t in_size = len - in_ofs;
+        size_t out_size = TINFL_LZ_DICT_SIZE - s->dict_ofs;
+        tinfl_status status = tinfl_decompress(s->decomp, data + in_ofs, &in_size,
+                                               s->dict, s->dict + s->dict_ofs, &out_size, flags);
+        in_ofs += in_size;
+
+        if (out_size)
+        {
+            if (s->encoding == INFLATE_ENCODING_GZIP)
+                s->crc = esp_rom_crc32_le(s->crc, s->dict + s->dict_ofs, out_size);
+            s->total_out += out_size;
+            esp_err_t err = s->sink(s->dict + s->dict_ofs, out_size, s->sink_ctx);
+            if (err != ESP_OK)
+                return err;
+            s->dict_ofs = (s->dict_ofs + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE)
+        {
+            s->state = (s->encoding == INFLATE_ENCODING_GZIP) ? ST_TRAILER : ST_DONE;
+            break;
+        }
+        if (status < TINFL_STATUS_DONE)
+        {
+            ESP_LOGE(TAG, "Corrupted deflate stream (status %d)", status);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        // 输入耗尽且没有待输出的数据，等待下一段输入
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT && in_ofs == len)
+            break;
+    }
+    *consumed = in_ofs;
+    return ESP_OK;
+}
+
+esp_err_t inflate_stream_feed(inflate_stream_t *s, const uint8_t *data, size_t len)
+{
+    s->total_in += len;
+
+    if (s->state == ST_PASSTHROUGH)
+        return len ? s->sink(data, len, s->sink_ctx) : ESP_OK;
+
+    while (len > 0)
+    {
+        if (s->state < ST_BODY)
+        {
+            int used = parse_gzip_header(s, data, len);
+            if (used < 0)
+            {
+                ESP_LOGE(TAG, "Invalid gzip header");
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            data += used;
+            len -= used;
+        }
+        else if (s->state == ST_BODY)
+        {
+            size_t used = 0;
+            esp_err_t err = inflate_body(s, data, len, &used);
+            if (err != ESP_OK)
+                return err;
+            data += used;
+            len -= used;
+        }
+        else if (s->state == ST_TRAILER)
+        {
+            size_t n = MIN(len, sizeof(s->trailer) - s->trailer_len);
+            memcpy(s->trailer + s->trailer_len, data, n);
+            s->trailer_len += n;
+            data += n;
+            len -= n;
+            if (s->trailer_len == sizeof(s->trailer))
+                s->state = ST_DONE;
+        }
+        else
+        {
+            // 数据流结束后的多余字节直接忽略
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t inflate_stream_finish(inflate_stream_t *s)
+{
+    if (s->state == ST_PASSTHROUGH)
+        return ESP_OK;
+
+    if (s->state != ST_DONE)
+    {
+        ESP_LOGE(TAG, "Compressed stream truncated (%lu bytes in)", (unsigned long)s->total_in);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (s->encoding == INFLATE_ENCODING_GZIP)
+    {
+        uint32_t crc = s->trailer[0] | s->trailer[1] << 8 | s->trailer[2] << 16 | (uint32_t)s->trailer[3] << 24;
+        uint32_t isize = s->trailer[4] | s->trailer[5] << 8 | s->trailer[6] << 16 | (uint32_t)s->trailer[7] << 24;
+        if (crc != s->crc || isize != s->total_out)
+        {
+            ESP_LOGE(TAG, "gzip trailer mismatch: crc %08lx/%08lx, size %lu/%lu",
+                     (unsigned long)crc, (unsigned long)s->crc, (unsigned long)isize, (unsigned long)s->total_out);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    ESP_LOGI(TAG, "Inflated %lu bytes into %lu bytes", (unsigned long)s->total_in, (unsigned long)s->total_out);
+    return ESP_OK;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "esp_log.h"
+#include "json_stream.h"
+
+#define TAG "json_stream"
+
+enum
+{
+    JSON_STATE_VALUE = 0,   // 等待值或分隔符
+    JSON_STATE_STRING,
+    JSON_STATE_ESCAPE,
+    JSON_STATE_UNICODE,
+    JSON_STATE_NUMBER,
+    JSON_STATE_LITERAL,     // true/false/null
+};
+
+void json_stream_init(json_stream_t *js, json_stream_cb_t cb, void *ctx)
+{
+    memset(js, 0, sizeof(*js));
+    js->cb = cb;
+    js->ctx = ctx;
+}
+
+static inline bool in_object(const json_stream_t *js)
+{
+    return js->depth > 0 && (js->containers & (1u << (js->depth - 1)));
+}
+
+static esp_err_t emit(json_stream_t *js, json_event_t evt, const char *text)
+{
+    return js->cb(evt, js->depth, text, js->ctx);
+}
+
+static void token_putc(json_stream_t *js, char c)
+{
+    // 超长的值截断，只保留前面部分
+    if (js->token_len < JSON_STREAM_TOKEN_MAX - 1)
+    {
+        js->token[js->token_len++] = c;
+    }
+}
+
+static void token_put_utf8(json_stream_t *js, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        token_putc(js, cp);
+    }
+    else if (cp < 0x800)
+    {
+        token_putc(js, 0xC0 | (cp >> 6));
+        token_putc(js, 0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        token_putc(js, 0xE0 | (cp >> 12));
+        token_putc(js, 0x80 | ((cp >> 6) & 0x3F));
+        token_putc(js, 0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        token_putc(js, 0xF0 | (cp >> 18));
+        token_putc(js, 0x80 | ((cp >> 12) & 0x3F));
+        token_putc(js, 0x80 | ((cp >> 6) & 0x3F));
+        token_putc(js, 0x80 | (cp & 0x3F));
+    }
+}
+
+static esp_err_t end_token(json_stream_t *js, json_event_t evt)
+{
+    js->token[js->token_len] = '\0';
+    js->state = JSON_STATE_VALUE;
+    return emit(js, evt, js->token);
+}
+
+static esp_err_t end_literal(json_stream_t *js)
+{
+    js->token[js->token_len] = '\0';
+    js->state = JSON_STATE_VALUE;
+    if (strcmp(js->token, "true") == 0)
+        return emit(js, JSON_EVT_TRUE, NULL);
+    if (strcmp(js->token, "false") == 0)
+        return emit(js, JSON_EVT_FALSE, NULL);
+    if (strcmp(js->token, "null") == 0)
+        return emit(js, JSON_EVT_NULL, NULL);
+    return ESP_ERR_INVALID_ARG;
+}
+
+static esp_err_t open_container(json_stream_t *js, bool object)
+{
+    if (js->depth >= JSON_STREAM_MAX_DEPTH)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = emit(js, object ? JSON_EVT_OBJECT_START : JSON_EVT_ARRAY_START, NULL);
+    if (object)
+        js->containers |= 1u << js->depth;
+    else
+        js->containers &= ~(1u << js->depth);
+    js->depth++;
+    js->expect_key = object;
+    return err;
+}
+
+static esp_err_t close_container(json_stream_t *js, bool object)
+{
+    if (js->depth == 0 || in_object(js) != object)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    js->depth--;
+    js->expect_key = false;
+    return emit(js, object ? JSON_EVT_OBJECT_END : JSON_EVT_ARRAY_END, NULL);
+}
+
+static esp_err_t parse_value_char(json_stream_t *js, char c)
+{
+    switch (c)
+    {
+        case ' ': case '\t': case '\r': case '\n':
+            return ESP_OK;
+        case '{':
+            return open_container(js, true);
+        case '[':
+            return open_container(js, false);
+        case '}':
+            return close_container(js, true);
+        case ']':
+            return close_container(js, false);
+        case ',':
+            js->expect_key = in_object(js);
+            return ESP_OK;
+        case ':':
+            js->expect_key = false;
+            return ESP_OK;
+        case '"':
+            js->is_key = in_object(js) && js->expect_key;
+            js->token_len = 0;
+            js->state = JSON_STATE_STRING;
+            return ESP_OK;
+        default:
+            break;
+    }
+
+    js->token_len = 0;
+    token_putc(js, c);
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+        js->state = JSON_STATE_NUMBER;
+        return ESP_OK;
+    }
+    if (c >= 'a' && c <= 'z')
+    {
+        js->state = JSON_STATE_LITERAL;
+        return ESP_OK;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+static esp_err_t parse_char(json_stream_t *js, char c)
+{
+    switch (js->state)
+    {
+        case JSON_STATE_STRING:
+            if (c == '"')
+            {
+                return end_token(js, js->is_key ? JSON_EVT_KEY : JSON_EVT_STRING);
+            }
+            if (c == '\\')
+            {
+                js->state = JSON_STATE_ESCAPE;
+                return ESP_OK;
+            }
+            token_putc(js, c);
+            return ESP_OK;
+
+        case JSON_STATE_ESCAPE:
+            js->state = JSON_STATE_STRING;
+            switch (c)
+            {
+                case 'b': token_putc(js, '\b'); break;
+                case 'f': token_putc(js, '\f'); break;
+                case 'n': token_putc(js, '\n'); break;
+                case 'r': token_putc(js, '\r'); break;
+                case 't': token_putc(js, '\t'); break;
+                case 'u':
+                    js->unicode = 0;
+                    js->unicode_len = 0;
+                    js->state = JSON_STATE_UNICODE;
+                    break;
+                default:  token_putc(js, c); break;   // \" \\ \/
+            }
+            return ESP_OK;
+
+        case JSON_STATE_UNICODE:
+            if (c >= '0' && c <= '9')
+                js->unicode = (js->unicode << 4) | (c - '0');
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+                js->unicode = (js->unicode << 4) | ((c | 0x20) - 'a' + 10);
+            else
+                return ESP_ERR_INVALID_ARG;
+            if (++js->unicode_len < 4)
+                return ESP_OK;
+
+            js->state = JSON_STATE_STRING;
+            if (js->unicode >= 0xD800 && js->unicode < 0xDC00)
+            {
+                js->high_surrogate = js->unicode;   // 等待低位代理
+            }
+            else if (js->unicode >= 0xDC00 && js->unicode < 0xE000 && js->high_surrogate)
+            {
+                token_put_utf8(js, 0x10000 + ((js->high_surrogate - 0xD800) << 10) + (js->unicode - 0xDC00));
+                js->high_surrogate = 0;
+            }
+            else
+            {
+                token_put_utf8(js, js->unicode);
+            }
+            return ESP_OK;
+
+        case JSON_STATE_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+            {
+                token_putc(js, c);
+                return ESP_OK;
+            }
+            else
+            {
+                esp_err_t err = end_token(js, JSON_EVT_NUMBER);
+                return err != ESP_OK ? err : parse_value_char(js, c);
+            }
+
+        case JSON_STATE_LITERAL:
+            if (c >= 'a' && c <= 'z')
+            {
+                token_putc(js, c);
+                return ESP_OK;
+            }
+            else
+            {
+                esp_err_t err = end_literal(js);
+                return err != ESP_OK ? err : parse_value_char(js, c);
+            }
+
+        default:
+            return parse_value_char(js, c);
+    }
+}
+
+esp_err_t json_stream_feed(json_stream_t *js, const char *data, size_t len)
+{
+    if (js->err != ESP_OK)
+    {
+        return js->err;
+    }
+    for (size_t i = 0; i < len && js->err == ESP_OK; i++)
+    {
+        js->err = parse_char(js, data[i]);
+        js->offset++;
+    }
+    if (js->err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Parse error near byte %u: %s", (unsigned)js->offset, esp_err_to_name(js->err));
+    }
+    return js->err;
+}
+
+esp_err_t json_stream_finish(json_stream_t *js)
+{
+    if (js->err != ESP_OK)
+    {
+        return js->err;
+    }
+    // 顶层是数字或字面量时，到结尾才能确定值结束
+    if (js->state == JSON_STATE_NUMBER)
+        js->err = end_token(js, JSON_EVT_NUMBER);
+    else if (js->state == JSON_STATE_LITERAL)
+        js->err = end_literal(js);
+    if (js->err == ESP_OK && (js->state != JSON_STATE_VALUE || js->depth != 0))
+    {
+        ESP_LOGE(TAG, "Truncated document after %u bytes", (unsigned)js->offset);
+        js->err = ESP_ERR_INVALID_SIZE;
+    }
+    return js->err;
+}
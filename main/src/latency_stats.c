@@ -0,0 +1,142 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "latency_stats.h"
+
+static const char *stage_names[LAT_STAGE_COUNT] =
+{
+    "parse", "post", "handoff", "plan", "submit", "total",
+};
+
+// 每个阶段一个环形窗口，写者只有电机任务，读者复制后在临界区外排序
+typedef struct
+{
+    uint32_t ring[LATENCY_WINDOW];
+    uint32_t samples;
+    uint32_t max_all_us;
+} latency_stage_ring_t;
+
+static portMUX_TYPE lat_lock = portMUX_INITIALIZER_UNLOCKED;
+static latency_stage_ring_t stages[LAT_STAGE_COUNT];
+
+static uint32_t clamp_us(int64_t us)
+{
+    if (us < 0)
+    {
+        return 0;
+    }
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+void latency_record(const rot_setpoint_t *sp, int64_t take_us, int64_t plan_us, int64_t submit_us)
+{
+    if (sp->recv_us == 0)
+    {
+        return;
+    }
+    const uint32_t value[LAT_STAGE_COUNT] =
+    {
+        [LAT_STAGE_PARSE] = clamp_us(sp->parse_us - sp->recv_us),
+        [LAT_STAGE_POST] = clamp_us(sp->time_us - sp->parse_us),
+        [LAT_STAGE_HANDOFF] = clamp_us(take_us - sp->time_us),
+        [LAT_STAGE_PLAN] = clamp_us(plan_us - take_us),
+        [LAT_STAGE_SUBMIT] = clamp_us(submit_us - plan_us),
+        [LAT_STAGE_TOTAL] = clamp_us(submit_us - sp->recv_us),
+    };
+
+    taskENTER_CRITICAL(&lat_lock);
+    for (int i = 0; i < LAT_STAGE_COUNT; i++)
+    {
+        latency_stage_ring_t *s = &stages[i];
+        s->ring[s->samples % LATENCY_WINDOW] = value[i];
+        s->samples++;
+        if (value[i] > s->max_all_us)
+        {
+            s->max_all_us = value[i];
+        }
+    }
+    taskEXIT_CRITICAL(&lat_lock);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+void latency_get(latency_stage_t stage, latency_summary_t *summary)
+{
+    uint32_t window[LATENCY_WINDOW];
+
+    memset(summary, 0, sizeof(*summary));
+    taskENTER_CRITICAL(&lat_lock);
+    summary->samples = stages[stage].samples;
+    summary->max_all_us = stages[stage].max_all_us;
+    memcpy(window, stages[stage].ring, sizeof(window));
+    taskEXIT_CRITICAL(&lat_lock);
+
+    size_t n = summary->samples < LATENCY_WINDOW ? summary->samples : LATENCY_WINDOW;
+    if (n == 0)
+    {
+        return;
+    }
+    qsort(window, n, sizeof(window[0]), cmp_u32);
+    summary->p50_us = window[(n - 1) * 50 / 100];
+    summary->p99_us = window[(n - 1) * 99 / 100];
+    summary->max_us = window[n - 1];
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return stage < LAT_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+int latency_format_json(char *buf, size_t size)
+{
+    latency_summary_t s;
+    size_t len = 0;
+
+    len += snprintf(buf + len, size - len, "{");
+    for (int i = 0; i < LAT_STAGE_COUNT && len < size; i++)
+    {
+        latency_get(i, &s);
+        len += snprintf(buf + len, size - len,
+                        "%s\"%s\":{\"samples\":%lu,\"p50_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu,\"max_all_us\":%lu}",
+                        i ? "," : "", stage_names[i], (unsigned long)s.samples, (unsigned long)s.p50_us,
+                        (unsigned long)s.p99_us, (unsigned long)s.max_us, (unsigned long)s.max_all_us);
+    }
+    if (len < size)
+    {
+        len += snprintf(buf + len, size - len, "}\n");
+    }
+    return len < size ? (int)len : (int)size - 1;
+}
+
+void latency_stats_print(void)
+{
+    latency_summary_t s;
+    printf("%-8s %8s %10s %10s %10s %10s\n", "stage", "samples", "p50 us", "p99 us", "max us", "max all");
+    for (int i = 0; i < LAT_STAGE_COUNT; i++)
+    {
+        latency_get(i, &s);
+        printf("%-8s %8lu %10lu %10lu %10lu %10lu\n", stage_names[i], (unsigned long)s.samples,
+               (unsigned long)s.p50_us, (unsigned long)s.p99_us, (unsigned long)s.max_us, (unsigned long)s.max_all_us);
+    }
+}
@@ -78,29 +78,22 @@ void littlefs_init(esp_vfs_littlefs_conf_t *conf)
         ESP_LOGE(TAG, "Failed to get partition info: %s", esp_err_to_name(ret));
     }
 
-    // 列出目录内容
-    DIR* dir = opendir("/littlefs");
-    if (dir != NULL) {
-        ESP_LOGI(TAG, "Listing files in /littlefs:");
-        struct dirent* entry;
-        int file_count = 0;
-        while ((entry = readdir(dir)) != NULL) {
-            ESP_LOGI(TAG, "Found file: %s", entry->d_name);
-            file_count++;
+    // 列出目录内容只用于调试，逐个文件打印日志会明显拖慢启动
+    if (esp_log_level_get(TAG) >= ESP_LOG_DEBUG)
+    {
+        DIR* dir = opendir("/littlefs");
+        if (dir != NULL) {
+            struct dirent* entry;
+            int file_count = 0;
+            while ((entry = readdir(dir)) != NULL) {
+                ESP_LOGD(TAG, "Found file: %s", entry->d_name);
+                file_count++;
+            }
+            ESP_LOGD(TAG, "Total files found: %d", file_count);
+            closedir(dir);
+        } else {
+            ESP_LOGE(TAG, "Failed to open directory: %s", strerror(errno));
         }
-        ESP_LOGI(TAG, "Total files found: %d", file_count);
-        closedir(dir);
-    } else {
-        ESP_LOGE(TAG, "Failed to open directory: %s", strerror(errno));
-    }
-
-    // 尝试读取一个文件来验证文件系统
-    FILE* f = fopen("/littlefs/tle_eph.txt", "r");
-    if (f != NULL) {
-        ESP_LOGI(TAG, "Successfully opened tle_eph.txt file");
-        fclose(f);
-    } else {
-        ESP_LOGE(TAG, "Failed to open tle_eph.txt file: %s", strerror(errno));
     }
 }
 
@@ -141,8 +134,8 @@ void sync_latest_time(void)
 {
     char latest_time[128];
 
-    // 下载结束之后同步当前时间并记录
-    sntp_netif_sync_time();  
+    // 下载结束之后请求一次同步，不等待结果，时钟连续，直接记录当前时间
+    time_sync_request();
     struct timeval tv;
     struct tm time;
 
@@ -1,4 +1,7 @@
 #include "lvgl_display.h"
+#include "boot_prof.h"
+#include "state_bus.h"
+#include "sgp4sdp4.h"
 
 #define TAG         "lvgl_display"
 
@@ -383,13 +386,14 @@ void lvgl_display_init(void)
 }
 
 
-// 当前卫星参数的缓存
-static satellite_params_t current_sat_params;
-static bool has_sat_params = false;
+// GUI最后显示的卫星状态，只在GUI任务中访问
+static track_state_t current_sat_state;
+static char current_sat_name[SAT_NMAE_LENGTH];
+static uint32_t shown_generation = 0;
 
 // 异步更新卫星参数的回调函数
 static void update_sat_param_gui_cb(void *param) {
-    satellite_params_t *params = (satellite_params_t *)param;
+    track_state_t *state = (track_state_t *)param;
     
     if (guider_ui.sat_param_screen == NULL) {
         // 如果屏幕未创建，不需要更新
@@ -399,38 +403,40 @@ static void update_sat_param_gui_cb(void *param) {
     // 更新界面显示
     update_sat_param_screen(
         &guider_ui,
-        params->sat_name,
-        params->sat_ele,
-        params->sat_azi,
-        params->sat_range,
-        params->sat_vel,
-        params->sat_status
+        current_sat_name,
+        state->ele,
+        state->azi,
+        state->range,
+        state->vel,
+        (state->flags & STATE_FLAG_ECLIPSED) ? "Eclipsed" : "In Sunlight"
     );
 }
 
-// 检查队列中是否有新的卫星参数数据
+// 检查状态总线上是否有新的卫星状态，只读取不取走，其他读者同样能拿到
 void check_satellite_params(void) {
-    satellite_params_t params;
-    
-    if (SatelliteParamsQueueHandler != NULL) {
-        // 尝试接收队列数据，不阻塞
-        if (xQueueReceive(SatelliteParamsQueueHandler, &params, 0) == pdPASS) {
-            // 复制到当前参数缓存
-            memcpy(&current_sat_params, &params, sizeof(satellite_params_t));
-            has_sat_params = true;
-            
-            // 如果当前显示的是卫星参数界面，则更新
-            if (lv_scr_act() == guider_ui.sat_param_screen) {
-                lv_async_call(update_sat_param_gui_cb, &current_sat_params);
-            }
-        }
+    if (state_bus_generation() == shown_generation) {
+        return;
+    }
+    uint32_t target = current_sat_state.target;
+    if (!state_bus_read(&current_sat_state)) {
+        return;
+    }
+    shown_generation = current_sat_state.generation;
+    // 跟踪目标切换后才重新读取名称
+    if (current_sat_state.target != target) {
+        state_bus_read_target(current_sat_name, sizeof(current_sat_name));
+    }
+
+    // 如果当前显示的是卫星参数界面，则更新
+    if (lv_scr_act() == guider_ui.sat_param_screen) {
+        lv_async_call(update_sat_param_gui_cb, &current_sat_state);
     }
 }
 
 // 当切换到卫星参数屏幕时，使用缓存的参数更新界面
 void update_sat_param_on_screen_load(void) {
-    if (has_sat_params) {
-        lv_async_call(update_sat_param_gui_cb, &current_sat_params);
+    if (shown_generation != 0) {
+        lv_async_call(update_sat_param_gui_cb, &current_sat_state);
     }
 }
 
@@ -438,6 +444,7 @@ void gui_task(void)
 {
     ESP_LOGI(TAG, "Starting LVGL task");
     uint32_t task_delay_ms = EXAMPLE_LVGL_TASK_MAX_DELAY_MS;
+    bool first_frame = false;
     events_init(&guider_ui);  
     setup_ui(&guider_ui);
 
@@ -452,6 +459,11 @@ void gui_task(void)
             task_delay_ms = lv_timer_handler();
             // Release the mutex
             example_lvgl_unlock();
+            if (!first_frame)
+            {
+                first_frame = true;
+                boot_prof_mark("first_frame");  // 首次刷新已提交给面板
+            }
         }
         if (task_delay_ms > EXAMPLE_LVGL_TASK_MAX_DELAY_MS) 
         {
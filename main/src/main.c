@@ -46,6 +46,8 @@
 #include "esp_littlefs.h"
 #include "esp_http_client.h"
 #include "http_app.h"
+#include "track_snapshot.h"
+#include "assets.h"
 #include "esp_crt_bundle.h"
 #include "esp_sntp.h"
 
@@ -56,6 +58,15 @@
 #include "uart.h"
 #include "globals.h"
 #include "lvgl_display.h"
+#include "web_server.h"
+#include "orbit_propagator.h"
+#include "tle_prefetch.h"
+#include "boot_prof.h"
+#include "pass_sched.h"
+#include "udp_stream.h"
+#include "trajectory.h"
+#include "gs232.h"
+#include "time_sync.h"
 
 
 #define NOTCONN_PERIOD          pdMS_TO_TICKS(500)
@@ -83,7 +94,6 @@ TaskHandle_t uart_handler;
 TaskHandle_t gui_handler;
 
 QueueHandle_t SatnameQueueHandler = NULL;
-QueueHandle_t SatelliteParamsQueueHandler = NULL;
 
 static void Led_Init(void)
 {
@@ -121,6 +131,20 @@ void cb_connection_ok(void *pvParameter)
 
 	ESP_LOGI(TAG, "I have a connection and my IP is %s!", str_ip);
     ESP_LOGI(TAG, "Using the keywords through the uart to activate certain function.\n");
+    web_server_start();  // 局域网内可直接上传TLE目录，不依赖外网
+    // rotctld服务，取得IP后启动，重连时不重复创建
+    if (tcp_server_handler == NULL)
+    {
+        xTaskCreatePinnedToCore(tcp_server_task, "tcp_server", 4096, NULL, 5, &tcp_server_handler, 0);
+    }
+#if CONFIG_TALLNECK_UDP_STREAM
+    // 状态广播任务，按固定频率发送UDP状态包，只创建一次，断线期间sendto失败计入errors
+    static TaskHandle_t udp_stream_handler = NULL;
+    if (udp_stream_handler == NULL)
+    {
+        xTaskCreatePinnedToCore(udp_stream_task, "udp_stream", 3072, NULL, 3, &udp_stream_handler, 0);
+    }
+#endif
     vTaskDelay(2000 / portTICK_PERIOD_MS);  // 延时一段事件再开启sntp同步
     // download_tle_task();
 }
@@ -166,8 +190,12 @@ void init_time_from_compile(void)
         .tv_usec = 0
     };
     
-    // 设置系统时间
-    settimeofday(&now, NULL);
+    // 软件复位和看门狗复位后RTC时间仍然有效，不要倒退回编译时间
+    if (time(NULL) < t)
+    {
+        // 设置系统时间
+        settimeofday(&now, NULL);
+    }
     
     // 设置时区
     setenv("TZ", "CST-8", 1);
@@ -179,53 +207,111 @@ void init_time_from_compile(void)
     ESP_LOGI(TAG, "系统时间已初始化为编译时间: %s", strftime_buf);
 }
 
+// 文件系统挂载较慢（首次还要格式化），在核心0上与屏幕初始化并行进行
+static void boot_storage_task(void *pvParameter)
+{
+    int id = boot_prof_begin("littlefs");
+    littlefs_init(&littlefs_conf);  // LittleFS文件系统初始化
+    boot_prof_end(id);
+    boot_stage_done(BOOT_STAGE_STORAGE);
+    vTaskDelete(NULL);
+}
+
+// 屏幕复位要等待面板退出睡眠，放在核心1上，不阻塞文件系统和跟踪任务
+static void boot_display_task(void *pvParameter)
+{
+    int id = boot_prof_begin("display");
+    lvgl_display_init();
+    boot_prof_end(id);
+    // gui任务，高优先级，位于核心1，如果处于核心0，会导致堆栈溢出
+    xTaskCreatePinnedToCore(gui_task, "gui_task", 8192, NULL, 9, &gui_handler, 1);
+    boot_stage_done(BOOT_STAGE_DISPLAY);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief   启动按依赖关系分阶段进行：
+ *          core（队列、时间、资源分区映射）-> 屏幕 | 文件系统 | NVS、SNTP、Wi-Fi 并行
+ *          跟踪任务不等待文件系统，从快照恢复时可以立即指向；读取TLE目录时由catalog_open等待挂载完成
+ *          串口命令会访问文件，在文件系统挂载后再启动
+ */
 void app_main(void)
 {
+    boot_prof_init();
+
+    int id = boot_prof_begin("core");
     Led_Init();  // LED初始化
-    littlefs_init(&littlefs_conf);  // LittleFS文件系统初始化
+    assets_init();  // 映射只读资源分区：出厂目录、转发器数据库、图片
     setenv("TZ", "CST-8", 1);  // 将时区设置为中国标准时间
     tzset();
     init_time_from_compile();
-    sntp_netif_sync_time_init();  // sntp时间同步初始化
 
     // esp_err_t err = nvs_flash_erase();  // 用于擦除nvs部分
     LedTimerHandle = xTimerCreate("led_controller", NOTCONN_PERIOD, pdTRUE, 0, led_timer_callback);  // 创建LED定时器
-    RotQueueHandler = xQueueCreate(5, sizeof(Tcp_Sentence *));  // 创建用于传输俯仰角数据的消息队列
     SatnameQueueHandler = xQueueCreate(5, SAT_NMAE_LENGTH);
-    SatelliteParamsQueueHandler = xQueueCreate(1, sizeof(satellite_params_t));
+    orbit_propagator_init();  // 跟踪和过境预测共用SGP4/SDP4，需要互斥
+    http_session_init();  // TLE、镜像和转发器下载共用的连接，需要互斥
     // 检查定时器和消息队列是否创建完成
-    if (NULL == RotQueueHandler)
-    {
-        ESP_LOGE(TAG, "Rotator message queue create failed.\n");    
-    }
     if (NULL == SatnameQueueHandler)
     {
         ESP_LOGE(TAG, "Satellite name message queue create failed.\n");
     }
-    if (LedTimerHandle != NULL)
+    // 状态LED与步进电机引脚冲突时不闪烁，否则会改变电机的方向或使能
+    if (gpio_led_num == STEP_MOTOR_GPIO_DIR || gpio_led_num == STEP_MOTOR_GPIO_EN || gpio_led_num == STEP_MOTOR_GPIO_STEP)
     {
-        LedTimerStarted = xTimerStart(LedTimerHandle, 0);  // 启动LED定时器
+        ESP_LOGW(TAG, "LED GPIO%d is used by the stepper motor, status LED disabled", gpio_led_num);
     }
-    if (SatelliteParamsQueueHandler == NULL) {
-        ESP_LOGE("QUEUE", "Failed to create satellite parameters queue");
+    else if (LedTimerHandle != NULL)
+    {
+        LedTimerStarted = xTimerStart(LedTimerHandle, 0);  // 启动LED定时器
     }
+    boot_prof_end(id);
+
+    xTaskCreatePinnedToCore(boot_display_task, "boot_display", 4096, NULL, 8, NULL, 1);
+    xTaskCreatePinnedToCore(boot_storage_task, "boot_storage", 4096, NULL, 8, NULL, 0);
+
+    id = boot_prof_begin("nvs");
+    track_snapshot_restore();  // 复位前正在跟踪时，跟踪任务启动后立即恢复，不等待Wi-Fi和GUI
+    boot_prof_end(id);
+    boot_stage_done(BOOT_STAGE_NVS);
+    // sgp4sdp4轨道预测任务，位于核心1
+    xTaskCreatePinnedToCore(orbit_trking_task, "orbit_trking", 8192, NULL, 5, &orbit_trking_handler, 1);
 
+    id = boot_prof_begin("network");
+    time_sync_init();  // sntp后台同步，小偏差平滑校正并补偿晶振漂移
+#if CONFIG_TALLNECK_BOOT_START_WIFI
     // wifi manager IP address: 10.10.0.1
-	// wifi_manager_start();
+    wifi_manager_start();
     // 回调函数，用于返回IP 
-	// wifi_manager_set_callback(WM_EVENT_STA_GOT_IP, &cb_connection_ok);
+    wifi_manager_set_callback(WM_EVENT_STA_GOT_IP, &cb_connection_ok);
+#endif
+    boot_prof_end(id);
+
     // 旋转器控制任务，调用rmt生成精确波形，后期考虑移至ISR的回调函数中
-    // xTaskCreatePinnedToCore(rotator_controller, "rotator_control", 4096, (void *)RotQueueHandler, 3, &stepper_motor_handler, 1);
-    // TCP server任务
-    // xTaskCreatePinnedToCore(tcp_server_task, "tcp_server", 4096, (void *)RotQueueHandler, 5, &tcp_server_handler, 0);
-    // TLE下载任务，属于wifi协议栈，位于核心0
-    // xTaskCreatePinnedToCore(download_tle_task, "download_tle", 8192, NULL, 7, &tle_download_handler, 0);
-    // sgp4sdp4轨道预测任务，位于核心1
-    xTaskCreatePinnedToCore(orbit_trking_task, "orbit_trking", 8192, NULL, 5, &orbit_trking_handler, 1);
-    // uart前台交互任务，高优先级，位于核心0
+    // 取走目标邮箱中的最新目标驱动电机，跟踪、rotctld、控制台、轨迹和GS-232的目标都由它执行
+    xTaskCreatePinnedToCore(rotator_controller, "rotator_control", 4096, NULL, 3, &stepper_motor_handler, 1);
+    // TCP server任务在cb_connection_ok中取得IP后启动
+    // TLE下载任务，属于wifi协议栈，位于核心0；按根数时效在过境间隙自动刷新，也响应串口的reconnect命令
+    xTaskCreatePinnedToCore(tle_prefetch_task, "tle_prefetch", 8192, NULL, 4, &tle_download_handler, 0);
+    // UDP状态广播任务同样在cb_connection_ok中启动，此前lwIP尚未初始化
+    // 轨迹执行任务，按设备时钟执行上传的时间标记轨迹
+    xTaskCreatePinnedToCore(traj_task, "trajectory", 3072, NULL, 4, NULL, 0);
+    // 过境调度任务，按监视列表自动开始和结束跟踪，等待文件系统挂载后读取列表
+    xTaskCreatePinnedToCore(pass_sched_task, "pass_sched", 8192, NULL, 4, NULL, 0);
+
+#if CONFIG_TALLNECK_GS232
+    // GS-232串口仿真任务，由UART事件驱动，优先级高于网络任务以保证串口命令的延迟
+    xTaskCreatePinnedToCore(gs232_task, "gs232", 3072, NULL, 9, NULL, 0);
+#endif
+
+    boot_stage_wait(BOOT_STAGE_STORAGE);
+#if !(CONFIG_TALLNECK_GS232 && CONFIG_TALLNECK_GS232_UART_NUM == 0)
+    // uart前台交互任务，高优先级，位于核心0；GS-232占用UART0时不启动
     xTaskCreatePinnedToCore(echo_task, "uart_echo", 8192, NULL, 10, &uart_handler, 0);
-    // gui任务，高优先级，位于核心1，如果处于核心0，会导致堆栈溢出
-    lvgl_display_init();
-    xTaskCreatePinnedToCore(gui_task, "gui_task", 8192, NULL, 9, &gui_handler, 1);
+#endif
     LedStatus = NOTCONNECTED;
+
+    boot_stage_wait(BOOT_STAGE_DISPLAY);
+    boot_prof_mark("boot_done");
+    boot_prof_report();
 }
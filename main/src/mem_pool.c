@@ -0,0 +1,180 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "mem_pool.h"
+
+#define TAG "mem_pool"
+
+static mem_stats_t stats;
+static mem_pool_t *pools = NULL;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t mem_pool_init(mem_pool_t *pool, const char *name, void *storage, size_t block_size, size_t count)
+{
+    if (pool == NULL || storage == NULL || count == 0 || count > UINT16_MAX ||
+        block_size < sizeof(void *) || block_size % sizeof(void *) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pool->name = name;
+    pool->storage = storage;
+    pool->block_size = block_size;
+    pool->count = count;
+    pool->used = 0;
+    pool->peak = 0;
+    pool->allocs = 0;
+    pool->failures = 0;
+    pool->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    // 空闲链表直接存放在空闲块的头部
+    pool->free_list = NULL;
+    for (size_t i = count; i > 0; i--)
+    {
+        void **block = (void **)(pool->storage + (i - 1) * block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+
+    taskENTER_CRITICAL(&stats_lock);
+    pool->next = pools;
+    pools = pool;
+    taskEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+void *mem_pool_alloc(mem_pool_t *pool)
+{
+    taskENTER_CRITICAL(&pool->lock);
+    void **block = pool->free_list;
+    if (block != NULL)
+    {
+        pool->free_list = *block;
+        pool->allocs++;
+        if (++pool->used > pool->peak)
+        {
+            pool->peak = pool->used;
+        }
+    }
+    else
+    {
+        pool->failures++;
+    }
+    taskEXIT_CRITICAL(&pool->lock);
+    return block;
+}
+
+void mem_pool_free(mem_pool_t *pool, void *block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+    taskENTER_CRITICAL(&pool->lock);
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->used--;
+    taskEXIT_CRITICAL(&pool->lock);
+}
+
+bool mem_pool_owns(const mem_pool_t *pool, const void *block)
+{
+    const uint8_t *p = block;
+    return p >= pool->storage && p < pool->storage + pool->block_size * pool->count;
+}
+
+void *mem_heap_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    taskENTER_CRITICAL(&stats_lock);
+    if (ptr != NULL)
+    {
+        stats.heap_allocs++;
+    }
+    else
+    {
+        stats.heap_failures++;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+    return ptr;
+}
+
+void *mem_heap_calloc(size_t n, size_t size)
+{
+    void *ptr = calloc(n, size);
+    taskENTER_CRITICAL(&stats_lock);
+    if (ptr != NULL)
+    {
+        stats.heap_allocs++;
+    }
+    else
+    {
+        stats.heap_failures++;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+    return ptr;
+}
+
+void mem_heap_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    free(ptr);
+    taskENTER_CRITICAL(&stats_lock);
+    stats.heap_frees++;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void mem_stats_note_arena_reset(void)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    stats.arena_resets++;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void mem_stats_get(mem_stats_t *out)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void mem_stats_print(void)
+{
+    mem_stats_t s;
+    mem_stats_get(&s);
+    printf("heap: %lu allocs, %lu frees, %lu failed, %lu arena resets\n",
+           (unsigned long)s.heap_allocs, (unsigned long)s.heap_frees,
+           (unsigned long)s.heap_failures, (unsigned long)s.arena_resets);
+    for (mem_pool_t *p = pools; p != NULL; p = p->next)
+    {
+        printf("pool %-14s %u/%u used, peak %u, %lu allocs, %lu full\n", p->name,
+               p->used, p->count, p->peak, (unsigned long)p->allocs, (unsigned long)p->failures);
+    }
+    // 系统堆的已分配块数覆盖分配器层之外的调用，稳定跟踪时两次查看应保持不变
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+    printf("system heap: %lu blocks allocated, %lu free, minimum %lu\n",
+           (unsigned long)info.allocated_blocks, (unsigned long)esp_get_free_heap_size(),
+           (unsigned long)esp_get_minimum_free_heap_size());
+}
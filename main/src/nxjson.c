@@ -33,6 +33,33 @@ extern "C" {
 #include <errno.h>
 
 #include "nxjson.h"
+#include "mem_pool.h"
+
+// 节点优先从固定块池分配，池满时回退到计数的堆分配
+#define NX_JSON_POOL_NODES 32
+#define NX_JSON_CALLOC() nx_json_node_alloc()
+#define NX_JSON_FREE(json) nx_json_node_free((nx_json*)(json))
+
+static nx_json nx_json_pool_storage[NX_JSON_POOL_NODES];
+static mem_pool_t nx_json_pool;
+
+static nx_json* nx_json_node_alloc(void) {
+  nx_json* js;
+  if (!nx_json_pool.storage) {
+    mem_pool_init(&nx_json_pool, "nx_json", nx_json_pool_storage, sizeof(nx_json), NX_JSON_POOL_NODES);
+  }
+  js=mem_pool_alloc(&nx_json_pool);
+  if (js) {
+    memset(js, 0, sizeof(nx_json));
+    return js;
+  }
+  return mem_heap_calloc(1, sizeof(nx_json));
+}
+
+static void nx_json_node_free(nx_json* js) {
+  if (mem_pool_owns(&nx_json_pool, js)) mem_pool_free(&nx_json_pool, js);
+  else mem_heap_free(js);
+}
 
 // redefine NX_JSON_CALLOC & NX_JSON_FREE to use custom allocator
 #ifndef NX_JSON_CALLOC
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define SGP4SDP4_CONSTANTS
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "orbit_propagator.h"
+
+#define TAG "orbit_propagator"
+
+static SemaphoreHandle_t propagator_mux = NULL;
+static const orbit_t *loaded_orbit = NULL;     // 当前SGP4/SDP4静态状态对应的卫星
+static int loaded_catnr = -1;
+static double loaded_epoch = 0;
+
+esp_err_t orbit_propagator_init(void)
+{
+    if (propagator_mux == NULL)
+    {
+        propagator_mux = xSemaphoreCreateMutex();
+    }
+    return propagator_mux != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void orbit_observer_geodetic(geodetic_t *obs)
+{
+    obs->lat = Radians(OBSERVER_LAT_DEG);
+    obs->lon = Radians(OBSERVER_LON_DEG);
+    obs->alt = OBSERVER_ALT_KM;
+    obs->theta = 0.0;
+}
+
+int orbit_load(orbit_t *orb, FILE *fp, char *sat_name)
+{
+    int flg = Input_Tle_Set(fp, &orb->tle, sat_name);
+    if (flg != 0)
+    {
+        return flg;
+    }
+
+    xSemaphoreTake(propagator_mux, portMAX_DELAY);
+    /* select_ephemeris() sets or clears DEEP_SPACE_EPHEM_FLAG, */
+    /* so the propagator state must be reset afterwards         */
+    ClearFlag(ALL_FLAGS);
+    select_ephemeris(&orb->tle);
+    orb->deep_space = isFlagSet(DEEP_SPACE_EPHEM_FLAG) != 0;
+    loaded_orbit = NULL;
+    xSemaphoreGive(propagator_mux);
+    return 0;
+}
+
+double orbit_tsince(const orbit_t *orb, double jul_utc)
+{
+    return (jul_utc - Julian_Date_of_Epoch(orb->tle.epoch)) * xmnpda;
+}
+
+// 调用者需持有propagator_mux
+static void propagate_locked(orbit_t *orb, double tsince, vector_t *pos, vector_t *vel)
+{
+    // 另一颗卫星（或同一卫星的新根数）使用过传播器，清除标志位使SGP4/SDP4重新初始化
+    if (loaded_orbit != orb || loaded_catnr != orb->tle.catnr || loaded_epoch != orb->tle.epoch)
+    {
+        ClearFlag(ALL_FLAGS);
+        if (orb->deep_space)
+            SetFlag(DEEP_SPACE_EPHEM_FLAG);
+        loaded_orbit = orb;
+        loaded_catnr = orb->tle.catnr;
+        loaded_epoch = orb->tle.epoch;
+    }
+
+    if (orb->deep_space)
+        SDP4(tsince, &orb->tle, pos, vel);
+    else
+        SGP4(tsince, &orb->tle, pos, vel);
+}
+
+void orbit_observe(orbit_t *orb, double jul_utc, geodetic_t *obs, vector_t *pos, vector_t *vel, vector_t *obs_set)
+{
+    xSemaphoreTake(propagator_mux, portMAX_DELAY);
+    propagate_locked(orb, orbit_tsince(orb, jul_utc), pos, vel);
+    /* Scale position and velocity vectors to km and km/sec */
+    Convert_Sat_State(pos, vel);
+    Magnitude(vel);
+    /* Calculate_Obs() updates VISIBLE_FLAG, keep it inside the lock */
+    Calculate_Obs(jul_utc, pos, vel, obs, obs_set);
+    xSemaphoreGive(propagator_mux);
+}
+
+void orbit_observe_sun(double jul_utc, geodetic_t *obs, vector_t *solar_vector, vector_t *solar_set)
+{
+    vector_t zero_vector = {0, 0, 0, 0};
+
+    xSemaphoreTake(propagator_mux, portMAX_DELAY);
+    Calculate_Obs(jul_utc, solar_vector, &zero_vector, obs, solar_set);
+    xSemaphoreGive(propagator_mux);
+}
+
+static double elevation_at(orbit_t *orb, geodetic_t *obs, double jul_utc)
+{
+    vector_t pos, vel, obs_set;
+    orbit_observe(orb, jul_utc, obs, &pos, &vel, &obs_set);
+    return obs_set.y;
+}
+
+bool orbit_next_pass(orbit_t *orb, geodetic_t *obs, double jul_start, double span_days, double *jul_aos, double *jul_los)
+{
+    const double step = PASS_SEARCH_STEP_MIN / xmnpda;
+    double jul = jul_start;
+    double jul_end = jul_start + span_days;
+
+    // 每一步单独加锁，跟踪任务可以在搜索过程中穿插计算
+    while (jul < jul_end && elevation_at(orb, obs, jul) < 0)
+    {
+        jul += step;
+    }
+    if (jul >= jul_end)
+    {
+        return false;
+    }
+    *jul_aos = jul;
+
+    while (jul < jul_end && elevation_at(orb, obs, jul) >= 0)
+    {
+        jul += step;
+    }
+    *jul_los = jul;
+    return true;
+}
+
+bool orbit_pass_window(orbit_t *orb, geodetic_t *obs, double jul_aos, double jul_los, double min_ele_deg,
+                       double *jul_start, double *jul_end, double *max_ele_deg)
+{
+    const double step = PASS_SEARCH_STEP_MIN / xmnpda;
+    const double min_ele = Radians(min_ele_deg);
+    double max_ele = -pio2;
+    bool above = false;
+
+    *jul_start = *jul_end = jul_aos;
+    for (double jul = jul_aos; jul <= jul_los; jul += step)
+    {
+        double ele = elevation_at(orb, obs, jul);
+        max_ele = fmax(max_ele, ele);
+        if (ele >= min_ele)
+        {
+            if (!above)
+            {
+                *jul_start = jul;
+                above = true;
+            }
+            *jul_end = jul;
+        }
+    }
+    *max_ele_deg = Degrees(max_ele);
+    return above && *jul_end > *jul_start;
+}
+
+void orbit_pointing(orbit_t *orb, geodetic_t *obs, double jul_utc, double *azi_deg, double *ele_deg)
+{
+    vector_t pos, vel, obs_set;
+    orbit_observe(orb, jul_utc, obs, &pos, &vel, &obs_set);
+    *azi_deg = Degrees(obs_set.x);
+    *ele_deg = Degrees(obs_set.y);
+}
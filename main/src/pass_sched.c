@@ -0,0 +1,507 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define SGP4SDP4_CONSTANTS
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "pass_sched.h"
+#include "orbit_propagator.h"
+#include "catalog_mirror.h"
+#include "boot_prof.h"
+#include "time_sync.h"
+
+#define TAG "pass_sched"
+
+#define SCHED_HORIZON_DAYS      (CONFIG_TALLNECK_SCHED_HORIZON_H / 24.0)
+#define SCHED_MIN_WAIT_MS       1000
+#define SCHED_MAX_WAIT_MS       (60 * 60 * 1000)
+#define SCHED_PARK_AZI          0.0f    // 第一次过境前假定旋转器停在正北水平
+#define SCHED_PARK_ELE          0.0f
+
+static pass_watch_t watch_list[PASS_SCHED_MAX_WATCH];
+static int watch_count = 0;
+static uint32_t watch_generation = 0;           // 监视列表每次修改加一，时间线中的下标只对同一代有效
+
+// 候选过境和选中的时间线，按结束时间排序
+static pass_slot_t candidates[PASS_SCHED_MAX_CANDIDATES];
+static float best_weight[PASS_SCHED_MAX_CANDIDATES];
+static int16_t best_prev[PASS_SCHED_MAX_CANDIDATES];
+static pass_slot_t timeline[PASS_SCHED_MAX_CANDIDATES];
+static int timeline_count = 0;
+
+static SemaphoreHandle_t sched_mux = NULL;      // 保护监视列表和时间线
+static TaskHandle_t sched_handler = NULL;
+static bool sched_enabled = true;
+
+static double jul_now(void)
+{
+    struct tm utc;
+    struct timeval tv;
+    UTC_Calendar_Now(&utc, &tv);
+    return Julian_Date(&utc, &tv);
+}
+
+static void load_watch_list(void)
+{
+    char line[SAT_NMAE_LENGTH + 32];
+    FILE *fp = fopen(PASS_SCHED_PATH, "r");
+    watch_count = 0;
+    if (fp == NULL)
+    {
+        return;
+    }
+    while (watch_count < PASS_SCHED_MAX_WATCH && fgets(line, sizeof(line), fp) != NULL)
+    {
+        pass_watch_t *w = &watch_list[watch_count];
+        int priority;
+        if (line[0] == '#' || sscanf(line, "%d %f %127[^\r\n]", &priority, &w->min_ele, w->name) != 3)
+        {
+            continue;
+        }
+        w->priority = MIN(MAX(priority, 1), PASS_SCHED_MAX_PRIORITY);
+        watch_count++;
+    }
+    fclose(fp);
+    ESP_LOGI(TAG, "%d satellites on the watch list", watch_count);
+}
+
+static void save_watch_list(void)
+{
+    FILE *fp = fopen(PASS_SCHED_PATH, "w");
+    if (fp == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to write %s", PASS_SCHED_PATH);
+        return;
+    }
+    fprintf(fp, "# priority min_ele name\n");
+    for (int i = 0; i < watch_count; i++)
+    {
+        fprintf(fp, "%u %.1f %s\n", watch_list[i].priority, watch_list[i].min_ele, watch_list[i].name);
+    }
+    fclose(fp);
+}
+
+double pass_sched_slew_s(float azi_from, float ele_from, float azi_to, float ele_to)
+{
+    // 方位轴和俯仰轴同时转动，取较慢的一轴；方位按实际转过的角度计算，不走捷径穿越限位
+    double azi = fabs(azi_to - azi_from);
+    double ele = fabs(ele_to - ele_from);
+    return MAX(azi, ele) / CONFIG_TALLNECK_ROTATOR_SLEW_DEG_S + CONFIG_TALLNECK_ROTATOR_SETTLE_S;
+}
+
+// 预测监视列表中每颗卫星在规划时段内的全部过境，只保留高于最低仰角的部分
+static int collect_candidates(const pass_watch_t *list, int count, double now)
+{
+    const double step = PASS_SEARCH_STEP_MIN / xmnpda;
+    const double horizon = now + SCHED_HORIZON_DAYS;
+    geodetic_t obs;
+    orbit_t orb;
+    int n = 0;
+
+    orbit_observer_geodetic(&obs);
+    for (int i = 0; i < count && n < PASS_SCHED_MAX_CANDIDATES; i++)
+    {
+        char name[SAT_NMAE_LENGTH];
+        strlcpy(name, list[i].name, sizeof(name));
+        tle_prefetch_watch(name);  // 计划跟踪的卫星同样需要保持根数新鲜
+
+        FILE *fp = catalog_open();
+        if (fp == NULL)
+        {
+            return n;
+        }
+        int flg = orbit_load(&orb, fp, name);
+        fclose(fp);
+        if (flg != 0)
+        {
+            ESP_LOGW(TAG, "%s not found in the catalog", name);
+            continue;
+        }
+
+        double aos, los, start, end, max_ele, azi, ele;
+        double t = now;
+        while (n < PASS_SCHED_MAX_CANDIDATES && orbit_next_pass(&orb, &obs, t, horizon - t, &aos, &los))
+        {
+            t = los + step;
+            if (!orbit_pass_window(&orb, &obs, aos, los, list[i].min_ele, &start, &end, &max_ele))
+            {
+                continue;
+            }
+            pass_slot_t *slot = &candidates[n++];
+            slot->watch = i;
+            slot->start = start;
+            slot->end = end;
+            slot->max_ele = max_ele;
+            orbit_pointing(&orb, &obs, start, &azi, &ele);
+            slot->start_azi = azi;
+            slot->start_ele = ele;
+            orbit_pointing(&orb, &obs, end, &azi, &ele);
+            slot->end_azi = azi;
+            slot->end_ele = ele;
+            slot->weight = list[i].priority * (end - start) * xmnpda;
+        }
+    }
+    return n;
+}
+
+static int compare_end(const void *a, const void *b)
+{
+    const pass_slot_t *x = a, *y = b;
+    return (x->end > y->end) - (x->end < y->end);
+}
+
+// 带权区间调度：按结束时间排序，best_weight[j]为以j结尾的最优时间线的总权重。
+// 前后两次过境之间要留出旋转器转动时间，相容关系不随结束时间单调，因此逐对比较，n很小
+// 规划期间监视列表被修改时丢弃结果并返回false，时间线保持修改时清空的状态
+static bool build_timeline(double now)
+{
+    pass_watch_t list[PASS_SCHED_MAX_WATCH];
+    int count;
+    uint32_t gen;
+
+    xSemaphoreTake(sched_mux, portMAX_DELAY);
+    count = watch_count;
+    gen = watch_generation;
+    memcpy(list, watch_list, sizeof(list));
+    xSemaphoreGive(sched_mux);
+
+    int n = collect_candidates(list, count, now);
+    qsort(candidates, n, sizeof(candidates[0]), compare_end);
+
+    int last = -1;
+    for (int j = 0; j < n; j++)
+    {
+        best_weight[j] = candidates[j].weight;
+        best_prev[j] = -1;
+        for (int i = 0; i < j; i++)
+        {
+            double gap_s = (candidates[j].start - candidates[i].end) * secday;
+            if (gap_s < 0 || best_weight[i] + candidates[j].weight <= best_weight[j])
+            {
+                continue;
+            }
+            if (gap_s >= pass_sched_slew_s(candidates[i].end_azi, candidates[i].end_ele,
+                                           candidates[j].start_azi, candidates[j].start_ele))
+            {
+                best_weight[j] = best_weight[i] + candidates[j].weight;
+                best_prev[j] = i;
+            }
+        }
+        if (last < 0 || best_weight[j] > best_weight[last])
+        {
+            last = j;
+        }
+    }
+
+    xSemaphoreTake(sched_mux, portMAX_DELAY);
+    if (gen != watch_generation)
+    {
+        xSemaphoreGive(sched_mux);
+        ESP_LOGI(TAG, "Watch list changed while planning, replanning");
+        return false;
+    }
+    timeline_count = 0;
+    for (int j = last; j >= 0; j = best_prev[j])
+    {
+        timeline_count++;
+    }
+    int k = timeline_count;
+    for (int j = last; j >= 0; j = best_prev[j])
+    {
+        timeline[--k] = candidates[j];
+    }
+    // 提前发出跟踪命令，旋转器在过境开始时已转到入境方位
+    float azi = SCHED_PARK_AZI, ele = SCHED_PARK_ELE;
+    double prev_end = now;
+    for (k = 0; k < timeline_count; k++)
+    {
+        pass_slot_t *slot = &timeline[k];
+        double lead = pass_sched_slew_s(azi, ele, slot->start_azi, slot->start_ele) / secday;
+        slot->launch = MAX(slot->start - lead, prev_end);
+        azi = slot->end_azi;
+        ele = slot->end_ele;
+        prev_end = slot->end;
+    }
+    xSemaphoreGive(sched_mux);
+
+    ESP_LOGI(TAG, "%d candidate passes, %d scheduled, %.0f weighted minutes",
+             n, timeline_count, last >= 0 ? best_weight[last] : 0.0f);
+    return true;
+}
+
+// 等待跟踪任务处理完结束命令，避免随后的开始命令覆盖掉尚未处理的结束通知
+static void stop_tracking(void)
+{
+    xTaskNotify(orbit_trking_handler, END_ORB_TRKING, eSetValueWithOverwrite);
+    for (int i = 0; i < 60 && orbit_trking_busy(); i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+static void start_tracking(const char *name)
+{
+    char satname[SAT_NMAE_LENGTH] = {0};
+
+    if (orbit_trking_busy())
+    {
+        stop_tracking();
+    }
+    strlcpy(satname, name, sizeof(satname));
+    xTaskNotify(orbit_trking_handler, START_ORB_TRKING, eSetValueWithOverwrite);
+    if (xQueueSend(SatnameQueueHandler, satname, pdMS_TO_TICKS(100)) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to send %s to the tracker", name);
+    }
+}
+
+// 时钟跳变（启动后首次同步）后按新的时间重新规划，平滑校正不影响时间线
+static void on_time_sync(const time_sync_event_t *event, void *ctx)
+{
+    if (event->stepped && sched_handler != NULL)
+    {
+        xTaskNotify(sched_handler, PASS_SCHED_REBUILD, eSetBits);
+    }
+}
+
+void pass_sched_task(void *pvParameter)
+{
+    char active[SAT_NMAE_LENGTH] = {0};     // 正在跟踪的卫星，空表示空闲
+    double active_end = 0;
+    double rebuild_at = 0;
+    uint32_t generation = 0;
+    bool rebuild = true;
+
+    sched_handler = xTaskGetCurrentTaskHandle();
+    sched_mux = xSemaphoreCreateMutex();
+    time_sync_register_cb(on_time_sync, NULL);
+    boot_stage_wait(BOOT_STAGE_STORAGE);
+    xSemaphoreTake(sched_mux, portMAX_DELAY);
+    load_watch_list();
+    xSemaphoreGive(sched_mux);
+
+    while (1)
+    {
+        uint32_t bits = 0;
+        double now = jul_now();
+
+        if (sched_enabled && (rebuild || now >= rebuild_at || catalog_generation() != generation))
+        {
+            generation = catalog_generation();
+            rebuild = !build_timeline(now);
+            rebuild_at = now + SCHED_HORIZON_DAYS / 2;
+            now = jul_now();
+
+            // 正在进行的过境仍在新时间线上时继续跟踪，否则让位给新的安排
+            if (active[0] != '\0')
+            {
+                bool keep = false;
+                xSemaphoreTake(sched_mux, portMAX_DELAY);
+                for (int k = 0; k < timeline_count; k++)
+                {
+                    pass_slot_t *slot = &timeline[k];
+                    if (slot->launch <= now && slot->end > now && strcmp(watch_list[slot->watch].name, active) == 0)
+                    {
+                        keep = true;
+                        active_end = slot->end;
+                    }
+                }
+                xSemaphoreGive(sched_mux);
+                if (!keep)
+                {
+                    stop_tracking();
+                    active[0] = '\0';
+                }
+            }
+        }
+
+        if (!sched_enabled)
+        {
+            if (active[0] != '\0')
+            {
+                stop_tracking();
+                active[0] = '\0';
+            }
+            xTaskNotifyWait(0x00, 0xFFFFFFFF, &bits, portMAX_DELAY);
+        }
+        else
+        {
+            if (active[0] != '\0' && now >= active_end)
+            {
+                ESP_LOGI(TAG, "Pass of %s finished", active);
+                stop_tracking();
+                active[0] = '\0';
+            }
+
+            // 找到下一个尚未开始的过境，到了发令时间就开始跟踪
+            double wake = rebuild_at;
+            bool launch = false;
+            float max_ele = 0;
+            xSemaphoreTake(sched_mux, portMAX_DELAY);
+            for (int k = 0; k < timeline_count; k++)
+            {
+                pass_slot_t *slot = &timeline[k];
+                if (slot->end <= now || (active[0] != '\0' && slot->start < active_end))
+                {
+                    continue;
+                }
+                if (active[0] == '\0' && now >= slot->launch)
+                {
+                    strlcpy(active, watch_list[slot->watch].name, sizeof(active));
+                    active_end = slot->end;
+                    max_ele = slot->max_ele;
+                    launch = true;
+                    continue;
+                }
+                wake = MIN(wake, slot->launch);
+                break;
+            }
+            xSemaphoreGive(sched_mux);
+
+            if (launch)
+            {
+                ESP_LOGI(TAG, "Starting pass of %s, max elevation %.1f", active, max_ele);
+                start_tracking(active);
+            }
+            if (active[0] != '\0')
+            {
+                wake = MIN(wake, active_end);
+            }
+
+            double wait_ms = (wake - jul_now()) * secday * 1000.0;
+            wait_ms = MIN(MAX(wait_ms, SCHED_MIN_WAIT_MS), SCHED_MAX_WAIT_MS);
+            xTaskNotifyWait(0x00, 0xFFFFFFFF, &bits, pdMS_TO_TICKS((uint32_t)wait_ms));
+        }
+
+        if (bits & PASS_SCHED_ENABLE)
+        {
+            sched_enabled = true;
+        }
+        if (bits & PASS_SCHED_DISABLE)
+        {
+            sched_enabled = false;
+        }
+        if (bits & (PASS_SCHED_REBUILD | PASS_SCHED_ENABLE))
+        {
+            rebuild = true;
+        }
+    }
+}
+
+static void print_timeline(void)
+{
+    struct tm t0, t1;
+
+    printf("scheduler %s, %d watched:\n", sched_enabled ? "on" : "off", watch_count);
+    for (int i = 0; i < watch_count; i++)
+    {
+        printf("  p%u min %.0f  %s\n", watch_list[i].priority, watch_list[i].min_ele, watch_list[i].name);
+    }
+    for (int k = 0; k < timeline_count; k++)
+    {
+        pass_slot_t *slot = &timeline[k];
+        Date_Time(slot->start, &t0);
+        Date_Time(slot->end, &t1);
+        printf("  %02d-%02d %02d:%02d-%02d:%02d UTC  max %4.1f  az %3.0f->%3.0f  %s\n",
+               t0.tm_mon + 1, t0.tm_mday, t0.tm_hour, t0.tm_min, t1.tm_hour, t1.tm_min,
+               slot->max_ele, slot->start_azi, slot->end_azi, watch_list[slot->watch].name);
+    }
+}
+
+void pass_sched_command(const char *line)
+{
+    const char *args = strstr(line, "sched");
+    uint32_t notify = 0;
+
+    if (sched_mux == NULL || args == NULL)
+    {
+        return;
+    }
+    args += strlen("sched");
+    while (*args == ' ')
+    {
+        args++;
+    }
+
+    xSemaphoreTake(sched_mux, portMAX_DELAY);
+    if (strncmp(args, "add", 3) == 0)
+    {
+        pass_watch_t w = {0};
+        int priority;
+        if (sscanf(args + 3, "%d %f %127[^\r\n]", &priority, &w.min_ele, w.name) != 3)
+        {
+            printf("usage: sched add <priority 1-%d> <min elevation> <name>\n", PASS_SCHED_MAX_PRIORITY);
+        }
+        else if (watch_count >= PASS_SCHED_MAX_WATCH)
+        {
+            printf("Watch list is full (%d).\n", PASS_SCHED_MAX_WATCH);
+        }
+        else
+        {
+            w.priority = MIN(MAX(priority, 1), PASS_SCHED_MAX_PRIORITY);
+            watch_list[watch_count++] = w;
+            watch_generation++;
+            save_watch_list();
+            notify = PASS_SCHED_REBUILD;
+        }
+    }
+    else if (strncmp(args, "del", 3) == 0)
+    {
+        char name[SAT_NMAE_LENGTH] = {0};
+        sscanf(args + 3, " %127[^\r\n]", name);
+        for (int i = 0; i < watch_count; i++)
+        {
+            if (strcmp(watch_list[i].name, name) == 0)
+            {
+                memmove(&watch_list[i], &watch_list[i + 1], (watch_count - i - 1) * sizeof(watch_list[0]));
+                watch_count--;
+                watch_generation++;
+                timeline_count = 0;  // 下标已失效
+                save_watch_list();
+                notify = PASS_SCHED_REBUILD;
+                break;
+            }
+        }
+        if (notify == 0)
+        {
+            printf("%s is not on the watch list.\n", name);
+        }
+    }
+    else if (strncmp(args, "on", 2) == 0)
+    {
+        notify = PASS_SCHED_ENABLE;
+    }
+    else if (strncmp(args, "off", 3) == 0)
+    {
+        notify = PASS_SCHED_DISABLE;
+    }
+    else
+    {
+        print_timeline();
+    }
+    xSemaphoreGive(sched_mux);
+
+    if (notify != 0)
+    {
+        xTaskNotify(sched_handler, notify, eSetBits);
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "setpoint.h"
+
+/**
+ * 单槽邮箱：生产者在临界区内覆盖槽位并分配序号，然后通知电机任务。
+ * 电机任务只取序号比上次大的目标，被覆盖的旧目标直接作废，不会排队执行
+ */
+static portMUX_TYPE slot_lock = portMUX_INITIALIZER_UNLOCKED;
+static rot_setpoint_t slot;
+static uint32_t taken_seq;
+static TaskHandle_t consumer;
+static setpoint_stats_t stats;
+
+void setpoint_bind_consumer(void)
+{
+    taskENTER_CRITICAL(&slot_lock);
+    consumer = xTaskGetCurrentTaskHandle();
+    taskEXIT_CRITICAL(&slot_lock);
+}
+
+uint32_t setpoint_post(float azimuth, float elevation, setpoint_source_t source)
+{
+    return setpoint_post_stamped(azimuth, elevation, source, 0, 0);
+}
+
+uint32_t setpoint_post_stamped(float azimuth, float elevation, setpoint_source_t source,
+                               int64_t recv_us, int64_t parse_us)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t seq;
+    TaskHandle_t task;
+
+    taskENTER_CRITICAL(&slot_lock);
+    if (slot.seq != taken_seq)
+    {
+        stats.overwritten++;
+    }
+    seq = ++slot.seq;
+    slot.source = source;
+    slot.time_us = now;
+    slot.recv_us = recv_us;
+    slot.parse_us = parse_us;
+    slot.azimuth = azimuth;
+    slot.elevation = elevation;
+    stats.posted++;
+    task = consumer;
+    taskEXIT_CRITICAL(&slot_lock);
+
+    // 通知只是唤醒信号，多次投递合并为一次
+    if (task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+    return seq;
+}
+
+static bool slot_take(rot_setpoint_t *sp)
+{
+    bool fresh;
+    taskENTER_CRITICAL(&slot_lock);
+    fresh = slot.seq != taken_seq;
+    if (fresh)
+    {
+        *sp = slot;
+        taken_seq = slot.seq;
+        stats.taken++;
+    }
+    taskEXIT_CRITICAL(&slot_lock);
+    return fresh;
+}
+
+bool setpoint_take(rot_setpoint_t *sp, TickType_t wait)
+{
+    // 绑定之前投递的目标没有通知，先检查槽位
+    if (slot_take(sp))
+    {
+        return true;
+    }
+    while (ulTaskNotifyTake(pdTRUE, wait) != 0)
+    {
+        if (slot_take(sp))
+        {
+            return true;
+        }
+        // 通知对应的目标已在上次检查时取走，继续等待
+    }
+    return false;
+}
+
+bool setpoint_last(rot_setpoint_t *sp)
+{
+    taskENTER_CRITICAL(&slot_lock);
+    *sp = slot;
+    taskEXIT_CRITICAL(&slot_lock);
+    return sp->seq != 0;
+}
+
+void setpoint_get_stats(setpoint_stats_t *out)
+{
+    taskENTER_CRITICAL(&slot_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&slot_lock);
+}
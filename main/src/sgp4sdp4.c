@@ -11,10 +11,22 @@
 
 #define SGP4SDP4_CONSTANTS
 #include "sgp4sdp4.h"
+#include "orbit_propagator.h"
+#include "catalog_mirror.h"
+#include "tle_prefetch.h"
+#include "track_snapshot.h"
+#include "track_recorder.h"
+#include "boot_prof.h"
+#include "state_bus.h"
+#include "track_tick.h"
+#include "setpoint.h"
+#include "trajectory.h"
 
 #define TAG 		"orbit_trking"
+#define TRACK_LOG_PERIOD_MS	2000	/* Console output rate while tracking */
 
 FILE *tle_fp;
+static volatile bool trking_busy = false;
 float latitude;
 float longitude;
 
@@ -22,18 +34,15 @@ void orbit_trking_task(void)
 {
 	BaseType_t sat_queue_rxstatus;
 	BaseType_t task_notify_status;
-	/* TLE source file */
-	char tle_file[] = FLASH_FILE_PATH;
 
 	/* Observer's geodetic co-ordinates.      */
 	/* Lat North, Lon East in rads, Alt in km */
 	
-	// 深圳经纬度: 22.3349, 114.1036
-	// 哈尔滨经纬度：45.4915, 126.3848
-	geodetic_t obs_geodetic = {45.4915 * pi / 180.0, 126.3848 * pi / 180.0, 0.15, 0.0};
+	geodetic_t obs_geodetic;
 
 	/* Two-line Orbital Elements for the satellite */
-	tle_t tle ;
+	orbit_t orb;
+	uint32_t loaded_generation = 0;
 
 	/* Zero vector for initializations */
 	vector_t zero_vector = {0,0,0,0};
@@ -57,8 +66,6 @@ void orbit_trking_task(void)
 	geodetic_t sat_geodetic;
 
 	double
-	tsince,            /* Time since epoch (in minutes) */
-	jul_epoch,         /* Julian date of epoch          */
 	jul_utc,           /* Julian UTC date               */
 	eclipse_depth = 0, /* Depth of satellite eclipse    */
 	/* Satellite's observed position, range, range rate */
@@ -77,23 +84,63 @@ void orbit_trking_task(void)
 
 	char input_satname[128] = {0};
 
+	/* Pointing telemetry, recorded during passes only */
+	track_rec_sample_t rec_sample;
+	rot_setpoint_t rec_sp;
+	bool was_in_pass = false;
+
+	/* Latest state, published to the GUI and other readers */
+	track_state_t bus_state = {0};
+
+	/* Previous pointing, used to estimate the axis rates for the tick */
+	int64_t now_ms, prev_ms = 0, last_log_ms = 0;
+	double prev_azi = 0, prev_ele = 0, azi_rate = 0, ele_rate = 0;
+
+	/* Session restored from NVS after a reset */
+	track_snapshot_t snap;
+	bool resuming = track_snapshot_resume(&snap);
+
+	orbit_observer_geodetic(&obs_geodetic);
+	track_tick_init();
+
 	do  /* Loop */
 	{
 		int status = NO_EVENT;
-        task_notify_status = xTaskNotifyWait(0x00, 0xFFFFFFFF, &status, pdMS_TO_TICKS(portMAX_DELAY));  // 接收任务通知，开启跟踪模式
-		if (task_notify_status != pdPASS)
+		if (resuming)
 		{
-			ESP_LOGE(TAG, "Failed to receive start tracking notification.\n");
+			status = START_ORB_TRKING;  // 复位前正在跟踪，不等待串口命令直接恢复
+		}
+		else
+		{
+			task_notify_status = xTaskNotifyWait(0x00, 0xFFFFFFFF, &status, pdMS_TO_TICKS(portMAX_DELAY));  // 接收任务通知，开启跟踪模式
+			if (task_notify_status != pdPASS)
+			{
+				ESP_LOGE(TAG, "Failed to receive start tracking notification.\n");
+			}
 		}
-		// 在这里打开tle文件，修改tle解析函数，将输入参数更改为tle的文件指针
-		if ((tle_fp = fopen(tle_file, "r")) == NULL)
-			exit(1);
 		if (START_ORB_TRKING == status)
 		{
-			sat_queue_rxstatus = xQueueReceive(SatnameQueueHandler, input_satname, portMAX_DELAY);  // 接收需要跟踪的业余卫星名字
-			if (pdPASS == sat_queue_rxstatus)
+			if (resuming)
+				sat_queue_rxstatus = pdPASS;
+			else
+				sat_queue_rxstatus = xQueueReceive(SatnameQueueHandler, input_satname, portMAX_DELAY);  // 接收需要跟踪的业余卫星名字
+			if (pdPASS == sat_queue_rxstatus && resuming)
 			{
-				flg = Input_Tle_Set(tle_fp, &tle, input_satname);  // 解析需要的业余卫星tle
+				/* Elements were preprocessed before the reset, skip the TLE file */
+				orb = snap.orb;
+				obs_geodetic = snap.obs;
+				strlcpy(input_satname, snap.sat_name, sizeof(input_satname));
+				loaded_generation = catalog_generation();
+				ESP_LOGI(TAG, "Resumed tracking %s from snapshot", orb.tle.sat_name);
+			}
+			if (pdPASS == sat_queue_rxstatus && !resuming)
+			{
+				// 在这里打开tle文件，修改tle解析函数，将输入参数更改为tle的文件指针
+				if ((tle_fp = catalog_open()) == NULL)
+					exit(1);
+				loaded_generation = catalog_generation();
+				flg = orbit_load(&orb, tle_fp, input_satname);  // 解析需要的业余卫星tle并预处理
+				fclose(tle_fp);
 
 				/* Abort if file open fails */
 				if( flg == -1 )
@@ -103,7 +150,7 @@ void orbit_trking_task(void)
 				}
 
 				/* Print satellite name and TLE read status */
-				ESP_LOGI(TAG, " %s: ", tle.sat_name);
+				ESP_LOGI(TAG, " %s: ", orb.tle.sat_name);
 				if( REACH_END_OF_FILE == flg )
 				{
 					ESP_LOGE(TAG, "The program reach the end of the file\n");
@@ -116,6 +163,15 @@ void orbit_trking_task(void)
 				}
 				else
 					ESP_LOGI(TAG, "TLE set good - Happy Tracking!\n");
+			}
+			if (pdPASS == sat_queue_rxstatus)
+			{
+				resuming = false;
+				tle_prefetch_watch(input_satname);  // 跟踪中的卫星加入根数时效监视
+				track_snapshot_begin(input_satname, &orb, &obs_geodetic);  // 复位后可以直接恢复
+				track_recorder_start(orb.tle.catnr);
+				state_bus_set_target(orb.tle.sat_name, orb.tle.catnr);
+				was_in_pass = false;
 
 				/* Printout of tle set data for tests if needed */
 				/*  printf("\n %s %s %i  %i  %i\n"
@@ -126,73 +182,73 @@ void orbit_trking_task(void)
 					tle.xincl, tle.xnodeo, tle.eo, tle.omegao, tle.xmo, tle.xno);
 				*/
 
-				/** !Clear all flags! **/
-				/* Before calling a different ephemeris  */
-				/* or changing the TLE set, flow control */
-				/* flags must be cleared in main().      */
-				ClearFlag(ALL_FLAGS);
-
-				/** Select ephemeris type **/
-				/* Will set or clear the DEEP_SPACE_EPHEM_FLAG       */
-				/* depending on the TLE parameters of the satellite. */
-				/* It will also pre-process tle members for the      */
-				/* ephemeris functions SGP4 or SDP4 so this function */
-				/* must be called each time a new tle set is used    */
-				select_ephemeris(&tle);
-			
+				/* ClearFlag(ALL_FLAGS) and select_ephemeris() are done */
+				/* by orbit_load(), the propagator re-initializes      */
+				/* itself whenever another satellite was computed      */
+
+				/* The tick is driven by an esp_timer deadline, its period */
+				/* follows the axis rates, see track_tick_period()         */
+				prev_ms = 0;
+				azi_rate = ele_rate = 0;
+				trking_busy = true;
+				track_tick_start();
 				while (1)
 				{
-					task_notify_status = xTaskNotifyWait(0x00, 0xFFFFFFFF, &status, pdMS_TO_TICKS(1000 / portTICK_PERIOD_MS));
+					status = NO_EVENT;
+					/* Timeout only guards against a lost timer notification */
+					task_notify_status = xTaskNotifyWait(0x00, 0xFFFFFFFF, &status, pdMS_TO_TICKS(2 * CONFIG_TALLNECK_TRACK_TICK_IDLE_MS));
 					if (END_ORB_TRKING == status)
+					{
+						track_tick_stop();
+						track_snapshot_clear();
+						track_recorder_flush();
+						trking_busy = false;
 						goto REFRESH;
+					}
+					track_tick_woke();
+
+					// 目录已被更新（下载或上传），重新读取当前卫星的根数
+					if (catalog_generation() != loaded_generation)
+					{
+						orbit_t fresh;
+						loaded_generation = catalog_generation();
+						if ((tle_fp = catalog_open()) != NULL)
+						{
+							if (orbit_load(&fresh, tle_fp, input_satname) == 0)
+							{
+								orb = fresh;
+								ESP_LOGI(TAG, "Reloaded elements of %s", orb.tle.sat_name);
+								track_snapshot_begin(input_satname, &orb, &obs_geodetic);
+							}
+							fclose(tle_fp);
+						}
+					}
 
 					/* Get UTC calendar and convert to Julian */
 					UTC_Calendar_Now(&utc, &tv);
 					jul_utc = Julian_Date(&utc, &tv);
 
-					/* Convert satellite's epoch time to Julian  */
-					/* and calculate time since epoch in minutes */
-					jul_epoch = Julian_Date_of_Epoch(tle.epoch);
-					tsince = (jul_utc - jul_epoch) * xmnpda;
-
 					/* Copy the ephemeris type in use to ephem string */
-					if( isFlagSet(DEEP_SPACE_EPHEM_FLAG) )
-						strcpy(ephem,"SDP4");
-					else
-						strcpy(ephem,"SGP4");
-
-					/* Call NORAD routines according to deep-space flag */
-					if( isFlagSet(DEEP_SPACE_EPHEM_FLAG) )
-						SDP4(tsince, &tle, &pos, &vel);
-					else
-						SGP4(tsince, &tle, &pos, &vel);
-
-					/* Scale position and velocity vectors to km and km/sec */
-					Convert_Sat_State( &pos, &vel );
-
-					/* Calculate velocity of satellite */
-					Magnitude( &vel );
-					sat_vel = vel.w;
+					strcpy(ephem, orb.deep_space ? "SDP4" : "SGP4");
 
 					/** All angles in rads. Distance in km. Velocity in km/s **/
-					/* Calculate satellite Azi, Ele, Range and Range-rate */
-					Calculate_Obs(jul_utc, &pos, &vel, &obs_geodetic, &obs_set);
+					/* Propagate and calculate satellite Azi, Ele, Range and Range-rate */
+					orbit_observe(&orb, jul_utc, &obs_geodetic, &pos, &vel, &obs_set);
+					sat_vel = vel.w;
 
 					/* Calculate satellite Lat North, Lon East and Alt. */
 					Calculate_LatLonAlt(jul_utc, &pos, &sat_geodetic);
 
 					/* Calculate solar position and satellite eclipse depth */
 					/* Also set or clear the satellite eclipsed flag accordingly */
+					/* The flags are shared with other propagator users, */
+					/* so the eclipse status is kept locally             */
 					Calculate_Solar_Position(jul_utc, &solar_vector);
-					Calculate_Obs(jul_utc,&solar_vector,&zero_vector,&obs_geodetic,&solar_set);
-
-					if( Sat_Eclipsed(&pos, &solar_vector, &eclipse_depth) )
-						SetFlag( SAT_ECLIPSED_FLAG );
-					else
-						ClearFlag( SAT_ECLIPSED_FLAG );
+					orbit_observe_sun(jul_utc, &obs_geodetic, &solar_vector, &solar_set);
 
 					/* Copy a satellite eclipse status string in sat_status */
-					if( isFlagSet( SAT_ECLIPSED_FLAG ) )
+					bool eclipsed = Sat_Eclipsed(&pos, &solar_vector, &eclipse_depth);
+					if( eclipsed )
 						strcpy( sat_status, "Eclipsed" );
 					else
 						strcpy( sat_status, "In Sunlight" );
@@ -209,14 +265,31 @@ void orbit_trking_task(void)
 					sun_azi = Degrees(solar_set.x);
 					sun_ele = Degrees(solar_set.y);
 
-					ESP_LOGI(tle.sat_name, "\n Date: %02d/%02d/%04d UTC: %02d:%02d:%02d  Ephemeris: %s"
-						"\n Azi=%6.1f\t Ele=%6.1f\t"
-						"\n Alt=%6.1f\t  Vel=%6.3f\t"
-						"\n Stellite Status: %s - Depth: %2.3f",
-						utc.tm_mday, utc.tm_mon, utc.tm_year,
-						utc.tm_hour, utc.tm_min, utc.tm_sec, ephem,
-						sat_azi, sat_ele, sat_alt, sat_vel,
-						sat_status, eclipse_depth);
+					/* Axis rates since the previous tick, azimuth wrapped to +-180 */
+					now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+					if (prev_ms != 0 && now_ms > prev_ms)
+					{
+						double dt = (now_ms - prev_ms) / 1000.0;
+						azi_rate = remainder(sat_azi - prev_azi, 360.0) / dt;
+						ele_rate = (sat_ele - prev_ele) / dt;
+					}
+					prev_ms = now_ms;
+					prev_azi = sat_azi;
+					prev_ele = sat_ele;
+
+					/* The tick may run several times a second near zenith */
+					if (now_ms - last_log_ms >= TRACK_LOG_PERIOD_MS)
+					{
+						last_log_ms = now_ms;
+						ESP_LOGI(orb.tle.sat_name, "\n Date: %02d/%02d/%04d UTC: %02d:%02d:%02d  Ephemeris: %s"
+							"\n Azi=%6.1f\t Ele=%6.1f\t"
+							"\n Alt=%6.1f\t  Vel=%6.3f\t"
+							"\n Stellite Status: %s - Depth: %2.3f",
+							utc.tm_mday, utc.tm_mon, utc.tm_year,
+							utc.tm_hour, utc.tm_min, utc.tm_sec, ephem,
+							sat_azi, sat_ele, sat_alt, sat_vel,
+							sat_status, eclipse_depth);
+					}
 					
 					/**
 					 * @brief vanilla ouput
@@ -233,37 +306,57 @@ void orbit_trking_task(void)
 						sat_status, eclipse_depth,
 						sun_azi, sun_ele);
 					 */
-					// 在轨道跟踪任务循环中，计算完卫星参数后
-					satellite_params_t params;
-
-					// 复制计算的参数到结构体
-					strncpy(params.sat_name, tle.sat_name, sizeof(params.sat_name) - 1);
-					params.sat_name[sizeof(params.sat_name) - 1] = '\0';  // 确保字符串结束
-
-					params.sat_azi = sat_azi;
-					params.sat_ele = sat_ele;
-					params.sat_range = sat_range;
-					params.sat_range_rate = sat_range_rate;
-					params.sat_lat = sat_lat;
-					params.sat_lon = sat_lon;
-					params.sat_alt = sat_alt;
-					params.sat_vel = sat_vel;
-					strncpy(params.sat_status, sat_status, sizeof(params.sat_status) - 1);
-					params.sat_status[sizeof(params.sat_status) - 1] = '\0';
-					params.eclipse_depth = eclipse_depth;
-					memcpy(&params.utc, &utc, sizeof(struct tm));
-					strncpy(params.ephem, ephem, sizeof(params.ephem) - 1);
-					params.ephem[sizeof(params.ephem) - 1] = '\0';
-
-					// 发送到队列，覆写之前的值
-					if (SatelliteParamsQueueHandler != NULL) {
-						// 使用xQueueOverwrite确保队列中始终有最新的参数
-						if (xQueueOverwrite(SatelliteParamsQueueHandler, &params) != pdPASS) {
-							ESP_LOGW(TAG, "Failed to send satellite parameters to queue");
+					// 发布到状态总线，GUI、控制台等读者各自读取最新值，互不抢占
+					bus_state.time_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+					bus_state.azi = sat_azi;
+					bus_state.ele = sat_ele;
+					bus_state.range = sat_range;
+					bus_state.range_rate = sat_range_rate;
+					bus_state.lat = sat_lat;
+					bus_state.lon = sat_lon;
+					bus_state.alt = sat_alt;
+					bus_state.vel = sat_vel;
+					bus_state.eclipse_depth = eclipse_depth;
+					bus_state.flags = (eclipsed ? STATE_FLAG_ECLIPSED : 0)
+						| (orb.deep_space ? STATE_FLAG_DEEP_SPACE : 0)
+						| (sat_ele >= 0 ? STATE_FLAG_IN_PASS : 0);
+					state_bus_publish(&bus_state);
+
+					boot_prof_mark("first_pointing");
+					track_snapshot_update(sat_azi, sat_ele);
+
+					/* Record the pass (and its LOS tick) into the RAM ring, */
+					/* the ring goes to flash once the satellite has set    */
+					bool in_pass = sat_ele >= 0;
+					/* An uploaded trajectory owns the rotator while it runs */
+					if (in_pass && !traj_active())
+					{
+						setpoint_post(sat_azi, sat_ele, SETPOINT_SRC_TRACKER);
+					}
+					if (in_pass || was_in_pass)
+					{
+						rec_sample.time_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+						// 指令记录邮箱中最近的目标，可能来自轨迹、rotctld等其他来源
+						if (setpoint_last(&rec_sp))
+						{
+							rec_sample.azi_cmd = rec_sp.azimuth;
+							rec_sample.ele_cmd = rec_sp.elevation;
+						}
+						else
+						{
+							rec_sample.azi_cmd = 0;
+							rec_sample.ele_cmd = 0;
 						}
+						rec_sample.azi = sat_azi;
+						rec_sample.ele = sat_ele;
+						rec_sample.range_rate = sat_range_rate;
+						rec_sample.rot_state = in_pass ? TRACK_REC_ROT_TRACKING : TRACK_REC_ROT_IDLE;
+						track_recorder_append(&rec_sample);
 					}
+					was_in_pass = in_pass;
+					track_recorder_poll(in_pass);
 
-					vTaskDelay(2000 / portTICK_PERIOD_MS);
+					track_tick_schedule(track_tick_period(azi_rate, ele_rate, sat_ele));
 				}
 			}
 		}
@@ -276,6 +369,11 @@ void orbit_trking_task(void)
 
 
 
+bool orbit_trking_busy(void)
+{
+	return trking_busy;
+}
+
 /* SGP4 */
 /* This function is used to calculate the position and velocity */
 /* of near-earth (period < 225 minutes) satellites. tsince is   */
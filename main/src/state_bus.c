@@ -0,0 +1,129 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "state_bus.h"
+#include "sgp4sdp4.h"
+
+/**
+ * 单写者顺序锁：写者在写入前后各把序号加一，序号为奇数表示正在写。
+ * 读者复制数据前后序号相同且为偶数时数据完整，否则重试。写者从不等待读者，
+ * 读者之间也不互相影响。写入期间处于临界区，不会被同一核心上更高优先级的
+ * 读者抢占，否则读者会一直自旋等待无法再运行的写者
+ */
+typedef struct
+{
+    atomic_uint seq;
+    portMUX_TYPE mux;
+} seqlock_t;
+
+static void seqlock_write_begin(seqlock_t *lock)
+{
+    taskENTER_CRITICAL(&lock->mux);
+    atomic_store_explicit(&lock->seq, atomic_load_explicit(&lock->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void seqlock_write_end(seqlock_t *lock)
+{
+    atomic_store_explicit(&lock->seq, atomic_load_explicit(&lock->seq, memory_order_relaxed) + 1, memory_order_release);
+    taskEXIT_CRITICAL(&lock->mux);
+}
+
+static unsigned seqlock_read_begin(seqlock_t *lock)
+{
+    unsigned seq;
+    while ((seq = atomic_load_explicit(&lock->seq, memory_order_acquire)) & 1)
+    {
+        ;  // 写者在另一个核心的临界区内只写几十个字节，自旋很短
+    }
+    return seq;
+}
+
+static bool seqlock_read_retry(seqlock_t *lock, unsigned seq)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&lock->seq, memory_order_relaxed) != seq;
+}
+
+static seqlock_t state_lock = { .mux = portMUX_INITIALIZER_UNLOCKED };
+static track_state_t state;
+static atomic_uint generation;
+
+static seqlock_t target_lock = { .mux = portMUX_INITIALIZER_UNLOCKED };
+static char target_name[SAT_NMAE_LENGTH];
+static uint32_t target;
+static int32_t target_catnr;
+
+void state_bus_set_target(const char *name, int32_t catnr)
+{
+    seqlock_write_begin(&target_lock);
+    strlcpy(target_name, name, sizeof(target_name));
+    target_catnr = catnr;
+    target++;
+    seqlock_write_end(&target_lock);
+}
+
+void state_bus_publish(const track_state_t *next)
+{
+    uint32_t gen = atomic_load_explicit(&generation, memory_order_relaxed) + 1;
+    if (gen == 0)
+    {
+        gen = 1;  // 0保留给“没有数据”
+    }
+
+    seqlock_write_begin(&state_lock);
+    state = *next;
+    state.generation = gen;
+    state.target = target;
+    state.catnr = target_catnr;
+    seqlock_write_end(&state_lock);
+    atomic_store_explicit(&generation, gen, memory_order_release);
+}
+
+uint32_t state_bus_generation(void)
+{
+    return atomic_load_explicit(&generation, memory_order_acquire);
+}
+
+bool state_bus_read(track_state_t *out)
+{
+    unsigned seq;
+    do
+    {
+        seq = seqlock_read_begin(&state_lock);
+        *out = state;
+    } while (seqlock_read_retry(&state_lock, seq));
+    return out->generation != 0;
+}
+
+uint32_t state_bus_read_target(char *name, size_t size)
+{
+    char copy[SAT_NMAE_LENGTH];
+    uint32_t gen;
+    unsigned seq;
+    do
+    {
+        seq = seqlock_read_begin(&target_lock);
+        memcpy(copy, target_name, sizeof(copy));
+        gen = target;
+    } while (seqlock_read_retry(&target_lock, seq));
+    copy[sizeof(copy) - 1] = '\0';
+    strlcpy(name, copy, size);
+    return gen;
+}
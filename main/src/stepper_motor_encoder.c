@@ -4,10 +4,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <math.h>
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "latency_stats.h"
 #include "stepper_motor_encoder.h"
 
-QueueHandle_t RotQueueHandler;
 extern unsigned char LedStatus;
 
 static const char *TAG = "stepper_motor_encoder";
@@ -185,9 +187,16 @@ err:
     return ret;
 }
 
-// const static uint32_t accel_samples = 500;
-// const static uint32_t uniform_speed_hz = 1500;
-// const static uint32_t decel_samples = 500;
+static const uint32_t accel_samples = 500;
+static const uint32_t uniform_speed_hz = 1500;
+static const uint32_t decel_samples = 500;
+static const uint32_t start_speed_hz = 500;     // 短距离不加减速，以起步频率匀速走完
+
+static rmt_channel_handle_t motor_chan = NULL;
+static rmt_encoder_handle_t accel_motor_encoder = NULL;
+static rmt_encoder_handle_t uniform_motor_encoder = NULL;
+static rmt_encoder_handle_t decel_motor_encoder = NULL;
+static int32_t motor_position;      // 开环位置，单位步，以上电位置为0度，可超出一圈
 
 // TODO: Need two stepper motor
 void stepper_motor_encoder_init(void)
@@ -201,7 +210,6 @@ void stepper_motor_encoder_init(void)
     ESP_ERROR_CHECK(gpio_config(&en_dir_gpio_config));
 
     ESP_LOGI(TAG, "Create RMT TX channel");
-    rmt_channel_handle_t motor_chan = NULL;
     rmt_tx_channel_config_t tx_chan_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT, // select clock source
         .gpio_num = STEP_MOTOR_GPIO_STEP,
@@ -223,13 +231,11 @@ void stepper_motor_encoder_init(void)
         .start_freq_hz = 500,
         .end_freq_hz = 1500,
     };
-    rmt_encoder_handle_t accel_motor_encoder = NULL;
     ESP_ERROR_CHECK(rmt_new_stepper_motor_curve_encoder(&accel_encoder_config, &accel_motor_encoder));
 
     stepper_motor_uniform_encoder_config_t uniform_encoder_config = {
         .resolution = STEP_MOTOR_RESOLUTION_HZ,
     };
-    rmt_encoder_handle_t uniform_motor_encoder = NULL;
     ESP_ERROR_CHECK(rmt_new_stepper_motor_uniform_encoder(&uniform_encoder_config, &uniform_motor_encoder));
 
     stepper_motor_curve_encoder_config_t decel_encoder_config = {
@@ -238,48 +244,131 @@ void stepper_motor_encoder_init(void)
         .start_freq_hz = 1500,
         .end_freq_hz = 500,
     };
-    rmt_encoder_handle_t decel_motor_encoder = NULL;
     ESP_ERROR_CHECK(rmt_new_stepper_motor_curve_encoder(&decel_encoder_config, &decel_motor_encoder));
 
     ESP_LOGI(TAG, "Enable RMT channel");
     ESP_ERROR_CHECK(rmt_enable(motor_chan));
+}
+
+/**
+ * @brief   把目标方位角换算成相对当前位置的步数并设置方向，按较短方向穿越正北，
+ *          与轨迹插值一致；超出电缆缠绕限位时改走另一个方向
+ */
+static int32_t motor_plan(float azimuth)
+{
+    const int32_t rev = (int32_t)lroundf(360 * STEP_MOTOR_STEPS_PER_DEG);
+    const int32_t limit = (int32_t)lroundf(STEP_MOTOR_CABLE_WRAP_DEG * STEP_MOTOR_STEPS_PER_DEG);
+    int32_t target = (int32_t)lroundf(fmodf(azimuth, 360) * STEP_MOTOR_STEPS_PER_DEG);
+    int32_t current = motor_position % rev;
+    int32_t steps = target - current;
+
+    if (current < 0)
+    {
+        steps -= rev;
+    }
+    if (steps > rev / 2)
+    {
+        steps -= rev;
+    }
+    else if (steps <= -rev / 2)
+    {
+        steps += rev;
+    }
+    if (motor_position + steps > limit)
+    {
+        steps -= rev;
+    }
+    else if (motor_position + steps < -limit)
+    {
+        steps += rev;
+    }
+
+    if (steps != 0)
+    {
+        gpio_set_level(STEP_MOTOR_GPIO_DIR, steps > 0 ? STEP_MOTOR_SPIN_DIR_CLOCKWISE : STEP_MOTOR_SPIN_DIR_COUNTERCLOCKWISE);
+    }
+    return steps;
+}
 
-    ESP_LOGI(TAG, "Spin motor for 6000 steps: 500 accel + 5000 uniform + 500 decel");
+/**
+ * @brief   提交一次移动，距离足够时分加速、匀速、减速三段，只排入RMT队列，不等待完成
+ */
+static esp_err_t motor_submit(int32_t steps)
+{
+    uint32_t count = steps > 0 ? steps : -steps;
     rmt_transmit_config_t tx_config = {
         .loop_count = 0,
     };
+    esp_err_t err;
+
+    if (count > accel_samples + decel_samples)
+    {
+        err = rmt_transmit(motor_chan, accel_motor_encoder, &accel_samples, sizeof(accel_samples), &tx_config);
+        if (err == ESP_OK)
+        {
+            tx_config.loop_count = count - accel_samples - decel_samples;
+            err = rmt_transmit(motor_chan, uniform_motor_encoder, &uniform_speed_hz, sizeof(uniform_speed_hz), &tx_config);
+        }
+        if (err == ESP_OK)
+        {
+            tx_config.loop_count = 0;
+            err = rmt_transmit(motor_chan, decel_motor_encoder, &decel_samples, sizeof(decel_samples), &tx_config);
+        }
+    }
+    else
+    {
+        tx_config.loop_count = count;
+        err = rmt_transmit(motor_chan, uniform_motor_encoder, &start_speed_hz, sizeof(start_speed_hz), &tx_config);
+    }
+    if (err == ESP_OK)
+    {
+        motor_position += steps;
+    }
+    return err;
 }
 
 
 void rotator_controller(void *pvParameters)
 {
-    Tcp_Sentence *Tcp_Sentence_p;
-    BaseType_t RXStatus;
+    rot_setpoint_t sp;
 
+    stepper_motor_encoder_init();
+    setpoint_bind_consumer();
     while (1)
     {
-        if (uxQueueMessagesWaiting(RotQueueHandler) != 0)
+        // 只取最新的目标，电机忙时到达的旧目标已被覆盖
+        if (!setpoint_take(&sp, portMAX_DELAY))
+        {
+            continue;
+        }
+        int64_t take_us = esp_timer_get_time();
+        int64_t age_ms = (take_us - sp.time_us) / 1000;
+        if (age_ms > SETPOINT_MAX_AGE_MS)
         {
-            Tcp_Sentence_p = (Tcp_Sentence *) malloc (sizeof(Tcp_Sentence));
-            RXStatus = xQueueReceive(RotQueueHandler, &Tcp_Sentence_p, portMAX_DELAY);  // 永久等待并阻塞当前线程，直到获取来自tcp线程的观测角数据
-            if (RXStatus == pdPASS && Tcp_Sentence_p != NULL)
-            {
-                LedStatus = RECVIVING;
-                ESP_LOGI(TAG, "recv done, Azimuth: %f Elevation: %f", Tcp_Sentence_p->Azimuth, Tcp_Sentence_p->Elevation);
-                free(Tcp_Sentence_p);
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-            }
-            else
-            {
-                ESP_LOGI(TAG, "didnt receive");
-                vTaskDelay(1000 / portTICK_PERIOD_MS);
-            }
+            ESP_LOGW(TAG, "setpoint #%lu is %lld ms old, skipped", (unsigned long)sp.seq, age_ms);
+            continue;
+        }
+        LedStatus = RECVIVING;
 
+        int32_t steps = motor_plan(sp.azimuth);
+        int64_t plan_us = esp_timer_get_time();
+        if (steps == 0)
+        {
+            continue;
         }
-        else 
+        esp_err_t err = motor_submit(steps);
+        int64_t submit_us = esp_timer_get_time();
+        if (err != ESP_OK)
         {
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
+            ESP_LOGE(TAG, "rmt_transmit failed: %s", esp_err_to_name(err));
+            continue;
         }
-    }
+        // 日志放在计时之后，不计入延迟
+        latency_record(&sp, take_us, plan_us, submit_us);
+        ESP_LOGD(TAG, "setpoint #%lu from %d, Azimuth: %f Elevation: %f, %ld steps",
+                 (unsigned long)sp.seq, sp.source, sp.azimuth, sp.elevation, (long)steps);
 
+        // 等这次移动走完再取下一个目标，期间到达的目标合并为最新的一个
+        rmt_tx_wait_all_done(motor_chan, -1);
+    }
 }
@@ -17,121 +17,441 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <math.h>
 #include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
-#include "freertos/timers.h"
-#include "esp_system.h"
-#include "esp_wifi.h"
-#include "esp_event.h"
 #include "esp_log.h"
-#include "nvs_flash.h"
-#include "esp_netif.h"
-#include "protocol_examples_common.h"
-#include "driver/rmt_tx.h"
-#include "driver/gpio.h"
-
-#include "lwip/err.h"
+#include "esp_timer.h"
 #include "lwip/sockets.h"
-#include "lwip/sys.h"
-#include <lwip/netdb.h>
-
-#include "driver/gpio.h"
-#include "esp_task_wdt.h"
 #include "tcp_server.h"
-#include "stepper_motor_encoder.h"
 
 extern unsigned char LedStatus;
 
 static const char *TAG = "TCP SERVER";
 
-void do_retransmit(const int sock)
+static rotctld_client_t clients[ROTCTLD_MAX_CLIENTS];
+static int64_t line_recv_us;        // 当前命令所在数据的接收时刻
+
+// 一条命令的回复，普通模式分隔符为'\n'，扩展模式由命令前缀决定
+typedef struct
+{
+    char buf[256];
+    size_t len;
+    char sep;
+    bool ext;
+} rotctld_reply_t;
+
+typedef int (*rotctld_handler_t)(const char *args, rotctld_reply_t *reply);
+
+typedef struct
+{
+    char cmd;                   // 短命令，'\0'表示只有长命令
+    const char *name;
+    rotctld_handler_t handler;
+} rotctld_cmd_t;
+
+static void reply_append(rotctld_reply_t *reply, const char *fmt, ...)
+{
+    va_list ap;
+    if (reply->len >= sizeof(reply->buf))
+    {
+        return;
+    }
+    va_start(ap, fmt);
+    int n = vsnprintf(reply->buf + reply->len, sizeof(reply->buf) - reply->len, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+    {
+        reply->len = MIN(reply->len + n, sizeof(reply->buf) - 1);
+    }
+}
+
+// 输出一个返回值，扩展模式下带上字段名
+static void reply_value(rotctld_reply_t *reply, const char *label, const char *fmt, ...)
+{
+    char value[64];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(value, sizeof(value), fmt, ap);
+    va_end(ap);
+    if (reply->ext)
+    {
+        reply_append(reply, "%s: %s%c", label, value, reply->sep);
+    }
+    else
+    {
+        reply_append(reply, "%s\n", value);
+    }
+}
+
+// 最近一次投递的目标位置，不限来源。转台没有位置反馈，get_pos以此作答
+static void rotator_last(float *az, float *el)
+{
+    rot_setpoint_t sp;
+    if (setpoint_last(&sp))
+    {
+        *az = sp.azimuth;
+        *el = sp.elevation;
+    }
+    else
+    {
+        *az = ROTCTLD_PARK_AZ;
+        *el = ROTCTLD_PARK_EL;
+    }
+}
+
+// 投递到目标邮箱，不等待电机动作
+static int rotator_send(float az, float el)
+{
+    setpoint_post_stamped(az, el, SETPOINT_SRC_TCP, line_recv_us, esp_timer_get_time());
+    return RIG_OK;
+}
+
+static int cmd_set_pos(const char *args, rotctld_reply_t *reply)
+{
+    float az, el, rot_az, rot_el;
+    if (sscanf(args, "%f %f", &az, &el) != 2)
+    {
+        return RIG_EINVAL;
+    }
+    if (az < ROTCTLD_MIN_AZ || az > ROTCTLD_MAX_AZ || el < ROTCTLD_MIN_EL || el > ROTCTLD_MAX_EL)
+    {
+        return RIG_EINVAL;
+    }
+    rotator_last(&rot_az, &rot_el);
+#if (NOT_TRACKING_FARSIDE)
+    // 卫星位于地球背面时不转动
+    if (el < 0 || rot_el < 0)
+    {
+        return RIG_OK;
+    }
+#endif
+    // 变化太小时不驱动电机
+    if (fabsf(az - rot_az) <= DELTA_VALUE && fabsf(el - rot_el) <= DELTA_VALUE)
+    {
+        return RIG_OK;
+    }
+    return rotator_send(az, el);
+}
+
+static int cmd_get_pos(const char *args, rotctld_reply_t *reply)
 {
-    Tcp_Sentence *Tcp_Sentence_p;
-    BaseType_t TXStatus;                    
-    int len;
-    char rx_buffer[128];                    
+    float rot_az, rot_el;
+    rotator_last(&rot_az, &rot_el);
+    reply_value(reply, "Azimuth", "%f", rot_az);
+    reply_value(reply, "Elevation", "%f", rot_el);
+    return RIG_OK;
+}
+
+// 没有位置反馈，停止即保持在最近的目标位置
+static int cmd_stop(const char *args, rotctld_reply_t *reply)
+{
+    float rot_az, rot_el;
+    rotator_last(&rot_az, &rot_el);
+    return rotator_send(rot_az, rot_el);
+}
+
+static int cmd_park(const char *args, rotctld_reply_t *reply)
+{
+    return rotator_send(ROTCTLD_PARK_AZ, ROTCTLD_PARK_EL);
+}
+
+static int cmd_reset(const char *args, rotctld_reply_t *reply)
+{
+    return RIG_OK;
+}
+
+// 转台转速固定，忽略speed，向指定方向转到限位，由stop停止
+static int cmd_move(const char *args, rotctld_reply_t *reply)
+{
+    int direction, speed;
+    float rot_az, rot_el;
+    if (sscanf(args, "%d %d", &direction, &speed) != 2)
+    {
+        return RIG_EINVAL;
+    }
+    rotator_last(&rot_az, &rot_el);
+    switch (direction)
+    {
+        case 2:     // UP
+            return rotator_send(rot_az, ROTCTLD_MAX_EL);
+        case 4:     // DOWN
+            return rotator_send(rot_az, ROTCTLD_MIN_EL);
+        case 8:     // LEFT, CCW
+            return rotator_send(ROTCTLD_MIN_AZ, rot_el);
+        case 16:    // RIGHT, CW
+            return rotator_send(ROTCTLD_MAX_AZ, rot_el);
+        default:
+            return RIG_EINVAL;
+    }
+}
+
+static int cmd_get_info(const char *args, rotctld_reply_t *reply)
+{
+    reply_value(reply, "Info", "TallNeck");
+    return RIG_OK;
+}
+
+// netrotctl连接时读取，依次为协议版本、型号和转动范围
+static int cmd_dump_state(const char *args, rotctld_reply_t *reply)
+{
+    reply_value(reply, "rotctld Protocol Ver", "%d", ROTCTLD_PROT_VER);
+    reply_value(reply, "Rotor Model", "%d", ROTCTLD_MODEL);
+    reply_value(reply, "Minimum Azimuth", "%f", ROTCTLD_MIN_AZ);
+    reply_value(reply, "Maximum Azimuth", "%f", ROTCTLD_MAX_AZ);
+    reply_value(reply, "Minimum Elevation", "%f", ROTCTLD_MIN_EL);
+    reply_value(reply, "Maximum Elevation", "%f", ROTCTLD_MAX_EL);
+    return RIG_OK;
+}
+
+static const rotctld_cmd_t rotctld_cmds[] =
+{
+    { 'P',  "set_pos",      cmd_set_pos },
+    { 'p',  "get_pos",      cmd_get_pos },
+    { 'S',  "stop",         cmd_stop },
+    { 'K',  "park",         cmd_park },
+    { 'R',  "reset",        cmd_reset },
+    { 'M',  "move",         cmd_move },
+    { '_',  "get_info",     cmd_get_info },
+    { '\0', "dump_state",   cmd_dump_state },
+};
+
+/**
+ * @brief   执行一行命令并写入回复
+ *          支持短命令(P 180 45)、长命令(\set_pos 180 45)和扩展应答前缀(+ ; | ,)
+ * @return  false表示客户端请求断开
+ */
+static bool rotctld_exec(char *line, rotctld_reply_t *reply)
+{
+    const rotctld_cmd_t *cmd = NULL;
+    char name[16];
+    size_t name_len;
+
+    reply->len = 0;
+    reply->ext = false;
+    reply->sep = '\n';
+
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+    if (*line == '\0')
+    {
+        return true;
+    }
+    if (strchr("+;|,", *line) != NULL)
+    {
+        reply->ext = true;
+        reply->sep = *line == '+' ? '\n' : *line;
+        line++;
+    }
+
+    if (*line == '\\')
+    {
+        line++;
+        name_len = strcspn(line, " \t");
+        if (name_len >= sizeof(name))
+        {
+            name_len = sizeof(name) - 1;
+        }
+        memcpy(name, line, name_len);
+        name[name_len] = '\0';
+    }
+    else
+    {
+        name_len = 1;
+        name[0] = *line;
+        name[1] = '\0';
+    }
+    const char *args = line + strcspn(line, " \t");
+    while (*args == ' ' || *args == '\t')
+    {
+        args++;
+    }
+
+    if (strcmp(name, "q") == 0 || strcmp(name, "Q") == 0 || strcmp(name, "quit") == 0)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(rotctld_cmds) / sizeof(rotctld_cmds[0]); i++)
+    {
+        // 长命令也接受单字符形式，如\P
+        if ((name_len == 1 && rotctld_cmds[i].cmd != '\0' && name[0] == rotctld_cmds[i].cmd) ||
+            strcmp(name, rotctld_cmds[i].name) == 0)
+        {
+            cmd = &rotctld_cmds[i];
+            break;
+        }
+    }
+    if (cmd == NULL)
+    {
+        ESP_LOGW(TAG, "Unknown command: %s", name);
+        reply_append(reply, "RPRT %d\n", RIG_ENIMPL);
+        return true;
+    }
 
-    float prev_az = 0, prev_el = 0;
-    float curr_az = 0, curr_el = 0;
+    if (reply->ext)
+    {
+        reply_append(reply, *args != '\0' ? "%s: %s%c" : "%s:%s%c", cmd->name, args, reply->sep);
+    }
+    size_t head = reply->len;
+    int ret = cmd->handler(args, reply);
+    if (reply->ext)
+    {
+        reply_append(reply, "RPRT %d\n", ret);
+    }
+    else if (ret != RIG_OK || reply->len == head)
+    {
+        // 普通模式下查询成功只回复数值，设置命令和出错时回复RPRT
+        reply->len = head;
+        reply_append(reply, "RPRT %d\n", ret);
+    }
+    return true;
+}
 
-    float delta_az, delta_el;
+static void rotctld_close(rotctld_client_t *client)
+{
+    shutdown(client->sock, 0);
+    close(client->sock);
+    client->sock = -1;
+    client->len = 0;
+    LedStatus = CONNECTED;
+}
+
+/**
+ * @brief   读取客户端数据，逐行执行完整的命令
+ *          回复很短，发送不完整视为客户端异常并断开，不阻塞其他客户端
+ */
+static void rotctld_read(rotctld_client_t *client)
+{
+    rotctld_reply_t reply;
+    int len = recv(client->sock, client->line + client->len, sizeof(client->line) - 1 - client->len, 0);
+    if (len < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return;
+        }
+        ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
+        rotctld_close(client);
+        return;
+    }
+    if (len == 0)
+    {
+        ESP_LOGW(TAG, "Connection closed");
+        rotctld_close(client);
+        return;
+    }
+    client->len += len;
+    line_recv_us = esp_timer_get_time();
 
-    do
+    size_t start = 0;
+    for (size_t i = 0; i < client->len; i++)
     {
-        len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);      
-        if (len < 0)
+        if (client->line[i] != '\n' && client->line[i] != '\r')
         {
-            LedStatus = CONNECTED;
-            ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
+            continue;
         }
-        else if (len == 0)
+        client->line[i] = '\0';
+        bool keep = rotctld_exec(client->line + start, &reply);
+        start = i + 1;
+        if (reply.len > 0 && send(client->sock, reply.buf, reply.len, 0) != (int)reply.len)
         {
-            LedStatus = CONNECTED;
-            ESP_LOGW(TAG, "Connection closed");
+            ESP_LOGW(TAG, "Send failed: errno %d", errno);
+            keep = false;
         }
-        else
+        if (!keep)
         {
-            if (uxQueueMessagesWaiting(RotQueueHandler) == 0)
-            {
-                rx_buffer[len] = 0; // Null-terminate whatever is received and treat it like a string
+            rotctld_close(client);
+            return;
+        }
+    }
 
-                sscanf(rx_buffer, "\\P %f %f", &curr_az, &curr_el);  // 接受数据并转义至对应的变量中
-                
-                delta_az = curr_az > prev_az ? (curr_az - prev_az) : (prev_az - curr_az);
-                delta_el = curr_el > prev_el ? (curr_el - prev_el) : (prev_el - curr_el);
+    // 未完整的行移到缓冲开头，整行超长时丢弃
+    client->len -= start;
+    memmove(client->line, client->line + start, client->len);
+    if (client->len >= sizeof(client->line) - 1)
+    {
+        ESP_LOGW(TAG, "Line too long, discarded");
+        client->len = 0;
+        send(client->sock, "RPRT -8\n", 8, 0);
+    }
+}
 
-                // 确定卫星此时是否位于地球的背面
-#if (NOT_TRACKING_FARSIDE)
-                if (curr_el >= 0 && prev_el >= 0)
-                {
-                    if (delta_az > DELTA_VALUE || delta_el > DELTA_VALUE)
-                    {
+static void rotctld_accept(int listen_sock)
+{
+    char addr_str[128] = "";
+    int keepAlive = 1;
+    int keepIdle = KEEPALIVE_IDLE;
+    int keepInterval = KEEPALIVE_INTERVAL;
+    int keepCount = KEEPALIVE_COUNT;
+    struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
+    socklen_t addr_len = sizeof(source_addr);
+
+    int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);  // 创建一个新的socket，用于和客户端进行数据传输
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+        return;
+    }
+
+    rotctld_client_t *client = NULL;
+    for (int i = 0; i < ROTCTLD_MAX_CLIENTS; i++)
+    {
+        if (clients[i].sock < 0)
+        {
+            client = &clients[i];
+            break;
+        }
+    }
+    if (client == NULL)
+    {
+        ESP_LOGW(TAG, "Too many clients, connection refused");
+        close(sock);
+        return;
+    }
+
+    // Set tcp keepalive option
+    setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    // Convert ip address to string
+#ifdef CONFIG_EXAMPLE_IPV4
+    if (source_addr.ss_family == PF_INET)
+    {
+        inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+    }
 #endif
-                        Tcp_Sentence_p = (Tcp_Sentence *)malloc(sizeof(Tcp_Sentence));
-                        if (Tcp_Sentence_p != NULL)
-                        {
-                            Tcp_Sentence_p->Azimuth = curr_az;
-                            Tcp_Sentence_p->Elevation = curr_el;
-                            
-                            TXStatus = xQueueSend(RotQueueHandler, &Tcp_Sentence_p, 0);  // 向队列发送消息
-                            if (TXStatus == pdPASS)
-                            {
-                                ESP_LOGI(TAG, "send done");
-                                prev_az = curr_az;
-                                prev_el = curr_el;
-                            }
-                            else
-                            {
-                                ESP_LOGI(TAG, "send failed");
-                                free(Tcp_Sentence_p);  // 发送失败，释放内存
-                            }
-                        }
-                        else
-                            ESP_LOGI(TAG, "alloc failed.\n");
-                        vTaskDelay(2000 / portTICK_PERIOD_MS);
-#if (NOT_TRACKING_FARSIDE)
-                    }
-                }
+#ifdef CONFIG_EXAMPLE_IPV6
+    if (source_addr.ss_family == PF_INET6)
+    {
+        inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
+    }
 #endif
-            }
-        }
+    ESP_LOGI(TAG, "Socket accepted ip address: %s", addr_str);
 
-    } while (len > 0);
+    client->sock = sock;
+    client->len = 0;
+    LedStatus = CONNECTED;
 }
 
 void tcp_server_task(void *pvParameters)
 {
-    char addr_str[128];
     int addr_family = (int)AF_INET;
     int ip_protocol = 0;
-    int keepAlive = 1;
-    int keepIdle = KEEPALIVE_IDLE;
-    int keepInterval = KEEPALIVE_INTERVAL;
-    int keepCount = KEEPALIVE_COUNT;
     struct sockaddr_storage dest_addr;
 
+    for (int i = 0; i < ROTCTLD_MAX_CLIENTS; i++)
+    {
+        clients[i].sock = -1;
+        clients[i].len = 0;
+    }
+
 #ifdef CONFIG_EXAMPLE_IPV4
     if (addr_family == AF_INET)
     {
@@ -157,6 +477,7 @@ void tcp_server_task(void *pvParameters)
     if (listen_sock < 0)
     {
         ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        tcp_server_handler = NULL;  // 下次取得IP时重新启动
         vTaskDelete(NULL);
         return;
     }
@@ -180,57 +501,66 @@ void tcp_server_task(void *pvParameters)
     }
     ESP_LOGI(TAG, "Socket bound, port %d", PORT);
     // 监听
-    err = listen(listen_sock, 1);
+    err = listen(listen_sock, ROTCTLD_MAX_CLIENTS);
     // 监听失败，意味着服务器无法接受客户端连接，这是一个严重的错误，后续代码没有任何意义
     if (err != 0)
     {
         ESP_LOGE(TAG, "Error occurred during listen: errno %d", errno);
         goto CLEAN_UP;
     }
+    ESP_LOGI(TAG, "Socket listening");
 
+    // 单线程事件循环，select同时等待新连接和所有客户端的数据
     while (1)
     {
-        ESP_LOGI(TAG, "Socket listening");
-        
-        struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
-        socklen_t addr_len = sizeof(source_addr);
-        int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);  // 创建一个新的socket，用于和服务器进行数据传输
-        /**
-         * @brief   accept返回失败通常代表严重的系统级错误，可能是由于资源耗尽，网络故障或者其他严重错误，多错误处理应该不继续执行任何接下来
-         *          的代码并且跳出
-         */
-        if (sock < 0)
+        fd_set read_fds;
+        int max_fd = listen_sock;
+
+        FD_ZERO(&read_fds);
+        FD_SET(listen_sock, &read_fds);
+        for (int i = 0; i < ROTCTLD_MAX_CLIENTS; i++)
+        {
+            if (clients[i].sock >= 0)
+            {
+                FD_SET(clients[i].sock, &read_fds);
+                max_fd = MAX(max_fd, clients[i].sock);
+            }
+        }
+
+        int ready = select(max_fd + 1, &read_fds, NULL, NULL, NULL);
+        if (ready < 0)
         {
-            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
             break;
         }
-        // Set tcp keepalive option
-        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int));
-        // Convert ip address to string
-#ifdef CONFIG_EXAMPLE_IPV4
-        if (source_addr.ss_family == PF_INET)
+
+        for (int i = 0; i < ROTCTLD_MAX_CLIENTS; i++)
         {
-            inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+            if (clients[i].sock >= 0 && FD_ISSET(clients[i].sock, &read_fds))
+            {
+                rotctld_read(&clients[i]);
+            }
         }
-#endif
-#ifdef CONFIG_EXAMPLE_IPV6
-        if (source_addr.ss_family == PF_INET6)
+        if (FD_ISSET(listen_sock, &read_fds))
         {
-            inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
+            rotctld_accept(listen_sock);
         }
-#endif
-        ESP_LOGI(TAG, "Socket accepted ip address: %s", addr_str);
+    }
 
-        do_retransmit(sock);
-        // After transmision is over, close the socket and free the memory.
-        shutdown(sock, 0);
-        close(sock);
+    for (int i = 0; i < ROTCTLD_MAX_CLIENTS; i++)
+    {
+        if (clients[i].sock >= 0)
+        {
+            rotctld_close(&clients[i]);
+        }
     }
 
 CLEAN_UP:
     close(listen_sock);
+    tcp_server_handler = NULL;
     vTaskDelete(NULL);
 }
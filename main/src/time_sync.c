@@ -0,0 +1,273 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include "esp_netif_sntp.h"
+#include "nvs.h"
+#include "time_sync.h"
+
+#define TAG "time_sync"
+
+typedef struct
+{
+    time_sync_cb_t cb;
+    void *ctx;
+} time_sync_listener_t;
+
+static time_sync_status_t state;
+static bool drift_valid;                // drift_ppb来自实测（本次运行或NVS），而非默认的0
+static bool drift_dirty;                // 漂移估计有更新，等待写入NVS
+static int64_t drift_rem_ns;            // 漂移补偿不足1us的余数
+static time_sync_listener_t listeners[TIME_SYNC_MAX_CBS];
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t clock_lock;    // 串行化adjtime的读-改-写
+static TimerHandle_t drift_timer;
+
+static int64_t tv_to_us(const struct timeval *tv)
+{
+    return (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static struct timeval us_to_tv(int64_t us)
+{
+    struct timeval tv = { .tv_sec = us / 1000000, .tv_usec = us % 1000000 };
+    return tv;
+}
+
+// 在尚未完成的平滑校正上叠加us，adjtime会以新的总量替换旧的校正
+static void slew_add(int64_t us)
+{
+    struct timeval pending;
+    xSemaphoreTake(clock_lock, portMAX_DELAY);
+    adjtime(NULL, &pending);
+    struct timeval delta = us_to_tv(tv_to_us(&pending) + us);
+    adjtime(&delta, NULL);
+    xSemaphoreGive(clock_lock);
+}
+
+static void drift_load(void)
+{
+    nvs_handle_t nvs;
+    int32_t ppb;
+    if (nvs_open(TIME_SYNC_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return;
+    }
+    if (nvs_get_i32(nvs, TIME_SYNC_NVS_DRIFT_KEY, &ppb) == ESP_OK && abs(ppb) <= TIME_SYNC_DRIFT_MAX_PPB)
+    {
+        state.drift_ppb = ppb;
+        drift_valid = true;
+        ESP_LOGI(TAG, "Clock drift %.3f ppm from NVS", ppb / 1000.0);
+    }
+    nvs_close(nvs);
+}
+
+static void drift_save(int32_t ppb)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(TIME_SYNC_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        return;
+    }
+    if (nvs_set_i32(nvs, TIME_SYNC_NVS_DRIFT_KEY, ppb) == ESP_OK)
+    {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+
+// 周期性按漂移估计补偿时钟，离线期间时间也不会越走越偏。
+// 在FreeRTOS定时器任务中运行，等锁和写NVS不会阻塞esp_timer回调（如track_tick）和lwIP线程
+static void drift_timer_cb(TimerHandle_t timer)
+{
+    taskENTER_CRITICAL(&state_lock);
+    int32_t ppb = state.drift_ppb;
+    bool save = drift_dirty;
+    drift_dirty = false;
+    taskEXIT_CRITICAL(&state_lock);
+
+    // ppb乘以秒数即为纳秒
+    drift_rem_ns += (int64_t)ppb * TIME_SYNC_DRIFT_PERIOD_S;
+    int64_t us = drift_rem_ns / 1000;
+    drift_rem_ns -= us * 1000;
+    if (us != 0)
+    {
+        slew_add(us);
+        taskENTER_CRITICAL(&state_lock);
+        state.drift_applied_us += us;
+        taskEXIT_CRITICAL(&state_lock);
+    }
+    if (save)
+    {
+        drift_save(ppb);
+    }
+}
+
+/**
+ * @brief   替换lwIP SNTP默认的时间设置函数（弱符号），每次收到NTP应答时调用
+ *          偏差小时平滑校正，偏差过大（如启动后首次同步，时钟还是编译时间）时直接设置，
+ *          并根据两次同步之间新出现的偏差更新晶振漂移估计
+ */
+void sntp_sync_time(struct timeval *tv)
+{
+    struct timeval now, pending;
+    time_sync_event_t event = { 0 };
+    time_sync_listener_t cbs[TIME_SYNC_MAX_CBS];
+
+    xSemaphoreTake(clock_lock, portMAX_DELAY);
+    gettimeofday(&now, NULL);
+    adjtime(NULL, &pending);
+    int64_t delta_us = tv_to_us(tv) - tv_to_us(&now);
+    // 尚未完成的校正已经计入，剩下的才是上次同步以来新出现的偏差
+    event.offset_us = delta_us - tv_to_us(&pending);
+    if (llabs(delta_us) > TIME_SYNC_SLEW_MAX_US)
+    {
+        settimeofday(tv, NULL);     // 同时取消未完成的平滑校正
+        event.stepped = true;
+    }
+    else
+    {
+        struct timeval delta = us_to_tv(delta_us);
+        adjtime(&delta, NULL);
+    }
+    xSemaphoreGive(clock_lock);
+    sntp_set_sync_status(SNTP_SYNC_STATUS_COMPLETED);
+
+    int64_t sync_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&state_lock);
+    int64_t interval_us = sync_us - state.last_sync_us;
+    // 跳变说明偏差不是漂移造成的，只作为下次估计的起点
+    if (state.synced && !event.stepped && interval_us >= (int64_t)TIME_SYNC_DRIFT_MIN_S * 1000000)
+    {
+        int64_t residual_ppb = event.offset_us * 1000000000LL / interval_us;
+        int64_t drift = state.drift_ppb + (drift_valid ? residual_ppb / TIME_SYNC_DRIFT_GAIN : residual_ppb);
+        if (llabs(drift) <= TIME_SYNC_DRIFT_MAX_PPB)
+        {
+            state.drift_ppb = (int32_t)drift;
+            drift_valid = true;
+            drift_dirty = true;
+        }
+    }
+    state.synced = true;
+    state.syncs++;
+    state.steps += event.stepped;
+    state.last_sync_us = sync_us;
+    state.last_offset_us = event.offset_us;
+    state.drift_applied_us = 0;
+    event.drift_ppb = state.drift_ppb;
+    memcpy(cbs, listeners, sizeof(cbs));
+    taskEXIT_CRITICAL(&state_lock);
+
+    ESP_LOGI(TAG, "%s by %lld us, drift %.3f ppm", event.stepped ? "Stepped" : "Slewing",
+             delta_us, event.drift_ppb / 1000.0);
+    for (int i = 0; i < TIME_SYNC_MAX_CBS; i++)
+    {
+        if (cbs[i].cb != NULL)
+        {
+            cbs[i].cb(&event, cbs[i].ctx);
+        }
+    }
+}
+
+esp_err_t time_sync_init(void)
+{
+    clock_lock = xSemaphoreCreateMutex();
+    if (clock_lock == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    drift_load();
+
+    drift_timer = xTimerCreate("time_drift", pdMS_TO_TICKS(TIME_SYNC_DRIFT_PERIOD_S * 1000), pdTRUE, NULL,
+                               drift_timer_cb);
+    if (drift_timer == NULL || xTimerStart(drift_timer, portMAX_DELAY) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Drift timer failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // SNTP在后台运行，按CONFIG_LWIP_SNTP_UPDATE_DELAY周期重新同步，网络未就绪时自动重试
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG_MULTIPLE(3,
+                                ESP_SNTP_SERVER_LIST("pool.ntp.org", "time.google.com", "time.windows.com"));
+    esp_err_t ret = esp_netif_sntp_init(&config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "SNTP intialize failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t time_sync_request(void)
+{
+    esp_err_t ret = esp_netif_sntp_start();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "SNTP launch failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t time_sync_register_cb(time_sync_cb_t cb, void *ctx)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    taskENTER_CRITICAL(&state_lock);
+    for (int i = 0; i < TIME_SYNC_MAX_CBS; i++)
+    {
+        if (listeners[i].cb == NULL)
+        {
+            listeners[i].cb = cb;
+            listeners[i].ctx = ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&state_lock);
+    return ret;
+}
+
+void time_sync_get_status(time_sync_status_t *status)
+{
+    struct timeval pending;
+    adjtime(NULL, &pending);
+    taskENTER_CRITICAL(&state_lock);
+    *status = state;
+    taskEXIT_CRITICAL(&state_lock);
+    status->pending_us = tv_to_us(&pending);
+}
+
+void time_sync_print(void)
+{
+    time_sync_status_t st;
+    time_sync_get_status(&st);
+    if (!st.synced)
+    {
+        printf("Not synced yet, drift %.3f ppm\n", st.drift_ppb / 1000.0);
+        return;
+    }
+    printf("%lu syncs (%lu steps), last %lld s ago, offset %lld us\n", (unsigned long)st.syncs,
+           (unsigned long)st.steps, (esp_timer_get_time() - st.last_sync_us) / 1000000, st.last_offset_us);
+    printf("drift %.3f ppm, %lld us compensated since last sync, %lld us slew pending\n",
+           st.drift_ppb / 1000.0, st.drift_applied_us, st.pending_us);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define SGP4SDP4_CONSTANTS
+#include "tle_prefetch.h"
+#include "orbit_propagator.h"
+#include "catalog_mirror.h"
+#include "get_tle.h"
+#include "boot_prof.h"
+
+#define TAG "tle_prefetch"
+
+#define MINUTES_TO_TICKS(m)     pdMS_TO_TICKS((uint32_t)(m) * 60 * 1000)
+
+static char watch_list[TLE_PREFETCH_MAX_WATCH][SAT_NMAE_LENGTH];
+static int watch_next = 0;
+static portMUX_TYPE watch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void tle_prefetch_watch(const char *sat_name)
+{
+    taskENTER_CRITICAL(&watch_lock);
+    for (int i = 0; i < TLE_PREFETCH_MAX_WATCH; i++)
+    {
+        if (strcmp(watch_list[i], sat_name) == 0)
+        {
+            taskEXIT_CRITICAL(&watch_lock);
+            return;
+        }
+    }
+    strlcpy(watch_list[watch_next], sat_name, SAT_NMAE_LENGTH);
+    watch_next = (watch_next + 1) % TLE_PREFETCH_MAX_WATCH;
+    taskEXIT_CRITICAL(&watch_lock);
+}
+
+typedef struct
+{
+    bool stale;             // 有卫星的根数在下一次过境时会超过时效
+    bool in_pass;           // 当前有卫星正在过境
+    double next_aos;        // 最近一次过境的开始时间（儒略日）
+    double pass_end;        // 正在进行的过境中最晚的结束时间
+} prefetch_state_t;
+
+// 对监视列表中的每颗卫星预测下一次过境，计算过境时的根数时效
+static void check_watch_list(double jul_now, prefetch_state_t *st)
+{
+    char name[SAT_NMAE_LENGTH];
+    geodetic_t obs;
+    orbit_t orb;
+    const double max_age_min = CONFIG_TALLNECK_TLE_MAX_AGE_HOURS * 60.0;
+
+    memset(st, 0, sizeof(*st));
+    st->next_aos = jul_now + TLE_PREFETCH_SPAN_DAYS;
+    orbit_observer_geodetic(&obs);
+
+    for (int i = 0; i < TLE_PREFETCH_MAX_WATCH; i++)
+    {
+        taskENTER_CRITICAL(&watch_lock);
+        strlcpy(name, watch_list[i], sizeof(name));
+        taskEXIT_CRITICAL(&watch_lock);
+        if (name[0] == '\0')
+        {
+            continue;
+        }
+
+        FILE *fp = catalog_open();
+        if (fp == NULL)
+        {
+            return;
+        }
+        int flg = orbit_load(&orb, fp, name);
+        fclose(fp);
+        if (flg != 0)
+        {
+            continue;
+        }
+
+        double aos, los, tsince_at_pass;
+        if (orbit_next_pass(&orb, &obs, jul_now, TLE_PREFETCH_SPAN_DAYS, &aos, &los))
+        {
+            tsince_at_pass = orbit_tsince(&orb, aos);
+            if (aos <= jul_now)
+            {
+                st->in_pass = true;
+                st->pass_end = MAX(st->pass_end, los);
+            }
+            st->next_aos = MIN(st->next_aos, aos);
+        }
+        else
+        {
+            tsince_at_pass = orbit_tsince(&orb, jul_now + TLE_PREFETCH_SPAN_DAYS);
+        }
+
+        ESP_LOGI(TAG, "%s: elements %.1f h old at next pass", orb.tle.sat_name, tsince_at_pass / 60.0);
+        if (tsince_at_pass > max_age_min)
+        {
+            st->stale = true;
+        }
+    }
+}
+
+void tle_prefetch_task(void *pvParameter)
+{
+    struct tm utc;
+    struct timeval tv;
+    prefetch_state_t st;
+    const double guard_days = CONFIG_TALLNECK_TLE_PREFETCH_GUARD_MIN / xmnpda;
+
+    TickType_t wait = MINUTES_TO_TICKS(CONFIG_TALLNECK_TLE_PREFETCH_INTERVAL_MIN);
+    uint32_t backoff_min = CONFIG_TALLNECK_TLE_PREFETCH_INTERVAL_MIN;    // 刷新后仍过期时的重试间隔
+
+    boot_stage_wait(BOOT_STAGE_STORAGE);  // 下载写入LittleFS
+
+    while (1)
+    {
+        uint32_t status = NO_EVENT;
+
+        // 手动刷新（串口reconnect命令）不受时效和空闲窗口的限制
+        if (xTaskNotifyWait(0x00, 0xFFFFFFFF, &status, wait) == pdPASS && status == UPDATE_TLE)
+        {
+            download_tle_task();
+            continue;
+        }
+
+        wait = MINUTES_TO_TICKS(CONFIG_TALLNECK_TLE_PREFETCH_INTERVAL_MIN);
+        UTC_Calendar_Now(&utc, &tv);
+        double jul_now = Julian_Date(&utc, &tv);
+        check_watch_list(jul_now, &st);
+        if (!st.stale)
+        {
+            backoff_min = CONFIG_TALLNECK_TLE_PREFETCH_INTERVAL_MIN;
+            continue;
+        }
+
+        // 下载会占用网络和文件系统，只在过境间隙进行，避免跟踪途中卡顿
+        if (st.in_pass || st.next_aos - jul_now < guard_days)
+        {
+            if (st.in_pass)
+            {
+                wait = MINUTES_TO_TICKS((st.pass_end - jul_now) * xmnpda + 1);  // 过境结束后立即再检查
+            }
+            ESP_LOGI(TAG, "Elements stale, waiting for an idle window");
+            continue;
+        }
+
+        uint32_t generation = catalog_generation();
+        ESP_LOGI(TAG, "Elements stale, refreshing before the next pass in %.0f min", (st.next_aos - jul_now) * xmnpda);
+        download_tle_task();
+        if (catalog_generation() != generation)
+        {
+            check_watch_list(jul_now, &st);
+        }
+        if (catalog_generation() == generation || st.stale)
+        {
+            // 下载失败，或上游也没有更新的根数（如已失效的卫星），按指数退避重试
+            backoff_min = MIN(backoff_min * 2, TLE_PREFETCH_MAX_BACKOFF_MIN);
+            wait = MINUTES_TO_TICKS(backoff_min);
+            ESP_LOGW(TAG, "%s, retry in %lu min", catalog_generation() == generation ?
+                     "Refresh did not install a new catalog" : "Elements still stale after the refresh",
+                     (unsigned long)backoff_min);
+        }
+        else
+        {
+            backoff_min = CONFIG_TALLNECK_TLE_PREFETCH_INTERVAL_MIN;
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "track_recorder.h"
+#include "boot_prof.h"
+
+#define TAG "track_recorder"
+
+#define BLOCK_PAYLOAD       (TRACK_REC_BLOCK_SIZE - sizeof(track_rec_block_hdr_t))
+#define RECORD_MAX_BYTES    (TRACK_REC_FIELDS * 10)
+
+// 环形缓冲区只由跟踪任务访问
+static uint8_t ring[TRACK_REC_BLOCKS][TRACK_REC_BLOCK_SIZE];
+static int ring_head = 0;           // 最早的未写入块
+static int ring_pending = 0;        // 未写入的块数，包括正在写的块
+static bool block_open = false;     // ring_head + ring_pending - 1是否还能追加
+static int64_t prev[TRACK_REC_FIELDS];
+static int rec_catnr = 0;
+static uint32_t dropped_blocks = 0;
+
+static inline track_rec_block_hdr_t *block_hdr(int index)
+{
+    return (track_rec_block_hdr_t *)ring[index];
+}
+
+static size_t put_varint(uint8_t *p, int64_t value)
+{
+    uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);  // zigzag
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t encode(uint8_t *p, const int64_t *fields)
+{
+    size_t n = 0;
+    for (int i = 0; i < TRACK_REC_FIELDS; i++)
+    {
+        n += put_varint(p + n, fields[i] - prev[i]);
+    }
+    return n;
+}
+
+// 开始一个新块，缓冲区满时丢弃最早的块
+static track_rec_block_hdr_t *open_block(void)
+{
+    if (ring_pending == TRACK_REC_BLOCKS)
+    {
+        ring_head = (ring_head + 1) % TRACK_REC_BLOCKS;
+        ring_pending--;
+        dropped_blocks++;
+    }
+    int index = (ring_head + ring_pending) % TRACK_REC_BLOCKS;
+    track_rec_block_hdr_t *hdr = block_hdr(index);
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = TRACK_REC_MAGIC;
+    hdr->version = TRACK_REC_VERSION;
+    hdr->fields = TRACK_REC_FIELDS;
+    hdr->catnr = rec_catnr;
+    memset(prev, 0, sizeof(prev));
+    ring_pending++;
+    block_open = true;
+    return hdr;
+}
+
+void track_recorder_start(int catnr)
+{
+    rec_catnr = catnr;
+    block_open = false;
+}
+
+void track_recorder_append(const track_rec_sample_t *sample)
+{
+    uint8_t rec[RECORD_MAX_BYTES];
+    int64_t fields[TRACK_REC_FIELDS] =
+    {
+        sample->time_ms,
+        lround(sample->azi_cmd * 100),
+        lround(sample->ele_cmd * 100),
+        lround(sample->azi * 100),
+        lround(sample->ele * 100),
+        lround(sample->range_rate * 1000),
+        sample->rot_state,
+    };
+
+    track_rec_block_hdr_t *hdr = NULL;
+    size_t n = 0;
+    if (block_open)
+    {
+        hdr = block_hdr((ring_head + ring_pending - 1) % TRACK_REC_BLOCKS);
+        n = encode(rec, fields);
+        if (hdr->length + n > BLOCK_PAYLOAD)
+        {
+            hdr = NULL;
+        }
+    }
+    if (hdr == NULL)
+    {
+        hdr = open_block();
+        n = encode(rec, fields);
+    }
+
+    memcpy((uint8_t *)(hdr + 1) + hdr->length, rec, n);
+    hdr->length += n;
+    hdr->count++;
+    memcpy(prev, fields, sizeof(prev));
+}
+
+// track.bin -> track.1.bin -> ... 最旧的文件删除
+static void rotate_files(void)
+{
+    char from[48], to[48];
+    for (int i = TRACK_REC_FILES - 1; i > 0; i--)
+    {
+        if (i == 1)
+            snprintf(from, sizeof(from), "%s", TRACK_REC_PATH);
+        else
+            snprintf(from, sizeof(from), TRACK_REC_DIR "/track.%d.bin", i - 1);
+        snprintf(to, sizeof(to), TRACK_REC_DIR "/track.%d.bin", i);
+        remove(to);
+        rename(from, to);
+    }
+}
+
+esp_err_t track_recorder_flush(void)
+{
+    struct stat st;
+    size_t bytes = 0;
+
+    if (ring_pending == 0)
+    {
+        return ESP_OK;
+    }
+    for (int i = 0; i < ring_pending; i++)
+    {
+        bytes += sizeof(track_rec_block_hdr_t) + block_hdr((ring_head + i) % TRACK_REC_BLOCKS)->length;
+    }
+
+    boot_stage_wait(BOOT_STAGE_STORAGE);  // 复位后恢复的跟踪可能早于文件系统挂载
+    if (stat(TRACK_REC_DIR, &st) != 0 && mkdir(TRACK_REC_DIR, 0755) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to create %s", TRACK_REC_DIR);
+        return ESP_FAIL;
+    }
+    if (stat(TRACK_REC_PATH, &st) == 0 && st.st_size + bytes > TRACK_REC_FILE_MAX)
+    {
+        rotate_files();
+    }
+
+    FILE *fp = fopen(TRACK_REC_PATH, "a");
+    if (fp == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open %s", TRACK_REC_PATH);
+        return ESP_FAIL;
+    }
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < ring_pending && err == ESP_OK; i++)
+    {
+        track_rec_block_hdr_t *hdr = block_hdr((ring_head + i) % TRACK_REC_BLOCKS);
+        size_t len = sizeof(*hdr) + hdr->length;
+        if (fwrite(hdr, 1, len, fp) != len)
+        {
+            err = ESP_FAIL;
+        }
+    }
+    if (fclose(fp) != 0)
+    {
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to write %s", TRACK_REC_PATH);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Flushed %d blocks (%u bytes)%s", ring_pending, (unsigned)bytes,
+             dropped_blocks ? ", some blocks were dropped" : "");
+    ring_head = (ring_head + ring_pending) % TRACK_REC_BLOCKS;
+    ring_pending = 0;
+    block_open = false;
+    dropped_blocks = 0;
+    return ESP_OK;
+}
+
+void track_recorder_poll(bool in_pass)
+{
+    // 过境期间不写flash，除非缓冲区已用掉3/4（地球同步卫星等一直在地平线以上的情况）
+    if ((!in_pass && ring_pending > 0) || ring_pending >= TRACK_REC_BLOCKS * 3 / 4)
+    {
+        track_recorder_flush();
+    }
+}
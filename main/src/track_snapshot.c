@@ -0,0 +1,173 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "track_snapshot.h"
+
+#define TAG "track_snapshot"
+
+static nvs_handle_t snapshot_nvs = 0;
+static track_snapshot_t current;        // 仅由跟踪任务访问
+static track_snapshot_t restored;
+static bool resume_pending = false;
+static int64_t last_write_us = 0;
+
+static esp_err_t snapshot_open(void)
+{
+    if (snapshot_nvs != 0)
+    {
+        return ESP_OK;
+    }
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        // NVS分区格式不兼容，擦除后重新初始化
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    return nvs_open(TRACK_SNAPSHOT_NAMESPACE, NVS_READWRITE, &snapshot_nvs);
+}
+
+static esp_err_t snapshot_write(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    current.saved_at = tv.tv_sec;
+
+    esp_err_t err = snapshot_open();
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(snapshot_nvs, TRACK_SNAPSHOT_KEY, &current, sizeof(current));
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(snapshot_nvs);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to save tracking snapshot: %s", esp_err_to_name(err));
+    }
+    last_write_us = esp_timer_get_time();
+    return err;
+}
+
+esp_err_t track_snapshot_restore(void)
+{
+    size_t len = sizeof(restored);
+    esp_err_t err = snapshot_open();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "NVS unavailable: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_get_blob(snapshot_nvs, TRACK_SNAPSHOT_KEY, &restored, &len);
+    if (err != ESP_OK)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // 结构体变化后旧快照作废
+    if (len != sizeof(restored) || restored.version != TRACK_SNAPSHOT_VERSION || restored.mode != TRACK_MODE_AUTO)
+    {
+        ESP_LOGW(TAG, "Discarding incompatible tracking snapshot");
+        nvs_erase_key(snapshot_nvs, TRACK_SNAPSHOT_KEY);
+        nvs_commit(snapshot_nvs);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // 复位后时钟从编译时间开始走，至少不能早于快照写入时刻
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < restored.saved_at)
+    {
+        tv.tv_sec = restored.saved_at;
+        tv.tv_usec = 0;
+        settimeofday(&tv, NULL);
+        ESP_LOGW(TAG, "Clock behind the snapshot, advanced until SNTP sync");
+    }
+
+    resume_pending = true;
+    ESP_LOGI(TAG, "Resuming %s (catnr %d), rotator at Azi=%.1f Ele=%.1f",
+             restored.orb.tle.sat_name, restored.orb.tle.catnr, restored.rot_azi, restored.rot_ele);
+    return ESP_OK;
+}
+
+bool track_snapshot_resume(track_snapshot_t *snap)
+{
+    if (!resume_pending)
+    {
+        return false;
+    }
+    resume_pending = false;
+    current = restored;
+    *snap = restored;
+    return true;
+}
+
+esp_err_t track_snapshot_begin(const char *sat_name, const orbit_t *orb, const geodetic_t *obs)
+{
+    float azi = current.rot_azi;
+    float ele = current.rot_ele;
+
+    memset(&current, 0, sizeof(current));
+    current.version = TRACK_SNAPSHOT_VERSION;
+    current.mode = TRACK_MODE_AUTO;
+    strlcpy(current.sat_name, sat_name, sizeof(current.sat_name));
+    current.orb = *orb;
+    current.obs = *obs;
+    current.rot_azi = azi;
+    current.rot_ele = ele;
+    return snapshot_write();
+}
+
+void track_snapshot_update(float rot_azi, float rot_ele)
+{
+    current.rot_azi = rot_azi;
+    current.rot_ele = rot_ele;
+    if (current.mode == TRACK_MODE_AUTO &&
+        esp_timer_get_time() - last_write_us >= (int64_t)TRACK_SNAPSHOT_PERIOD_S * 1000000)
+    {
+        snapshot_write();
+    }
+}
+
+esp_err_t track_snapshot_clear(void)
+{
+    current.mode = TRACK_MODE_IDLE;
+    esp_err_t err = snapshot_open();
+    if (err == ESP_OK)
+    {
+        err = nvs_erase_key(snapshot_nvs, TRACK_SNAPSHOT_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND)
+        {
+            return ESP_OK;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(snapshot_nvs);
+    }
+    return err;
+}
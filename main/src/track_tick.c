@@ -0,0 +1,155 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "globals.h"
+#include "track_tick.h"
+
+#define TAG "track_tick"
+
+static esp_timer_handle_t tick_timer = NULL;
+static TaskHandle_t tick_task = NULL;
+static int64_t deadline_us;
+static int64_t woke_us;
+static track_tick_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 在esp_timer任务中运行；已有未处理的命令（如结束跟踪）时不覆盖
+static void tick_timer_cb(void *arg)
+{
+    xTaskNotify(tick_task, TRACK_TICK, eSetValueWithoutOverwrite);
+}
+
+esp_err_t track_tick_init(void)
+{
+    if (tick_timer != NULL)
+    {
+        return ESP_OK;
+    }
+    tick_task = xTaskGetCurrentTaskHandle();
+    const esp_timer_create_args_t args =
+    {
+        .callback = tick_timer_cb,
+        .name = "track_tick",
+    };
+    esp_err_t err = esp_timer_create(&args, &tick_timer);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create tick timer: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+void track_tick_start(void)
+{
+    esp_timer_stop(tick_timer);
+    deadline_us = esp_timer_get_time();
+    esp_timer_start_once(tick_timer, 0);
+}
+
+void track_tick_stop(void)
+{
+    esp_timer_stop(tick_timer);
+}
+
+void track_tick_woke(void)
+{
+    woke_us = esp_timer_get_time();
+    int64_t jitter = woke_us - deadline_us;
+    taskENTER_CRITICAL(&stats_lock);
+    stats.ticks++;
+    stats.jitter_sum_us += jitter;
+    if (jitter > stats.jitter_max_us)
+    {
+        stats.jitter_max_us = jitter;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void track_tick_schedule(uint32_t period_ms)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t work = now - woke_us;
+    bool overrun = false;
+
+    // 从上一个截止时间累加，计算耗时不会让节拍漂移
+    deadline_us += (int64_t)period_ms * 1000;
+    if (deadline_us <= now)
+    {
+        deadline_us = now;  // 已经错过，不补发积压的节拍
+        overrun = true;
+    }
+
+    taskENTER_CRITICAL(&stats_lock);
+    stats.period_ms = period_ms;
+    if (work > stats.work_max_us)
+    {
+        stats.work_max_us = work;
+    }
+    if (overrun)
+    {
+        stats.overruns++;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+
+    esp_timer_stop(tick_timer);
+    esp_timer_start_once(tick_timer, deadline_us - now);
+}
+
+uint32_t track_tick_period(double azi_rate, double ele_rate, double ele)
+{
+    const double beam = CONFIG_TALLNECK_ANTENNA_BEAMWIDTH_DEG * TRACK_TICK_BEAM_FRACTION;
+    double period_ms;
+
+    if (ele < 0)
+    {
+        // 地平线以下：仰角上升时在预计入境前醒来，其余情况按空闲周期
+        period_ms = CONFIG_TALLNECK_TRACK_TICK_IDLE_MS;
+        if (ele_rate > 0)
+        {
+            period_ms = fmin(period_ms, -ele / ele_rate * 1000.0);
+        }
+        return (uint32_t)fmax(period_ms, CONFIG_TALLNECK_TRACK_TICK_MIN_MS);
+    }
+
+    // 方位/俯仰座架按轴转动，近天顶时方位角速度最大
+    double rate = fmax(fabs(azi_rate), fabs(ele_rate));
+    period_ms = rate > 0 ? beam / rate * 1000.0 : CONFIG_TALLNECK_TRACK_TICK_MAX_MS;
+    period_ms = fmin(period_ms, CONFIG_TALLNECK_TRACK_TICK_MAX_MS);
+    return (uint32_t)fmax(period_ms, CONFIG_TALLNECK_TRACK_TICK_MIN_MS);
+}
+
+void track_tick_get_stats(track_tick_stats_t *out)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void track_tick_stats_print(void)
+{
+    track_tick_stats_t s;
+    track_tick_get_stats(&s);
+    printf("tick: period %lu ms, %lu ticks, %lu overruns\n",
+           (unsigned long)s.period_ms, (unsigned long)s.ticks, (unsigned long)s.overruns);
+    printf("jitter: mean %lld us, max %lld us; work max %lld us\n",
+           s.ticks ? s.jitter_sum_us / s.ticks : 0, s.jitter_max_us, s.work_max_us);
+}
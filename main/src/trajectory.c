@@ -0,0 +1,296 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "trajectory.h"
+#include "setpoint.h"
+
+#define TAG "trajectory"
+
+static portMUX_TYPE traj_lock = portMUX_INITIALIZER_UNLOCKED;
+// 双缓冲：上传写入staged，traj_load_end校验通过后与points交换，执行中的轨迹不受上传影响
+static traj_point_t buffers[2][TRAJ_MAX_POINTS];
+static traj_point_t *points = buffers[0];
+static traj_point_t *staged = buffers[1];
+static traj_status_t status;
+static traj_status_t load;          // 上传中的轨迹，state为TRAJ_LOADING或TRAJ_IDLE
+static TaskHandle_t traj_handle = NULL;
+
+static int64_t now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void traj_load_begin(void)
+{
+    taskENTER_CRITICAL(&traj_lock);
+    load.state = TRAJ_LOADING;
+    load.points = 0;
+    load.start_ms = 0;
+    load.end_ms = 0;
+    taskEXIT_CRITICAL(&traj_lock);
+}
+
+esp_err_t traj_load_line(const char *line)
+{
+    double t;
+    float azi, ele;
+
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+    if (*line == '\0' || *line == '#' || *line == '\r' || *line == '\n')
+    {
+        return ESP_OK;
+    }
+    if (sscanf(line, "%lf %f %f", &t, &azi, &ele) != 3 ||
+        azi < 0 || azi > 360 || ele < -90 || ele > 180)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t t_ms = (int64_t)llround(t * 1000);
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&traj_lock);
+    if (load.state != TRAJ_LOADING)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else if (load.points >= TRAJ_MAX_POINTS)
+    {
+        err = ESP_ERR_NO_MEM;
+    }
+    else if (load.points == 0)
+    {
+        load.start_ms = t_ms;
+    }
+    else if (t_ms <= load.end_ms || t_ms - load.end_ms > TRAJ_MAX_GAP_MS)
+    {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    if (err == ESP_OK)
+    {
+        traj_point_t *p = &staged[load.points++];
+        p->t_ms = (uint32_t)(t_ms - load.start_ms);
+        p->azi_cdeg = (uint16_t)lroundf(azi * 100);
+        p->ele_cdeg = (int16_t)lroundf(ele * 100);
+        load.end_ms = t_ms;
+    }
+    taskEXIT_CRITICAL(&traj_lock);
+    return err;
+}
+
+esp_err_t traj_load_end(void)
+{
+    esp_err_t err = ESP_OK;
+    traj_status_t loaded;
+    taskENTER_CRITICAL(&traj_lock);
+    loaded = load;
+    if (load.state != TRAJ_LOADING || load.points < 2)
+    {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    else
+    {
+        // 只交换指针，执行任务下次采样时就切换到新轨迹
+        traj_point_t *tmp = points;
+        points = staged;
+        staged = tmp;
+        status = load;
+        status.state = TRAJ_ARMED;
+        status.posted = 0;
+    }
+    load.state = TRAJ_IDLE;
+    load.points = 0;
+    taskEXIT_CRITICAL(&traj_lock);
+
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "%d points, %lld s, starts in %lld s", loaded.points,
+                 (loaded.end_ms - loaded.start_ms) / 1000, (loaded.start_ms - now_ms()) / 1000);
+        if (traj_handle != NULL)
+        {
+            xTaskNotifyGive(traj_handle);
+        }
+    }
+    return err;
+}
+
+void traj_load_abort(void)
+{
+    taskENTER_CRITICAL(&traj_lock);
+    load.state = TRAJ_IDLE;
+    load.points = 0;
+    taskEXIT_CRITICAL(&traj_lock);
+}
+
+void traj_stop(void)
+{
+    taskENTER_CRITICAL(&traj_lock);
+    load.state = TRAJ_IDLE;
+    load.points = 0;
+    if (status.state != TRAJ_DONE)
+    {
+        status.state = TRAJ_IDLE;
+    }
+    taskEXIT_CRITICAL(&traj_lock);
+}
+
+bool traj_active(void)
+{
+    traj_state_t state = status.state;
+    return state == TRAJ_ARMED || state == TRAJ_RUNNING;
+}
+
+void traj_get_status(traj_status_t *out)
+{
+    taskENTER_CRITICAL(&traj_lock);
+    *out = load.state == TRAJ_LOADING ? load : status;
+    taskEXIT_CRITICAL(&traj_lock);
+}
+
+/**
+ * @brief   求t时刻的指向，方位角按较短方向插值，同时在锁内取一份状态快照
+ * @return  轨迹不在执行状态时返回false
+ */
+static bool traj_sample(int64_t t, float *azi, float *ele, traj_status_t *snap)
+{
+    bool ok = false;
+    taskENTER_CRITICAL(&traj_lock);
+    *snap = status;
+    if (status.state == TRAJ_ARMED || status.state == TRAJ_RUNNING)
+    {
+        int n = status.points;
+        int64_t rel = t - status.start_ms;
+        if (rel < 0)
+        {
+            rel = 0;
+        }
+        if (rel > points[n - 1].t_ms)
+        {
+            rel = points[n - 1].t_ms;
+        }
+        // 二分查找rel所在的区间[lo, lo + 1]
+        int lo = 0, hi = n - 1;
+        while (hi - lo > 1)
+        {
+            int mid = (lo + hi) / 2;
+            if (points[mid].t_ms <= rel)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        const traj_point_t *a = &points[lo], *b = &points[hi];
+        float f = (float)(rel - a->t_ms) / (float)(b->t_ms - a->t_ms);
+        float d_azi = (b->azi_cdeg - a->azi_cdeg) / 100.0f;
+        if (d_azi > 180)
+        {
+            d_azi -= 360;
+        }
+        else if (d_azi < -180)
+        {
+            d_azi += 360;
+        }
+        *azi = fmodf(a->azi_cdeg / 100.0f + d_azi * f + 360, 360);
+        *ele = (a->ele_cdeg + (b->ele_cdeg - a->ele_cdeg) * f) / 100.0f;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&traj_lock);
+    return ok;
+}
+
+void traj_task(void *pvParameters)
+{
+    traj_handle = xTaskGetCurrentTaskHandle();
+
+    while (1)
+    {
+        traj_status_t snap;
+        float azi, ele;
+        int64_t t = now_ms();
+
+        if (!traj_sample(t, &azi, &ele, &snap))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        if (snap.state == TRAJ_ARMED)
+        {
+            // 先转到第一个点，再等到开始时间，等待期间每秒检查一次是否被取消
+            setpoint_post(azi, ele < 0 ? 0 : ele, SETPOINT_SRC_TRAJECTORY);
+            int64_t wait = snap.start_ms - t;
+            if (wait > 0)
+            {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait < 1000 ? wait : 1000));
+                continue;
+            }
+            bool started = false;
+            taskENTER_CRITICAL(&traj_lock);
+            // 等待期间可能换入了开始时间更晚的轨迹
+            if (status.state == TRAJ_ARMED && status.start_ms <= t)
+            {
+                status.state = TRAJ_RUNNING;
+                started = true;
+            }
+            taskEXIT_CRITICAL(&traj_lock);
+            if (started)
+            {
+                ESP_LOGI(TAG, "Trajectory started");
+            }
+        }
+
+        TickType_t last_wake = xTaskGetTickCount();
+        while (traj_sample(now_ms(), &azi, &ele, &snap) && snap.state == TRAJ_RUNNING)
+        {
+            setpoint_post(azi, ele < 0 ? 0 : ele, SETPOINT_SRC_TRAJECTORY);  // 旋转器不转到地平线以下
+            bool done = false;
+            uint32_t posted = 0;
+            int64_t now = now_ms();
+            taskENTER_CRITICAL(&traj_lock);
+            // 新上传的轨迹换入后是TRAJ_ARMED，此时不计数也不结束
+            if (status.state == TRAJ_RUNNING)
+            {
+                posted = ++status.posted;
+                if (now >= status.end_ms)
+                {
+                    status.state = TRAJ_DONE;
+                    done = true;
+                }
+            }
+            taskEXIT_CRITICAL(&traj_lock);
+            if (done)
+            {
+                ESP_LOGI(TAG, "Trajectory done, %lu setpoints", (unsigned long)posted);
+                break;
+            }
+            vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TRAJ_STEP_MS));
+        }
+    }
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trsp_db.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "assets.h"
+
+#define TAG "trsp_db"
+
+#define TRSP_DB_TMP_PATH        TRSP_DB_PATH ".tmp"
+#define TRSP_DB_RECORDS_PATH    TRSP_DB_PATH ".rec"
+#define TRSP_DB_STRINGS_PATH    TRSP_DB_PATH ".str"
+#define TRSP_DB_COPY_BLOCK      512
+#define TRSP_DB_STRTAB_HINT     1024    // 预计的不同字符串个数，超出时哈希表自动扩容
+
+// FNV-1a
+static uint32_t str_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 返回字符串在字符串表中的偏移，首次出现时追加
+static uint32_t intern(trsp_db_writer_t* w, const char* str) {
+    size_t len = strlen(str);
+    int32_t key = (int32_t)str_hash(str);
+    trsp_db_str_t* head = hash_map_get_int(&w->strtab, key);
+
+    for (trsp_db_str_t* s = head; s; s = s->next) {
+        if (s->len == len && memcmp(s->str, str, len) == 0)
+            return s->offset;
+    }
+
+    trsp_db_str_t* s = arena_alloc(&w->arena, sizeof(trsp_db_str_t));
+    char* copy = arena_strdup(&w->arena, str);
+    if (!s || !copy || fwrite(str, 1, len + 1, w->strings) != len + 1) {
+        w->err = ESP_FAIL;
+        return 0;
+    }
+    s->offset = w->strtab_size;
+    s->len = len;
+    s->str = copy;
+    w->strtab_size += len + 1;
+
+    if (head) {
+        // 哈希冲突，挂到已有链表上
+        s->next = head->next;
+        head->next = s;
+    } else {
+        s->next = NULL;
+        w->err = hash_map_put_int(&w->strtab, key, s);
+    }
+    return s->offset;
+}
+
+esp_err_t trsp_db_writer_begin(trsp_db_writer_t* w) {
+    memset(w, 0, sizeof(*w));
+    w->records = fopen(TRSP_DB_RECORDS_PATH, "w+");
+    w->strings = fopen(TRSP_DB_STRINGS_PATH, "w+");
+    arena_init(&w->arena, ARENA_DEFAULT_BLOCK);
+    if (!w->records || !w->strings ||
+        hash_map_init(&w->strtab, &w->arena, HASH_MAP_KEY_INT, TRSP_DB_STRTAB_HINT) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the transponder database");
+        trsp_db_writer_abort(w);
+        return ESP_FAIL;
+    }
+    // 偏移0保留给空字符串
+    intern(w, "");
+    return w->err;
+}
+
+esp_err_t trsp_db_writer_add(trsp_db_writer_t* w, const struct transponder* t) {
+    trsp_db_record_t rec = {0};
+
+    if (w->err != ESP_OK)
+        return w->err;
+
+    if (w->record_count == w->order_cap) {
+        size_t cap = w->order_cap ? w->order_cap * 2 : 256;
+        trsp_db_order_t* grown = realloc(w->order, cap * sizeof(trsp_db_order_t));
+        if (!grown) {
+            w->err = ESP_ERR_NO_MEM;
+            return w->err;
+        }
+        w->order = grown;
+        w->order_cap = cap;
+    }
+
+    rec.catnr = t->catnum;
+    rec.description = intern(w, t->description);
+    rec.mode = intern(w, t->mode);
+    rec.uplink_low = t->uplink_low;
+    rec.uplink_high = t->uplink_high;
+    rec.downlink_low = t->downlink_low;
+    rec.downlink_high = t->downlink_high;
+    rec.baud = t->baud;
+    rec.invert = t->invert ? 1 : 0;
+    rec.alive = t->alive ? 1 : 0;
+
+    if (fwrite(&rec, sizeof(rec), 1, w->records) != 1)
+        w->err = ESP_FAIL;
+    if (w->err != ESP_OK)
+        return w->err;
+
+    w->order[w->record_count].catnr = rec.catnr;
+    w->order[w->record_count].seq = w->record_count;
+    w->record_count++;
+    return ESP_OK;
+}
+
+static int compare_order(const void* a, const void* b) {
+    const trsp_db_order_t* x = a;
+    const trsp_db_order_t* y = b;
+    if (x->catnr != y->catnr)
+        return x->catnr < y->catnr ? -1 : 1;
+    // 同一卫星保持原始顺序
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+static esp_err_t write_db(trsp_db_writer_t* w, FILE* out) {
+    trsp_db_header_t hdr = {
+        .magic = TRSP_DB_MAGIC,
+        .version = TRSP_DB_VERSION,
+        .record_size = sizeof(trsp_db_record_t),
+        .record_count = w->record_count,
+        .strtab_size = w->strtab_size,
+    };
+    trsp_db_record_t rec;
+    char block[TRSP_DB_COPY_BLOCK];
+    size_t n;
+
+    for (uint32_t i = 0; i < w->record_count; i++) {
+        if (i == 0 || w->order[i].catnr != w->order[i - 1].catnr)
+            hdr.sat_count++;
+    }
+    hdr.index_offset = sizeof(hdr);
+    hdr.record_offset = hdr.index_offset + hdr.sat_count * sizeof(trsp_db_index_t);
+    hdr.strtab_offset = hdr.record_offset + hdr.record_count * sizeof(trsp_db_record_t);
+
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1)
+        return ESP_FAIL;
+
+    // 索引
+    for (uint32_t i = 0; i < w->record_count;) {
+        trsp_db_index_t idx = { .catnr = w->order[i].catnr, .first = i };
+        while (i < w->record_count && w->order[i].catnr == idx.catnr) {
+            idx.count++;
+            i++;
+        }
+        if (fwrite(&idx, sizeof(idx), 1, out) != 1)
+            return ESP_FAIL;
+    }
+
+    // 按排序结果从临时文件取出记录
+    fflush(w->records);
+    for (uint32_t i = 0; i < w->record_count; i++) {
+        if (fseek(w->records, w->order[i].seq * sizeof(rec), SEEK_SET) != 0 ||
+            fread(&rec, sizeof(rec), 1, w->records) != 1 ||
+            fwrite(&rec, sizeof(rec), 1, out) != 1)
+            return ESP_FAIL;
+    }
+
+    // 字符串表
+    fflush(w->strings);
+    rewind(w->strings);
+    while ((n = fread(block, 1, sizeof(block), w->strings)) > 0) {
+        if (fwrite(block, 1, n, out) != n)
+            return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t trsp_db_writer_commit(trsp_db_writer_t* w) {
+    esp_err_t err = w->err;
+
+    if (err == ESP_OK) {
+        qsort(w->order, w->record_count, sizeof(trsp_db_order_t), compare_order);
+        FILE* out = fopen(TRSP_DB_TMP_PATH, "w");
+        if (!out) {
+            err = ESP_FAIL;
+        } else {
+            err = write_db(w, out);
+            if (fclose(out) != 0 && err == ESP_OK)
+                err = ESP_FAIL;
+        }
+    }
+    uint32_t records = w->record_count;
+    trsp_db_writer_abort(w);
+
+    if (err == ESP_OK && rename(TRSP_DB_TMP_PATH, TRSP_DB_PATH) != 0)
+        err = ESP_FAIL;
+    if (err != ESP_OK) {
+        remove(TRSP_DB_TMP_PATH);
+        ESP_LOGE(TAG, "Failed to write the transponder database");
+        return err;
+    }
+    ESP_LOGI(TAG, "Transponder database written: %lu records", (unsigned long)records);
+    return ESP_OK;
+}
+
+void trsp_db_writer_abort(trsp_db_writer_t* w) {
+    if (w->records) {
+        fclose(w->records);
+        remove(TRSP_DB_RECORDS_PATH);
+    }
+    if (w->strings) {
+        fclose(w->strings);
+        remove(TRSP_DB_STRINGS_PATH);
+    }
+    arena_release(&w->arena);
+    free(w->order);
+    w->records = NULL;
+    w->strings = NULL;
+    w->order = NULL;
+}
+
+static void read_string(FILE* fp, const trsp_db_header_t* hdr, uint32_t offset, char* buf, size_t size) {
+    buf[0] = '\0';
+    if (offset >= hdr->strtab_size || fseek(fp, hdr->strtab_offset + offset, SEEK_SET) != 0)
+        return;
+    size_t n = fread(buf, 1, size - 1, fp);
+    buf[n] = '\0';
+}
+
+static void record_to_transponder(const trsp_db_record_t* rec, struct transponder* t) {
+    memset(t, 0, sizeof(*t));
+    t->catnum = rec->catnr;
+    t->uplink_low = rec->uplink_low;
+    t->uplink_high = rec->uplink_high;
+    t->downlink_low = rec->downlink_low;
+    t->downlink_high = rec->downlink_high;
+    t->baud = rec->baud;
+    t->invert = rec->invert;
+    t->alive = rec->alive;
+}
+
+static bool header_valid(const trsp_db_header_t* hdr) {
+    return hdr->magic == TRSP_DB_MAGIC && hdr->version == TRSP_DB_VERSION &&
+           hdr->record_size == sizeof(trsp_db_record_t);
+}
+
+// 不越过字符串表末尾
+static void copy_string(const char* strtab, uint32_t strtab_size, uint32_t offset, char* buf, size_t size) {
+    buf[0] = '\0';
+    if (offset >= strtab_size)
+        return;
+    size_t n = strnlen(strtab + offset, MIN(size - 1, strtab_size - offset));
+    memcpy(buf, strtab + offset, n);
+    buf[n] = '\0';
+}
+
+// 资源分区中的数据库已映射到内存，直接在flash上查找，不读文件也不分配
+static int lookup_mapped(const uint8_t* db, size_t size, int catnr, struct transponder* out, int max) {
+    const trsp_db_header_t* hdr = (const trsp_db_header_t*)db;
+    if (size < sizeof(*hdr) || !header_valid(hdr) ||
+        (uint64_t)hdr->strtab_offset + hdr->strtab_size > size ||
+        hdr->index_offset + (uint64_t)hdr->sat_count * sizeof(trsp_db_index_t) > size ||
+        hdr->record_offset + (uint64_t)hdr->record_count * sizeof(trsp_db_record_t) > size) {
+        ESP_LOGE(TAG, "Invalid transponder database asset");
+        return 0;
+    }
+    const trsp_db_index_t* index = (const trsp_db_index_t*)(db + hdr->index_offset);
+    const trsp_db_record_t* recs = (const trsp_db_record_t*)(db + hdr->record_offset);
+    const char* strtab = (const char*)(db + hdr->strtab_offset);
+
+    uint32_t lo = 0, hi = hdr->sat_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index[mid].catnr == catnr) {
+            if (index[mid].first + (uint64_t)index[mid].count > hdr->record_count)
+                return 0;
+            int found = MIN((int)index[mid].count, max);
+            for (int i = 0; i < found; i++) {
+                const trsp_db_record_t* rec = &recs[index[mid].first + i];
+                record_to_transponder(rec, &out[i]);
+                copy_string(strtab, hdr->strtab_size, rec->description, out[i].description, sizeof(out[i].description));
+                copy_string(strtab, hdr->strtab_size, rec->mode, out[i].mode, sizeof(out[i].mode));
+            }
+            return found;
+        }
+        if (index[mid].catnr < catnr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+int trsp_db_lookup(int catnr, struct transponder* out, int max) {
+    trsp_db_header_t hdr;
+    trsp_db_index_t idx;
+    int found = 0;
+
+    FILE* fp = fopen(TRSP_DB_PATH, "r");
+    if (!fp) {
+        // 还没有在线更新过，使用资源分区中出厂的数据库
+        size_t size;
+        const uint8_t* db = assets_find(ASSET_TRSP_DB, &size);
+        return db ? lookup_mapped(db, size, catnr, out, max) : 0;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || !header_valid(&hdr)) {
+        ESP_LOGE(TAG, "Invalid transponder database");
+        fclose(fp);
+        return 0;
+    }
+
+    // 在索引上二分查找
+    uint32_t lo = 0, hi = hdr.sat_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (fseek(fp, hdr.index_offset + mid * sizeof(idx), SEEK_SET) != 0 ||
+            fread(&idx, sizeof(idx), 1, fp) != 1)
+            break;
+        if (idx.catnr == catnr) {
+            found = MIN((int)idx.count, max);
+            break;
+        }
+        if (idx.catnr < catnr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (found > 0) {
+        trsp_db_record_t* recs = malloc(found * sizeof(trsp_db_record_t));
+        // 同一卫星的记录连续存放，一次读出
+        if (!recs || fseek(fp, hdr.record_offset + idx.first * sizeof(trsp_db_record_t), SEEK_SET) != 0 ||
+            fread(recs, sizeof(trsp_db_record_t), found, fp) != found) {
+            found = 0;
+        }
+        for (int i = 0; i < found; i++) {
+            record_to_transponder(&recs[i], &out[i]);
+            read_string(fp, &hdr, recs[i].description, out[i].description, sizeof(out[i].description));
+            read_string(fp, &hdr, recs[i].mode, out[i].mode, sizeof(out[i].mode));
+        }
+        free(recs);
+    }
+    fclose(fp);
+    return found;
+}
@@ -15,14 +15,17 @@
  */
 
 #include "trsp_update.h"
+#include "trsp_db.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <dirent.h>
 #include "trsp_type.h"
-#include "esp_http_client.h"
-#include "esp_crt_bundle.h"
+#include "get_tle.h"
+#include "http_session.h"
+#include "json_stream.h"
 #include "esp_log.h"
 
 #define CONFIG_BASE_PATH "/littlefs"
@@ -34,19 +37,43 @@
 #define TRSP_DIR_NAME         "trsp"
 #define MODES_FILE_NAME       "modes.json"
 #define TRSP_FILE_EXT         ".trsp"
-
-// 释放模式数据
-static void free_mode_value(void* value) {
-    trsp_mode_t* mode = (trsp_mode_t*)value;
-    if (mode) {
-        free(mode->mode_name);
-        free(mode);
+#define JSON_FILE_BLOCK       512
+
+// 模式表的arena跨次复用，解析结束时O(1)复位并保留块，定期刷新不再反复申请堆内存。
+// 同时有两次解析时（控制台导入与后台刷新重叠），后来的一次使用自己的arena，结束后释放
+static arena_t parse_arena = { .block_size = ARENA_DEFAULT_BLOCK };
+static bool parse_arena_busy = false;
+static portMUX_TYPE parse_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 流式解析的状态，每次只保存当前这一条记录
+typedef struct {
+    arena_t* arena;                 // 模式表的槽位和名称，指向parse_arena或own_arena
+    arena_t own_arena;
+    hash_map_t modes;               // mode_id -> 模式名
+    trsp_db_writer_t db;
+    char key[24];                   // 当前记录中最近的键
+    struct modes m_modes;
+    struct transponder m_trsp;
+    int mode_id;
+} trsp_parse_ctx_t;
+
+// 删除旧版本按卫星分别存放的.trsp文件
+static void remove_legacy_trsp_files(const char* folder) {
+    char path[MAX_PATH_LENGTH];
+    struct dirent* entry;
+    size_t ext_len = strlen(TRSP_FILE_EXT);
+    DIR* dir = opendir(folder);
+
+    if (!dir)
+        return;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len > ext_len && strcmp(entry->d_name + len - ext_len, TRSP_FILE_EXT) == 0) {
+            snprintf(path, sizeof(path), "%s/%s", folder, entry->d_name);
+            remove(path);
+        }
     }
-}
-
-// 释放转发器数据
-static void free_trsp_value(void* value) {
-    free(value);
+    closedir(dir);
 }
 
 // 确保目录存在
@@ -60,337 +87,256 @@ static bool ensure_directory(const char* path) {
     return true;
 }
 
-// HTTP事件处理函数
-static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
-{
-    static char *output_buffer;  // Buffer for storing HTTP response
-    static int output_len;       // Length of the data read
-    
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            // Handle chunked responses
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                if (evt->user_data) {
-                    memcpy(evt->user_data + output_len, evt->data, evt->data_len);
-                } else {
-                    if (output_buffer == NULL) {
-                        output_buffer = (char *) malloc(esp_http_client_get_content_length(evt->client));
-                        output_len = 0;
-                        if (output_buffer == NULL) {
-                            ESP_LOGE(TAG, "Failed to allocate memory for output buffer");
-                            return ESP_FAIL;
-                        }
-                    }
-                    memcpy(output_buffer + output_len, evt->data, evt->data_len);
-                }
-                output_len += evt->data_len;
-            }
-            break;
-            
-        case HTTP_EVENT_ON_FINISH:
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
-            output_len = 0;
-            break;
-            
-        case HTTP_EVENT_DISCONNECTED:
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
-            output_len = 0;
-            break;
-            
-        default:
-            break;
+/**
+ *  @brief  modes.json的解析回调：[{"id": 1, "name": "FM"}, ...]
+ */
+static esp_err_t modes_json_cb(json_event_t evt, int depth, const char* text, void* ctx) {
+    trsp_parse_ctx_t* p = (trsp_parse_ctx_t*)ctx;
+
+    if (depth == 1 && evt == JSON_EVT_OBJECT_START) {
+        memset(&p->m_modes, 0, sizeof(p->m_modes));
+    } else if (depth == 2 && evt == JSON_EVT_KEY) {
+        strlcpy(p->key, text, sizeof(p->key));
+    } else if (depth == 2 && evt == JSON_EVT_NUMBER && strcmp(p->key, "id") == 0) {
+        p->m_modes.id = atoi(text);
+    } else if (depth == 2 && evt == JSON_EVT_STRING && strcmp(p->key, "name") == 0) {
+        strlcpy(p->m_modes.name, text, sizeof(p->m_modes.name));
+    } else if (depth == 1 && evt == JSON_EVT_OBJECT_END) {
+        char* name = arena_strdup(p->arena, p->m_modes.name);
+        if (!name)
+            return ESP_ERR_NO_MEM;
+        return hash_map_put_int(&p->modes, p->m_modes.id, name);
     }
     return ESP_OK;
 }
 
 /**
- * @brief Download transponder data from SatNOGS database
- * @return true if successful, false otherwise
+ *  @brief  SatNOGS转发器列表的解析回调，每解析完一个对象写入一条数据库记录
  */
-bool download_trsp_data(void) {
-    ESP_LOGI(TAG, "Downloading transponder data from SatNOGS");
-    
-    // Configure HTTP client
-    esp_http_client_config_t config = {
-        .url = TRSP_URL,
-        .cert_pem = NULL,
-        .skip_cert_common_name_check = true,
-        .transport_type = HTTP_TRANSPORT_OVER_SSL,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler = _http_event_handler,
-    };
-    
-    // Initialize HTTP client
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return false;
-    }
-    
-    // Set HTTP method to GET
-    esp_http_client_set_method(client, HTTP_METHOD_GET);
-    
-    // Perform HTTP request
-    esp_err_t err = esp_http_client_perform(client);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        return false;
+static esp_err_t trsp_json_cb(json_event_t evt, int depth, const char* text, void* ctx) {
+    trsp_parse_ctx_t* p = (trsp_parse_ctx_t*)ctx;
+    struct transponder* t = &p->m_trsp;
+
+    if (depth == 1 && evt == JSON_EVT_OBJECT_START) {
+        memset(t, 0, sizeof(*t));
+        p->key[0] = '\0';
+        p->mode_id = -1;
+        return ESP_OK;
     }
-    
-    // Check HTTP status
-    int status_code = esp_http_client_get_status_code(client);
-    if (status_code != 200) {
-        ESP_LOGE(TAG, "HTTP request failed with status code %d", status_code);
-        esp_http_client_cleanup(client);
-        return false;
+    if (depth == 1 && evt == JSON_EVT_OBJECT_END) {
+        // 获取模式信息，列表中没有模式名时用mode_id查表
+        if (t->mode[0] == '\0') {
+            const char* name = hash_map_get_int(&p->modes, p->mode_id);
+            if (name)
+                strlcpy(t->mode, name, sizeof(t->mode));
+            else
+                snprintf(t->mode, sizeof(t->mode), "%d", p->mode_id);
+        }
+        return trsp_db_writer_add(&p->db, t);
     }
-    
-    // Get response length
-    int content_length = esp_http_client_get_content_length(client);
-    ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %d", status_code, content_length);
-    
-    // Allocate memory for response
-    char *response_data = malloc(content_length + 1);
-    if (response_data == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for response data");
-        esp_http_client_cleanup(client);
-        return false;
+    // 只关心记录对象的直接成员，嵌套的值忽略
+    if (depth != 2)
+        return ESP_OK;
+
+    switch (evt) {
+        case JSON_EVT_KEY:
+            strlcpy(p->key, text, sizeof(p->key));
+            break;
+        case JSON_EVT_STRING:
+            if (strcmp(p->key, "description") == 0)
+                strlcpy(t->description, text, sizeof(t->description));
+            else if (strcmp(p->key, "mode") == 0)
+                strlcpy(t->mode, text, sizeof(t->mode));
+            else if (strcmp(p->key, "uuid") == 0)
+                strlcpy(t->uuid, text, sizeof(t->uuid));
+            break;
+        case JSON_EVT_NUMBER:
+            if (strcmp(p->key, "norad_cat_id") == 0)
+                t->catnum = atoi(text);
+            else if (strcmp(p->key, "uplink_low") == 0)
+                t->uplink_low = strtoll(text, NULL, 10);
+            else if (strcmp(p->key, "uplink_high") == 0)
+                t->uplink_high = strtoll(text, NULL, 10);
+            else if (strcmp(p->key, "downlink_low") == 0)
+                t->downlink_low = strtoll(text, NULL, 10);
+            else if (strcmp(p->key, "downlink_high") == 0)
+                t->downlink_high = strtoll(text, NULL, 10);
+            else if (strcmp(p->key, "mode_id") == 0)
+                p->mode_id = atoi(text);
+            else if (strcmp(p->key, "baud") == 0)
+                t->baud = strtod(text, NULL);
+            break;
+        case JSON_EVT_TRUE:
+        case JSON_EVT_FALSE:
+            if (strcmp(p->key, "invert") == 0)
+                t->invert = evt == JSON_EVT_TRUE;
+            else if (strcmp(p->key, "alive") == 0)
+                t->alive = evt == JSON_EVT_TRUE;
+            break;
+        default:
+            break;
     }
-    
-    // Read response data
-    int read_len = esp_http_client_read(client, response_data, content_length);
-    if (read_len <= 0) {
-        ESP_LOGE(TAG, "Failed to read response data");
-        free(response_data);
-        esp_http_client_cleanup(client);
-        return false;
+    return ESP_OK;
+}
+
+// 按固定大小的块读取文件并输入解析器
+static esp_err_t parse_json_file(const char* path, json_stream_cb_t cb, void* ctx) {
+    char block[JSON_FILE_BLOCK];
+    json_stream_t js;
+    size_t n;
+
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return ESP_ERR_NOT_FOUND;
+    json_stream_init(&js, cb, ctx);
+    while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+        if (json_stream_feed(&js, block, n) != ESP_OK)
+            break;
     }
-    response_data[read_len] = '\0';
-    
-    // Process the JSON data using existing trsp_update_files function
-    bool result = trsp_update_files(response_data);
-    
-    // Cleanup
-    free(response_data);
-    esp_http_client_cleanup(client);
-    
-    return result;
+    fclose(fp);
+    return json_stream_finish(&js);
 }
 
-/**
- *  @brief               更新转发器数据主体函数
- *  @param json_data     输入JSON数据
- */
-bool trsp_update_files(const char* json_data) {
-    FILE* mfp;
-    size_t mfplen;
-    long flen;
-    int result;
-    FILE* ffile;
-    char* jsn_object;
-    unsigned int idx;
-    trsp_mode_t* nmode;
-    trsp_t* ntrsp;
-    int* key;
+static esp_err_t trsp_json_sink(const uint8_t* data, size_t len, void* ctx) {
+    return json_stream_feed((json_stream_t*)ctx, (const char*)data, len);
+}
 
+static bool trsp_folder_path(char* trspfolder, size_t size) {
     char userconfdir[MAX_PATH_LENGTH] = {0};
-    char trspfolder[MAX_PATH_LENGTH] = {0};
-    char modesfile[MAX_PATH_LENGTH] = {0};
-    char trspfile[MAX_PATH_LENGTH] = {0};
 
-    // 使用 strlcpy 和 strlcat 来安全地构建路径
     if (snprintf(userconfdir, sizeof(userconfdir), "%s/conf", CONFIG_BASE_PATH) >= sizeof(userconfdir)) {
         ESP_LOGE(TAG, "Path too long for userconfdir");
         return false;
     }
-    
-    if (snprintf(trspfolder, sizeof(trspfolder), "%s/%s", userconfdir, TRSP_DIR_NAME) >= sizeof(trspfolder)) {
+    if (snprintf(trspfolder, size, "%s/%s", userconfdir, TRSP_DIR_NAME) >= size) {
         ESP_LOGE(TAG, "Path too long for trspfolder");
         return false;
     }
-    
-    if (snprintf(modesfile, sizeof(modesfile), "%s/%s", trspfolder, MODES_FILE_NAME) >= sizeof(modesfile)) {
-        ESP_LOGE(TAG, "Path too long for modesfile");
+    // 确保目录存在
+    return ensure_directory(userconfdir) && ensure_directory(trspfolder);
+}
+
+// 读取本地的模式表并开始写数据库
+static void parse_arena_done(trsp_parse_ctx_t* p) {
+    if (p->arena == &parse_arena) {
+        arena_reset(&parse_arena);
+        taskENTER_CRITICAL(&parse_arena_lock);
+        parse_arena_busy = false;
+        taskEXIT_CRITICAL(&parse_arena_lock);
+    } else {
+        arena_release(&p->own_arena);
+    }
+}
+
+static bool trsp_parse_begin(trsp_parse_ctx_t* p, const char* trspfolder) {
+    char modesfile[MAX_PATH_LENGTH] = {0};
+
+    memset(p, 0, sizeof(*p));
+    taskENTER_CRITICAL(&parse_arena_lock);
+    if (!parse_arena_busy) {
+        parse_arena_busy = true;
+        p->arena = &parse_arena;
+    }
+    taskEXIT_CRITICAL(&parse_arena_lock);
+    if (p->arena == NULL) {
+        arena_init(&p->own_arena, ARENA_DEFAULT_BLOCK);
+        p->arena = &p->own_arena;
+    }
+    if (hash_map_init(&p->modes, p->arena, HASH_MAP_KEY_INT, 0) != ESP_OK) {
+        printf("Failed to create hash tables\n");
+        parse_arena_done(p);
         return false;
     }
 
-    // 确保目录存在
-    if (!ensure_directory(userconfdir) || !ensure_directory(trspfolder)) {
+    if (snprintf(modesfile, sizeof(modesfile), "%s/%s", trspfolder, MODES_FILE_NAME) < sizeof(modesfile)) {
+        esp_err_t err = parse_json_file(modesfile, modes_json_cb, p);
+        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND)
+            ESP_LOGW(TAG, "Ignoring invalid %s", MODES_FILE_NAME);
+    }
+
+    if (trsp_db_writer_begin(&p->db) != ESP_OK) {
+        parse_arena_done(p);
         return false;
     }
+    return true;
+}
 
-    // 创建哈希表
-    hash_table_t* modes_hash = hash_table_create(free_mode_value);
-    hash_table_t* trsp_hash = hash_table_create(free_trsp_value);
-    
-    if (!modes_hash || !trsp_hash) {
-        printf("Failed to create hash tables\n");
+static bool trsp_parse_end(trsp_parse_ctx_t* p, const char* trspfolder, esp_err_t err) {
+    parse_arena_done(p);
+
+    if (err != ESP_OK) {
+        trsp_db_writer_abort(&p->db);
         return false;
     }
+    if (trsp_db_writer_commit(&p->db) != ESP_OK)
+        return false;
+    remove_legacy_trsp_files(trspfolder);
+    return true;
+}
 
-    // 读取模式文件
-    mfp = fopen(modesfile, "r");
-    if (mfp != NULL) {
-        fseek(mfp, 0, SEEK_END);
-        flen = ftell(mfp);
-
-        if (flen > 1) {
-            mfplen = flen;
-            rewind(mfp);
-            jsn_object = malloc(mfplen);
-            
-            if (jsn_object) {
-                result = fread(jsn_object, mfplen, 1, mfp);
-
-                if (result == 1) {
-                    const nx_json* json = nx_json_parse(jsn_object, 0);
-                    if (json) {
-                        idx = 0;
-                        while (1) {
-                            const nx_json* json_obj = nx_json_item(json, idx++);
-                            struct modes m_modes;
-
-                            if (json_obj->type == NX_JSON_NULL)
-                                break;
-
-                            m_modes.id = nx_json_get(json_obj, "id")->int_value;
-                            strncpy(m_modes.name,
-                                    nx_json_get(json_obj, "name")->text_value, 79);
-                            m_modes.name[79] = 0;
-
-                            key = malloc(sizeof(int));
-                            if (key) {
-                                *key = m_modes.id;
-                                nmode = malloc(sizeof(trsp_mode_t));
-                                if (nmode) {
-                                    nmode->mode_id = m_modes.id;
-                                    nmode->mode_name = strdup(m_modes.name);
-                                    hash_table_insert(modes_hash, key, nmode);
-                                }
-                            }
-                        }
-                        nx_json_free(json);
-                    }
-                }
-                free(jsn_object);
-            }
-        }
-        fclose(mfp);
+/**
+ * @brief Download transponder data from SatNOGS database
+ * @return true if successful, false otherwise
+ */
+bool download_trsp_data(void) {
+    return download_trsp_data_from(TRSP_URL);
+}
+
+/**
+ * @brief Download transponder data from the given URL (SatNOGS or the LAN mirror)
+ * @return true if successful, false otherwise
+ */
+bool download_trsp_data_from(const char *url) {
+    char trspfolder[MAX_PATH_LENGTH] = {0};
+    trsp_parse_ctx_t* p;
+    json_stream_t js;
+
+    ESP_LOGI(TAG, "Downloading transponder data from %s", url);
+
+    if (!trsp_folder_path(trspfolder, sizeof(trspfolder)))
+        return false;
+    p = malloc(sizeof(trsp_parse_ctx_t));
+    if (!p || !trsp_parse_begin(p, trspfolder)) {
+        free(p);
+        return false;
     }
 
-    // 处理转发器数据
-    mfp = fopen(json_data, "r");
-    if (mfp != NULL) {
-        fseek(mfp, 0, SEEK_END);
-        flen = ftell(mfp);
-
-        if (flen > 1) {
-            mfplen = flen;
-            rewind(mfp);
-            jsn_object = malloc(mfplen);
-            
-            if (jsn_object) {
-                result = fread(jsn_object, mfplen, 1, mfp);
-
-                if (result == 1) {
-                    const nx_json* json = nx_json_parse(jsn_object, 0);
-                    if (json) {
-                        idx = 0;
-                        while (1) {
-                            const nx_json* json_obj = nx_json_item(json, idx++);
-                            struct transponder m_trsp;
-
-                            if (json_obj->type == NX_JSON_NULL)
-                                break;
-
-                            // 解析转发器数据
-                            strncpy(m_trsp.description,
-                                    nx_json_get(json_obj, "description")->text_value, 79);
-                            m_trsp.description[79] = 0;
-                            m_trsp.catnum = nx_json_get(json_obj, "norad_cat_id")->int_value;
-                            m_trsp.uplink_low = nx_json_get(json_obj, "uplink_low")->int_value;
-                            m_trsp.uplink_high = nx_json_get(json_obj, "uplink_high")->int_value;
-                            m_trsp.downlink_low = nx_json_get(json_obj, "downlink_low")->int_value;
-                            m_trsp.downlink_high = nx_json_get(json_obj, "downlink_high")->int_value;
-
-                            // 获取模式信息
-                            key = malloc(sizeof(int));
-                            if (key) {
-                                *key = nx_json_get(json_obj, "mode_id")->int_value;
-                                nmode = hash_table_lookup(modes_hash, key);
-                                if (nmode)
-                                    strncpy(m_trsp.mode, nmode->mode_name, sizeof(m_trsp.mode) - 1);
-                                else
-                                    snprintf(m_trsp.mode, sizeof(m_trsp.mode), "%d", *key);
-                                free(key);
-                            }
-
-                            m_trsp.invert = nx_json_get(json_obj, "invert")->int_value;
-                            m_trsp.baud = nx_json_get(json_obj, "baud")->dbl_value;
-                            m_trsp.alive = nx_json_get(json_obj, "alive")->int_value;
-
-                            // 创建转发器文件
-                            if (snprintf(trspfile, sizeof(trspfile), "%s/%d%s", 
-                                    trspfolder, m_trsp.catnum, TRSP_FILE_EXT) >= sizeof(trspfile)) {
-                                ESP_LOGE(TAG, "Path too long for trspfile");
-                                return false;
-                            }
-
-                            key = malloc(sizeof(int));
-                            if (key) {
-                                *key = m_trsp.catnum;
-                                ntrsp = hash_table_lookup(trsp_hash, key);
-
-                                if (!ntrsp) {
-                                    ntrsp = malloc(sizeof(trsp_t));
-                                    if (ntrsp) {
-                                        ntrsp->cat_num = m_trsp.catnum;
-                                        ntrsp->num_trsp = 1;
-                                        hash_table_insert(trsp_hash, key, ntrsp);
-                                        remove(trspfile);
-                                    }
-                                }
-                            }
-
-                            // 写入转发器数据
-                            ffile = fopen(trspfile, "a");
-                            if (ffile != NULL) {
-                                fprintf(ffile, "\n[%s]\n", m_trsp.description);
-                                if (m_trsp.uplink_low > 0)
-                                    fprintf(ffile, "UP_LOW=%lld\n", m_trsp.uplink_low);
-                                if (m_trsp.uplink_high > 0)
-                                    fprintf(ffile, "UP_HIGH=%lld\n", m_trsp.uplink_high);
-                                if (m_trsp.downlink_low > 0)
-                                    fprintf(ffile, "DOWN_LOW=%lld\n", m_trsp.downlink_low);
-                                if (m_trsp.downlink_high > 0)
-                                    fprintf(ffile, "DOWN_HIGH=%lld\n", m_trsp.downlink_high);
-                                fprintf(ffile, "MODE=%s\n", m_trsp.mode);
-                                if (m_trsp.baud > 0.0)
-                                    fprintf(ffile, "BAUD=%.0f\n", m_trsp.baud);
-                                if (m_trsp.invert)
-                                    fprintf(ffile, "INVERT=true\n");
-                                fclose(ffile);
-                            }
-                        }
-                        nx_json_free(json);
-                    }
-                }
-                free(jsn_object);
-            }
-        }
-        fclose(mfp);
+    // 响应体边收边解压边解析，每条记录直接写入数据库，不落地JSON文件也不建立DOM
+    json_stream_init(&js, trsp_json_cb, p);
+    http_download_ctx_t dl = { .sink = trsp_json_sink, .sink_ctx = &js };
+
+    // 与TLE下载共用会话，刷新时不再单独握手
+    esp_err_t err = http_session_download(url, &dl);
+    http_session_close_idle();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+    } else {
+        err = json_stream_finish(&js);
     }
 
-    // 清理
-    hash_table_destroy(modes_hash);
-    hash_table_destroy(trsp_hash);
+    bool ok = trsp_parse_end(p, trspfolder, err);
+    free(p);
+    return ok;
+}
 
-    return true;
-}
\ No newline at end of file
+/**
+ *  @brief               从本地JSON文件更新转发器数据库
+ *  @param json_data     输入JSON文件路径
+ */
+bool trsp_update_files(const char* json_data) {
+    char trspfolder[MAX_PATH_LENGTH] = {0};
+    trsp_parse_ctx_t* p;
+
+    if (!trsp_folder_path(trspfolder, sizeof(trspfolder)))
+        return false;
+    p = malloc(sizeof(trsp_parse_ctx_t));
+    if (!p || !trsp_parse_begin(p, trspfolder)) {
+        free(p);
+        return false;
+    }
+
+    esp_err_t err = parse_json_file(json_data, trsp_json_cb, p);
+    bool ok = trsp_parse_end(p, trspfolder, err);
+    free(p);
+    return ok;
+}
@@ -67,7 +67,13 @@ void echo_task(void *pvParameter)
         int len = uart_read_bytes(ECHO_UART_PORT_NUM, data, (BUF_SIZE - 1), 100 / portTICK_PERIOD_MS);
         if (len) 
         {
-            if (strstr(data, "reconnect") != NULL)
+            // 调度命令的参数中可能含有卫星名，要在卫星名匹配之前处理
+            if (strstr(data, "sched") != NULL)
+            {
+                data[len] = '\0';
+                pass_sched_command(data);
+            }
+            else if (strstr(data, "reconnect") != NULL)
             {
                 xTaskNotify(tle_download_handler, UPDATE_TLE, eSetValueWithOverwrite);
             }
@@ -230,13 +236,133 @@ void echo_task(void *pvParameter)
                 xTaskNotify(orbit_trking_handler, END_ORB_TRKING, eSetValueWithOverwrite);
                 ESP_LOGI(TAG, "Deactivate the tracking mode.\n");
             }
+            else if (strstr(data, "trsp") != NULL)
+            {
+                struct transponder trsp[8];
+                int catnr = atoi(strstr(data, "trsp") + 4);
+                int n = trsp_db_lookup(catnr, trsp, sizeof(trsp) / sizeof(trsp[0]));
+                printf("%d transponders for %d\n", n, catnr);
+                for (int i = 0; i < n; i++)
+                {
+                    printf("[%s] down %lld-%lld up %lld-%lld %s%s\n", trsp[i].description,
+                           trsp[i].downlink_low, trsp[i].downlink_high, trsp[i].uplink_low, trsp[i].uplink_high,
+                           trsp[i].mode, trsp[i].invert ? " inverted" : "");
+                }
+            }
+            else if (strstr(data, "sat state") != NULL)
+            {
+                track_state_t state;
+                if (state_bus_read(&state))
+                {
+                    state_bus_read_target(input_satname, sizeof(input_satname));
+                    printf("%s (%ld) #%lu: azi %.2f ele %.2f range %.1f km rate %.3f km/s%s\n",
+                           input_satname, (long)state.catnr, (unsigned long)state.generation,
+                           state.azi, state.ele, state.range, state.range_rate,
+                           (state.flags & STATE_FLAG_ECLIPSED) ? " eclipsed" : "");
+                }
+                else
+                {
+                    printf("Not tracking.\n");
+                }
+            }
+            else if (strstr(data, "rot goto") != NULL)
+            {
+                float az, el;
+                data[len] = '\0';
+                if (sscanf(strstr(data, "rot goto") + 8, "%f %f", &az, &el) == 2)
+                {
+                    printf("setpoint #%lu\n", (unsigned long)setpoint_post(az, el, SETPOINT_SRC_CONSOLE));
+                }
+                else
+                {
+                    printf("usage: rot goto <azimuth> <elevation>\n");
+                }
+            }
+            else if (strstr(data, "rot stats") != NULL)
+            {
+                rot_setpoint_t sp;
+                setpoint_stats_t stats;
+                setpoint_get_stats(&stats);
+                if (setpoint_last(&sp))
+                {
+                    printf("setpoint #%lu from %d: azi %.2f ele %.2f, %lld ms ago\n", (unsigned long)sp.seq, sp.source,
+                           sp.azimuth, sp.elevation, (esp_timer_get_time() - sp.time_us) / 1000);
+                }
+                printf("posted %lu, taken %lu, overwritten %lu\n", (unsigned long)stats.posted,
+                       (unsigned long)stats.taken, (unsigned long)stats.overwritten);
+            }
+            else if (strstr(data, "lat stats") != NULL)
+            {
+                latency_stats_print();
+            }
+#if CONFIG_TALLNECK_UDP_STREAM
+            else if (strstr(data, "udp rate") != NULL)
+            {
+                data[len] = '\0';
+                if (udp_stream_set_rate(atoi(strstr(data, "udp rate") + 8)) != ESP_OK)
+                {
+                    printf("usage: udp rate <%d-%d>\n", UDP_STREAM_MIN_HZ, UDP_STREAM_MAX_HZ);
+                }
+            }
+            else if (strstr(data, "udp stats") != NULL)
+            {
+                udp_stream_stats_t stats;
+                udp_stream_get_stats(&stats);
+                printf("%d destinations at %lu Hz: sent %lu, errors %lu\n", stats.dest_count,
+                       (unsigned long)stats.rate_hz, (unsigned long)stats.sent, (unsigned long)stats.errors);
+            }
+#endif
+            else if (strstr(data, "ws stats") != NULL)
+            {
+                ws_feed_stats_t stats;
+                ws_feed_get_stats(&stats);
+                printf("%d clients: %lu frames, sent %lu, dropped %lu\n", stats.clients, (unsigned long)stats.frames,
+                       (unsigned long)stats.sent, (unsigned long)stats.dropped);
+            }
+            else if (strstr(data, "traj stop") != NULL)
+            {
+                traj_stop();
+            }
+            else if (strstr(data, "traj") != NULL)
+            {
+                static const char *traj_states[] = { "idle", "loading", "armed", "running", "done" };
+                traj_status_t st;
+                traj_get_status(&st);
+                printf("trajectory %s: %d points, %lld..%lld, %lu setpoints posted\n", traj_states[st.state],
+                       st.points, st.start_ms / 1000, st.end_ms / 1000, (unsigned long)st.posted);
+            }
+#if CONFIG_TALLNECK_GS232
+            else if (strstr(data, "gs232 stats") != NULL)
+            {
+                gs232_stats_t stats;
+                gs232_get_stats(&stats);
+                printf("GS-232 on UART%d: %lu commands, %lu errors, %lu overflows\n", CONFIG_TALLNECK_GS232_UART_NUM,
+                       (unsigned long)stats.commands, (unsigned long)stats.errors, (unsigned long)stats.overflows);
+            }
+#endif
+            else if (strstr(data, "tick stats") != NULL)
+            {
+                track_tick_stats_print();
+            }
+            else if (strstr(data, "boot prof") != NULL)
+            {
+                boot_prof_report();
+            }
+            else if (strstr(data, "mem stats") != NULL)
+            {
+                mem_stats_print();
+            }
             else if (strstr(data, "file info") != NULL)
             {
                 get_file_info();
             }
             else if (strstr(data, "sync time") != NULL)
             {
-                sntp_netif_sync_time();
+                time_sync_request();
+            }
+            else if (strstr(data, "time stats") != NULL)
+            {
+                time_sync_print();
             }
             else if (strstr(data, "recon") != NULL)
             {
@@ -263,7 +389,25 @@ void echo_task(void *pvParameter)
                 printf("start tracking\tActivate the orbit tracking function.\t\n");
                 printf("end tracking\tDeactivate the orbit tracking function.\t\n");
                 printf("file info\tShowing the file information.\t\n");
+                printf("trsp <catnr>\tList the transponders of a satellite.\t\n");
+                printf("mem stats\tShowing the allocator counters and pool usage.\t\n");
+                printf("sat state\tShowing the latest state of the tracked satellite.\t\n");
+                printf("sched\tList the pass schedule; sched add <prio> <min ele> <name> | del <name> | on | off\t\n");
+                printf("rot goto <az> <el>\tSend a setpoint to the rotator.\t\n");
+                printf("rot stats\tShowing the latest rotator setpoint and mailbox counters.\t\n");
+                printf("lat stats\tShowing the command-to-motion latency per stage.\t\n");
+#if CONFIG_TALLNECK_UDP_STREAM
+                printf("udp stats\tShowing the UDP state stream counters; udp rate <hz> changes the rate.\t\n");
+#endif
+                printf("ws stats\tShowing the WebSocket live feed counters.\t\n");
+                printf("traj\tShowing the uploaded trajectory; traj stop cancels it.\t\n");
+#if CONFIG_TALLNECK_GS232
+                printf("gs232 stats\tShowing the GS-232 serial emulation counters.\t\n");
+#endif
+                printf("tick stats\tShowing the tracking tick period and jitter.\t\n");
+                printf("boot prof\tShowing the boot stage timings.\t\n");
                 printf("sync time\tSyncing time throught the sntp server.\n");
+                printf("time stats\tShowing the SNTP offset, slew and clock drift estimate.\t\n");
                 printf("re\tReconnect the wifi, you are able to choose another one\t\n");
             }
             else
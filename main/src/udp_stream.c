@@ -0,0 +1,175 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "udp_stream.h"
+#include "state_bus.h"
+#include "setpoint.h"
+
+#define TAG "udp_stream"
+
+static struct sockaddr_in dests[UDP_STREAM_MAX_DEST];
+static int dest_count;
+static volatile uint32_t rate_hz = CONFIG_TALLNECK_UDP_STREAM_HZ;
+static udp_stream_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief   解析"ip[:port],ip[:port]"形式的目标列表，省略端口时用默认端口
+ */
+static int parse_dests(const char *list)
+{
+    char buf[sizeof(CONFIG_TALLNECK_UDP_STREAM_DEST)];
+    char *save = NULL;
+    int n = 0;
+
+    strlcpy(buf, list, sizeof(buf));
+    for (char *item = strtok_r(buf, ", ", &save); item != NULL && n < UDP_STREAM_MAX_DEST;
+         item = strtok_r(NULL, ", ", &save))
+    {
+        int port = CONFIG_TALLNECK_UDP_STREAM_PORT;
+        char *colon = strchr(item, ':');
+        if (colon != NULL)
+        {
+            *colon = '\0';
+            port = atoi(colon + 1);
+        }
+        memset(&dests[n], 0, sizeof(dests[n]));
+        dests[n].sin_family = AF_INET;
+        dests[n].sin_port = htons(port);
+        if (inet_pton(AF_INET, item, &dests[n].sin_addr) != 1 || port <= 0 || port > 65535)
+        {
+            ESP_LOGW(TAG, "Invalid destination: %s", item);
+            continue;
+        }
+        ESP_LOGI(TAG, "Streaming to %s:%d%s", item, port,
+                 IN_MULTICAST(ntohl(dests[n].sin_addr.s_addr)) ? " (multicast)" : "");
+        n++;
+    }
+    return n;
+}
+
+static void fill_packet(udp_state_packet_t *pkt, uint32_t seq)
+{
+    track_state_t state;
+    rot_setpoint_t sp;
+
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->magic = UDP_STREAM_MAGIC;
+    pkt->version = UDP_STREAM_VERSION;
+    pkt->seq = seq;
+    if (state_bus_read(&state))
+    {
+        pkt->flags |= UDP_FLAG_TRACKING
+            | ((state.flags & STATE_FLAG_ECLIPSED) ? UDP_FLAG_ECLIPSED : 0)
+            | ((state.flags & STATE_FLAG_DEEP_SPACE) ? UDP_FLAG_DEEP_SPACE : 0)
+            | ((state.flags & STATE_FLAG_IN_PASS) ? UDP_FLAG_IN_PASS : 0);
+        pkt->time_ms = state.time_ms;
+        pkt->catnr = state.catnr;
+        pkt->azi = state.azi;
+        pkt->ele = state.ele;
+        pkt->range = state.range;
+        pkt->range_rate = state.range_rate;
+        pkt->lat = state.lat;
+        pkt->lon = state.lon;
+        pkt->alt = state.alt;
+    }
+    else
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        pkt->time_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    }
+    if (setpoint_last(&sp))
+    {
+        pkt->flags |= UDP_FLAG_ROTATOR;
+        pkt->rot_azi = sp.azimuth;
+        pkt->rot_ele = sp.elevation;
+    }
+}
+
+void udp_stream_task(void *pvParameters)
+{
+    udp_state_packet_t pkt;
+    uint32_t seq = 0;
+    uint8_t ttl = CONFIG_TALLNECK_UDP_STREAM_TTL;
+
+    dest_count = parse_dests(CONFIG_TALLNECK_UDP_STREAM_DEST);
+    taskENTER_CRITICAL(&stats_lock);
+    stats.dest_count = dest_count;
+    taskEXIT_CRITICAL(&stats_lock);
+    if (dest_count == 0)
+    {
+        ESP_LOGE(TAG, "No valid destination, stream disabled");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+    // 组播只在局域网内转发
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1)
+    {
+        uint32_t sent = 0;
+        fill_packet(&pkt, seq++);
+        for (int i = 0; i < dest_count; i++)
+        {
+            // 未联网时sendto立即失败，不阻塞
+            if (sendto(sock, &pkt, sizeof(pkt), MSG_DONTWAIT, (struct sockaddr *)&dests[i], sizeof(dests[i])) == sizeof(pkt))
+            {
+                sent++;
+            }
+        }
+        taskENTER_CRITICAL(&stats_lock);
+        stats.sent += sent;
+        stats.errors += dest_count - sent;
+        taskEXIT_CRITICAL(&stats_lock);
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(1000 / rate_hz));
+    }
+}
+
+esp_err_t udp_stream_set_rate(uint32_t hz)
+{
+    if (hz < UDP_STREAM_MIN_HZ || hz > UDP_STREAM_MAX_HZ)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rate_hz = hz;
+    return ESP_OK;
+}
+
+void udp_stream_get_stats(udp_stream_stats_t *out)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&stats_lock);
+    out->rate_hz = rate_hz;
+}
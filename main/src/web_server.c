@@ -0,0 +1,297 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "esp_log.h"
+
+#include "web_server.h"
+#include "get_tle.h"
+#include "catalog_mirror.h"
+#include "inflate_stream.h"
+#include "latency_stats.h"
+#include "ws_feed.h"
+#include "trajectory.h"
+
+#define TAG "web_server"
+
+static httpd_handle_t server = NULL;
+
+typedef struct
+{
+    FILE *fp;
+    size_t written;
+} upload_ctx_t;
+
+static esp_err_t upload_file_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    upload_ctx_t *up = (upload_ctx_t *)ctx;
+    if (up->written + len > CONFIG_TALLNECK_CATALOG_MAX_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (fwrite(data, 1, len, up->fp) != len)
+    {
+        return ESP_FAIL;
+    }
+    up->written += len;
+    return ESP_OK;
+}
+
+static esp_err_t send_status(httpd_req_t *req, const char *status, const char *msg)
+{
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, msg);
+}
+
+/**
+ * @brief   POST /catalog：请求体为TLE文本（可用Content-Encoding: gzip压缩），
+ *          按固定大小的块边收边写入临时文件，接收完整并校验通过后替换tle_eph.txt
+ *          curl --data-binary @tle.txt http://<ip>:8080/catalog
+ */
+static esp_err_t catalog_upload_handler(httpd_req_t *req)
+{
+    char block[CATALOG_UPLOAD_BLOCK];
+    char encoding[16] = {0};
+    upload_ctx_t up = {0};
+    inflate_stream_t inflater = {0};
+    size_t remaining = req->content_len;
+    esp_err_t err;
+
+    if (req->content_len == 0)
+    {
+        return send_status(req, "411 Length Required", "Empty or chunked body is not supported\n");
+    }
+    if (req->content_len > CONFIG_TALLNECK_CATALOG_MAX_SIZE)
+    {
+        return send_status(req, "413 Payload Too Large", "Catalog too large\n");
+    }
+    httpd_req_get_hdr_value_str(req, "Content-Encoding", encoding, sizeof(encoding));
+
+    up.fp = fopen(CATALOG_UPLOAD_TMP_PATH, "w");
+    if (up.fp == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to open %s", CATALOG_UPLOAD_TMP_PATH);
+        return send_status(req, "500 Internal Server Error", "Failed to open temp file\n");
+    }
+    err = inflate_stream_init(&inflater, inflate_encoding_from_header(encoding), upload_file_sink, &up);
+
+    // 请求体不整体缓存，内存占用与上传大小无关
+    while (err == ESP_OK && remaining > 0)
+    {
+        int received = httpd_req_recv(req, block, MIN(remaining, sizeof(block)));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        err = inflate_stream_feed(&inflater, (const uint8_t *)block, received);
+        remaining -= received;
+    }
+    if (err == ESP_OK)
+    {
+        err = inflate_stream_finish(&inflater);
+    }
+    inflate_stream_deinit(&inflater);
+    if (fclose(up.fp) != 0 && err == ESP_OK)
+    {
+        err = ESP_FAIL;
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Catalog upload aborted after %u bytes: %s", (unsigned)up.written, esp_err_to_name(err));
+        remove(CATALOG_UPLOAD_TMP_PATH);
+        if (err == ESP_ERR_INVALID_STATE)
+        {
+            // 连接已断开，无法再回复
+            return ESP_FAIL;
+        }
+        return send_status(req, err == ESP_ERR_INVALID_SIZE ? "413 Payload Too Large" : "400 Bad Request",
+                           "Upload failed\n");
+    }
+
+    int count = 0;
+    err = catalog_install(CATALOG_UPLOAD_TMP_PATH, FLASH_FILE_PATH, &count);
+    if (err == ESP_ERR_INVALID_ARG)
+    {
+        return send_status(req, "422 Unprocessable Entity", "Invalid TLE catalog, nothing changed\n");
+    }
+    if (err != ESP_OK)
+    {
+        return send_status(req, "500 Internal Server Error", "Failed to install catalog\n");
+    }
+
+    snprintf(block, sizeof(block), "{\"satellites\":%d,\"bytes\":%u}\n", count, (unsigned)up.written);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, block);
+}
+
+static const httpd_uri_t catalog_upload_uri =
+{
+    .uri = CATALOG_UPLOAD_URI,
+    .method = HTTP_POST,
+    .handler = catalog_upload_handler,
+    .user_ctx = NULL,
+};
+
+/**
+ * @brief   POST /trajectory：请求体每行为"<unix时间> <方位角> <仰角>"，边收边解析，
+ *          全部有效时交给轨迹执行任务，按设备时钟执行
+ *          curl --data-binary @pass.txt http://<ip>:8080/trajectory
+ */
+static esp_err_t trajectory_upload_handler(httpd_req_t *req)
+{
+    char block[CATALOG_UPLOAD_BLOCK];
+    char line[TRAJ_LINE_LEN];
+    size_t line_len = 0;
+    size_t remaining = req->content_len;
+    int line_no = 0;
+    esp_err_t err = ESP_OK;
+
+    if (req->content_len == 0)
+    {
+        return send_status(req, "411 Length Required", "Empty or chunked body is not supported\n");
+    }
+
+    traj_load_begin();
+    while (err == ESP_OK && remaining > 0)
+    {
+        int received = httpd_req_recv(req, block, MIN(remaining, sizeof(block)));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        remaining -= received;
+        // 最后一行可以没有换行符
+        for (int i = 0; i < received && err == ESP_OK; i++)
+        {
+            bool last = remaining == 0 && i == received - 1;
+            if (block[i] != '\n' && line_len < sizeof(line) - 1)
+            {
+                line[line_len++] = block[i];
+            }
+            if (block[i] == '\n' || last)
+            {
+                line[line_len] = '\0';
+                line_len = 0;
+                line_no++;
+                err = traj_load_line(line);
+            }
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = traj_load_end();
+    }
+    else
+    {
+        traj_load_abort();  // 丢弃未完成的上传，当前轨迹继续执行
+    }
+
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK)
+    {
+        snprintf(block, sizeof(block), "Invalid trajectory at line %d, %s\n", line_no,
+                 err == ESP_ERR_NO_MEM ? "too many points" : "expected increasing '<unix time> <azimuth> <elevation>'");
+        return send_status(req, err == ESP_ERR_NO_MEM ? "413 Payload Too Large" : "422 Unprocessable Entity", block);
+    }
+
+    traj_status_t st;
+    traj_get_status(&st);
+    snprintf(block, sizeof(block), "{\"points\":%d,\"start_ms\":%lld,\"end_ms\":%lld}\n",
+             st.points, st.start_ms, st.end_ms);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, block);
+}
+
+static const httpd_uri_t trajectory_upload_uri =
+{
+    .uri = TRAJECTORY_URI,
+    .method = HTTP_POST,
+    .handler = trajectory_upload_handler,
+    .user_ctx = NULL,
+};
+
+/**
+ * @brief   GET /latency：命令到电机动作各阶段的延迟统计（JSON）
+ *          curl http://<ip>:8080/latency
+ */
+static esp_err_t latency_handler(httpd_req_t *req)
+{
+    char body[LATENCY_JSON_SIZE];
+    latency_format_json(body, sizeof(body));
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, body);
+}
+
+static const httpd_uri_t latency_uri =
+{
+    .uri = LATENCY_URI,
+    .method = HTTP_GET,
+    .handler = latency_handler,
+    .user_ctx = NULL,
+};
+
+esp_err_t web_server_start(void)
+{
+    if (server != NULL)
+    {
+        return ESP_OK;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_TALLNECK_WEB_SERVER_PORT;
+    config.ctrl_port += 1;  // 与wifi manager的服务器错开
+    config.recv_wait_timeout = 10;
+    config.close_fn = ws_feed_on_close;     // 连接关闭时立即释放推送客户端
+
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start web server: %s", esp_err_to_name(err));
+        server = NULL;
+        return err;
+    }
+    httpd_register_uri_handler(server, &catalog_upload_uri);
+    httpd_register_uri_handler(server, &latency_uri);
+    httpd_register_uri_handler(server, &trajectory_upload_uri);
+    ws_feed_start(server);
+    ESP_LOGI(TAG, "Web server listening on port %d", config.server_port);
+    return ESP_OK;
+}
+
+void web_server_stop(void)
+{
+    if (server != NULL)
+    {
+        httpd_stop(server);
+        server = NULL;
+    }
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright 2025 Cyfarwydd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "ws_feed.h"
+#include "state_bus.h"
+#include "setpoint.h"
+#include "sgp4sdp4.h"
+
+#define TAG "ws_feed"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+// 帧缓冲，refs为尚未发完的客户端数，为0时才能重新写入
+typedef struct
+{
+    char data[WS_FEED_FRAME_SIZE];
+    size_t len;
+    uint32_t refs;
+} ws_frame_t;
+
+typedef struct
+{
+    int fd;                     // -1表示空闲
+    bool busy;                  // 已排入发送，尚未完成
+    uint8_t backoff;            // 每2^backoff帧发送一帧，发送缓冲满时加一，发送成功时减一
+    uint8_t skip;               // 距下次发送还要跳过的帧数
+} ws_client_t;
+
+static httpd_handle_t feed_server = NULL;
+static portMUX_TYPE feed_lock = portMUX_INITIALIZER_UNLOCKED;
+static ws_client_t clients[WS_FEED_MAX_CLIENTS];
+static ws_frame_t frames[2];    // 双缓冲，慢客户端还在发旧帧时新帧写入另一块
+static ws_feed_stats_t stats;
+
+static const char live_page[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>TallNeck</title></head>"
+    "<body style=\"font-family:monospace\"><pre id=\"s\">connecting...</pre><script>"
+    "var ws=new WebSocket('ws://'+location.host+'" WS_FEED_URI "');"
+    "ws.onmessage=function(e){var d=JSON.parse(e.data);document.getElementById('s').textContent="
+    "d.name+' ('+d.catnr+')\\nazi '+d.azi+'  ele '+d.ele+'\\nrange '+d.range+' km  rate '+d.range_rate+' km/s'"
+    "+'\\nlat '+d.lat+'  lon '+d.lon+'  alt '+d.alt+' km'+(d.eclipsed?'  eclipsed':'')"
+    "+'\\nrotator '+d.rot_azi+' / '+d.rot_ele;};"
+    "ws.onclose=function(){document.getElementById('s').textContent='disconnected';};"
+    "</script></body></html>";
+
+// 发送缓冲有空间时返回true，不等待。所有客户端共用HTTP服务器任务，阻塞的发送会拖慢其他客户端
+static bool ws_writable(int fd)
+{
+    fd_set wfds;
+    struct timeval tv = { 0 };
+
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+/**
+ * @brief   在HTTP服务器任务中发送一帧，arg为客户端序号和帧缓冲序号，不分配内存。
+ *          发送缓冲已满时不发送并降低该客户端的帧率，网络恢复后逐步回到全速
+ */
+static void ws_send_work(void *arg)
+{
+    uintptr_t v = (uintptr_t)arg;
+    ws_client_t *client = &clients[v >> 1];
+    ws_frame_t *frame = &frames[v & 1];
+    httpd_ws_frame_t pkt =
+    {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)frame->data,
+        .len = frame->len,
+    };
+    esp_err_t err = ESP_FAIL;
+    bool backed_up = false;
+
+    if (client->fd >= 0 && httpd_ws_get_fd_info(feed_server, client->fd) == HTTPD_WS_CLIENT_WEBSOCKET)
+    {
+        backed_up = !ws_writable(client->fd);
+        if (!backed_up)
+        {
+            err = httpd_ws_send_frame_async(feed_server, client->fd, &pkt);
+        }
+    }
+
+    taskENTER_CRITICAL(&feed_lock);
+    frame->refs--;
+    client->busy = false;
+    if (backed_up)
+    {
+        if (client->backoff < WS_FEED_MAX_BACKOFF)
+        {
+            client->backoff++;
+        }
+        stats.dropped++;
+    }
+    else if (err == ESP_OK)
+    {
+        if (client->backoff > 0)
+        {
+            client->backoff--;
+        }
+        stats.sent++;
+    }
+    else if (client->fd >= 0)
+    {
+        // 连接已关闭但还没收到关闭回调，释放客户端位置
+        client->fd = -1;
+        stats.clients--;
+    }
+    client->skip = (1 << client->backoff) - 1;
+    taskEXIT_CRITICAL(&feed_lock);
+}
+
+// 写入JSON字符串，转义引号和反斜杠
+static size_t json_str(char *buf, size_t size, const char *s)
+{
+    size_t n = 0;
+    for (; *s != '\0' && n + 2 < size; s++)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            buf[n++] = '\\';
+        }
+        buf[n++] = (unsigned char)*s < 0x20 ? ' ' : *s;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+static void ws_serialize(ws_frame_t *frame, const track_state_t *state, const char *name)
+{
+    char escaped[SAT_NMAE_LENGTH];
+    rot_setpoint_t sp;
+    bool has_rot = setpoint_last(&sp);
+
+    json_str(escaped, sizeof(escaped), name);
+    int n = snprintf(frame->data, sizeof(frame->data),
+                     "{\"seq\":%lu,\"time_ms\":%lld,\"catnr\":%ld,\"name\":\"%s\","
+                     "\"azi\":%.2f,\"ele\":%.2f,\"range\":%.1f,\"range_rate\":%.3f,"
+                     "\"lat\":%.3f,\"lon\":%.3f,\"alt\":%.1f,\"eclipsed\":%s,\"in_pass\":%s,",
+                     (unsigned long)state->generation, state->time_ms, (long)state->catnr, escaped,
+                     state->azi, state->ele, state->range, state->range_rate,
+                     state->lat, state->lon, state->alt,
+                     (state->flags & STATE_FLAG_ECLIPSED) ? "true" : "false",
+                     (state->flags & STATE_FLAG_IN_PASS) ? "true" : "false");
+    if (n > 0 && n < (int)sizeof(frame->data))
+    {
+        n += snprintf(frame->data + n, sizeof(frame->data) - n,
+                      has_rot ? "\"rot_azi\":%.2f,\"rot_ele\":%.2f}" : "\"rot_azi\":null,\"rot_ele\":null}",
+                      sp.azimuth, sp.elevation);
+    }
+    frame->len = n < (int)sizeof(frame->data) ? n : sizeof(frame->data) - 1;
+}
+
+/**
+ * @brief   状态总线有新数据时序列化一次，排入每个空闲客户端的发送。
+ *          客户端上一帧还没发完时跳过这一帧，慢客户端只会收到较稀疏的最新帧，不会积压
+ */
+static void ws_feed_task(void *pvParameters)
+{
+    track_state_t state;
+    char name[SAT_NMAE_LENGTH] = "";
+    uint32_t last_generation = 0;
+    uint32_t target = 0;
+
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(WS_FEED_POLL_MS));
+        if (stats.clients == 0 || state_bus_generation() == last_generation || !state_bus_read(&state))
+        {
+            continue;
+        }
+        last_generation = state.generation;
+        if (state.target != target)
+        {
+            target = state.target;
+            state_bus_read_target(name, sizeof(name));
+        }
+
+        int idx;
+        taskENTER_CRITICAL(&feed_lock);
+        idx = frames[0].refs == 0 ? 0 : (frames[1].refs == 0 ? 1 : -1);
+        taskEXIT_CRITICAL(&feed_lock);
+        if (idx < 0)
+        {
+            continue;  // 两块缓冲都在发送中，所有客户端都慢，这一帧整体跳过
+        }
+        ws_serialize(&frames[idx], &state, name);
+        stats.frames++;
+
+        for (int i = 0; i < WS_FEED_MAX_CLIENTS; i++)
+        {
+            bool queue = false;
+            taskENTER_CRITICAL(&feed_lock);
+            if (clients[i].fd >= 0)
+            {
+                if (clients[i].busy || clients[i].skip > 0)
+                {
+                    if (clients[i].skip > 0)
+                    {
+                        clients[i].skip--;
+                    }
+                    stats.dropped++;
+                }
+                else
+                {
+                    clients[i].busy = true;
+                    frames[idx].refs++;
+                    queue = true;
+                }
+            }
+            taskEXIT_CRITICAL(&feed_lock);
+
+            if (queue && httpd_queue_work(feed_server, ws_send_work, (void *)(uintptr_t)(i << 1 | idx)) != ESP_OK)
+            {
+                taskENTER_CRITICAL(&feed_lock);
+                clients[i].busy = false;
+                frames[idx].refs--;
+                stats.dropped++;
+                taskEXIT_CRITICAL(&feed_lock);
+            }
+        }
+    }
+}
+
+/**
+ * @brief   握手完成后登记客户端；之后浏览器发来的数据帧读出丢弃
+ */
+static esp_err_t ws_feed_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET)
+    {
+        int fd = httpd_req_to_sockfd(req);
+        int slot = -1;
+        taskENTER_CRITICAL(&feed_lock);
+        // 同一fd已登记时沿用原位置，避免重复推送
+        for (int i = 0; i < WS_FEED_MAX_CLIENTS && slot < 0; i++)
+        {
+            if (clients[i].fd == fd)
+            {
+                slot = i;
+            }
+        }
+        for (int i = 0; i < WS_FEED_MAX_CLIENTS && slot < 0; i++)
+        {
+            if (clients[i].fd < 0 && !clients[i].busy)
+            {
+                slot = i;
+                clients[i].fd = fd;
+                stats.clients++;
+            }
+        }
+        if (slot >= 0)
+        {
+            clients[slot].backoff = 0;
+            clients[slot].skip = 0;
+        }
+        taskEXIT_CRITICAL(&feed_lock);
+        if (slot < 0)
+        {
+            ESP_LOGW(TAG, "Too many clients, fd %d refused", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Client fd %d subscribed", fd);
+        return ESP_OK;
+    }
+
+    uint8_t buf[32];
+    httpd_ws_frame_t pkt = {0};
+    esp_err_t err = httpd_ws_recv_frame(req, &pkt, 0);
+    if (err != ESP_OK || pkt.len == 0)
+    {
+        return err;
+    }
+    if (pkt.len > sizeof(buf))
+    {
+        return ESP_FAIL;
+    }
+    pkt.payload = buf;
+    return httpd_ws_recv_frame(req, &pkt, pkt.len);
+}
+
+void ws_feed_on_close(httpd_handle_t hd, int sockfd)
+{
+    taskENTER_CRITICAL(&feed_lock);
+    for (int i = 0; i < WS_FEED_MAX_CLIENTS; i++)
+    {
+        // 排队中的发送仍持有位置，busy清除前不会被新客户端占用
+        if (clients[i].fd == sockfd)
+        {
+            clients[i].fd = -1;
+            stats.clients--;
+        }
+    }
+    taskEXIT_CRITICAL(&feed_lock);
+    close(sockfd);
+}
+
+static esp_err_t live_page_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, live_page, sizeof(live_page) - 1);
+}
+
+static const httpd_uri_t ws_feed_uri =
+{
+    .uri = WS_FEED_URI,
+    .method = HTTP_GET,
+    .handler = ws_feed_handler,
+    .user_ctx = NULL,
+    .is_websocket = true,
+};
+
+static const httpd_uri_t live_page_uri =
+{
+    .uri = WS_FEED_PAGE_URI,
+    .method = HTTP_GET,
+    .handler = live_page_handler,
+    .user_ctx = NULL,
+};
+
+esp_err_t ws_feed_start(httpd_handle_t server)
+{
+    static TaskHandle_t feed_task = NULL;
+
+    taskENTER_CRITICAL(&feed_lock);
+    feed_server = server;
+    for (int i = 0; i < WS_FEED_MAX_CLIENTS; i++)
+    {
+        if (!clients[i].busy)
+        {
+            clients[i].fd = -1;
+        }
+    }
+    stats.clients = 0;
+    taskEXIT_CRITICAL(&feed_lock);
+
+    httpd_register_uri_handler(server, &ws_feed_uri);
+    httpd_register_uri_handler(server, &live_page_uri);
+    if (feed_task == NULL &&
+        xTaskCreatePinnedToCore(ws_feed_task, "ws_feed", 4096, NULL, 3, &feed_task, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create feed task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#else
+
+void ws_feed_on_close(httpd_handle_t hd, int sockfd)
+{
+    close(sockfd);
+}
+
+esp_err_t ws_feed_start(httpd_handle_t server)
+{
+    ESP_LOGW(TAG, "CONFIG_HTTPD_WS_SUPPORT is disabled, live feed not available");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
+
+void ws_feed_get_stats(ws_feed_stats_t *out)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    taskENTER_CRITICAL(&feed_lock);
+    *out = stats;
+    taskEXIT_CRITICAL(&feed_lock);
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Asset Image Builder
+Packs read-only data (factory TLE catalog, transponder database, LVGL
+binary images, fonts, lookup tables) into the image flashed to the
+"assets" partition. The firmware maps the partition with
+esp_partition_mmap and uses the entries in place, without copying them
+to the heap.
+
+Image layout (little endian), see main/include/assets.h:
+    header  : magic "TNAS", version u16, count u16, total_size u32
+    entries : name[24], offset u32, size u32
+    data    : each entry aligned to 16 bytes
+
+Examples:
+    python mkassets.py -o build/assets.bin tle_eph.txt=littlefsflash/tle_eph.txt
+    python mkassets.py -o build/assets.bin --dir assets \\
+        --trsp-json transmitters.json --modes-json modes.json
+    parttool.py write_partition --partition-name assets --input build/assets.bin
+"""
+
+import os
+import sys
+import json
+import struct
+import argparse
+import re
+
+ASSETS_MAGIC = 0x53414E54       # "TNAS"
+ASSETS_VERSION = 1
+ASSETS_NAME_LEN = 24
+ASSETS_ALIGN = 16
+ASSETS_PARTITION_SIZE = 0x400000
+
+HEADER = struct.Struct('<IHHI')
+ENTRY = struct.Struct('<%dsII' % ASSETS_NAME_LEN)
+
+# main/include/trsp_db.h
+TRSP_DB_NAME = 'transponders.db'
+TRSP_DB_MAGIC = 0x42445254      # "TRDB"
+TRSP_DB_VERSION = 1
+TRSP_DB_HEADER = struct.Struct('<IHHIIIIII')
+TRSP_DB_INDEX = struct.Struct('<iIHH')
+TRSP_DB_RECORD = struct.Struct('<iIIqqqqfBBH')
+# struct transponder的字段长度，超出部分与设备上一样截断
+TRSP_DESCRIPTION_LEN = 80
+TRSP_MODE_LEN = 20
+
+# 出厂TLE目录，按main/src/catalog_mirror.c的catalog_validate规则检查
+TLE_CATALOG_NAME = 'tle_eph.txt'
+TLE_STAMP = re.compile(r'^\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2}$')
+
+
+def truncate(text, size):
+    return (text or '').encode('utf-8')[:size - 1]
+
+
+def int_field(value):
+    return int(value) if isinstance(value, (int, float)) and not isinstance(value, bool) else 0
+
+
+def build_trsp_db(transmitters_path, modes_path=None):
+    """Build a transponders.db identical to what trsp_db_writer produces."""
+    modes = {}
+    if modes_path:
+        with open(modes_path, 'r', encoding='utf-8') as f:
+            for mode in json.load(f):
+                modes[mode.get('id')] = mode.get('name') or ''
+
+    with open(transmitters_path, 'r', encoding='utf-8') as f:
+        transmitters = json.load(f)
+
+    strings = bytearray(b'\0')     # 偏移0保留给空字符串
+    interned = {b'': 0}
+
+    def intern(data):
+        if data not in interned:
+            interned[data] = len(strings)
+            strings.extend(data + b'\0')
+        return interned[data]
+
+    records = []
+    for t in transmitters:
+        mode = t.get('mode')
+        if not mode:
+            mode_id = t.get('mode_id')
+            mode = modes.get(mode_id, str(mode_id if mode_id is not None else -1))
+        catnr = int_field(t.get('norad_cat_id'))
+        baud = t.get('baud')
+        records.append((catnr, TRSP_DB_RECORD.pack(
+            catnr,
+            intern(truncate(t.get('description'), TRSP_DESCRIPTION_LEN)),
+            intern(truncate(mode, TRSP_MODE_LEN)),
+            int_field(t.get('uplink_low')), int_field(t.get('uplink_high')),
+            int_field(t.get('downlink_low')), int_field(t.get('downlink_high')),
+            float(baud) if isinstance(baud, (int, float)) else 0.0,
+            1 if t.get('invert') is True else 0,
+            1 if t.get('alive') is True else 0,
+            0)))
+
+    # 稳定排序，同一卫星保持到达顺序
+    records.sort(key=lambda r: r[0])
+    index = []
+    for i, (catnr, _) in enumerate(records):
+        if index and index[-1][0] == catnr:
+            index[-1][2] += 1
+        else:
+            index.append([catnr, i, 1])
+
+    index_offset = TRSP_DB_HEADER.size
+    record_offset = index_offset + len(index) * TRSP_DB_INDEX.size
+    strtab_offset = record_offset + len(records) * TRSP_DB_RECORD.size
+    out = bytearray(TRSP_DB_HEADER.pack(
+        TRSP_DB_MAGIC, TRSP_DB_VERSION, TRSP_DB_RECORD.size,
+        len(index), len(records), len(strings),
+        index_offset, record_offset, strtab_offset))
+    for catnr, first, count in index:
+        out += TRSP_DB_INDEX.pack(catnr, first, count, 0)
+    for _, rec in records:
+        out += rec
+    out += strings
+    print("%s: %d transponders of %d satellites, %d bytes" %
+          (TRSP_DB_NAME, len(records), len(index), len(out)))
+    return bytes(out)
+
+
+def tle_checksum_good(line):
+    checksum = sum(int(c) if c.isdigit() else 1 if c == '-' else 0 for c in line[:68])
+    return line[68:69] == str(checksum % 10)
+
+
+def tle_good_elements(line1, line2):
+    # 与sgp_in.c的Good_Elements相同的检查
+    if len(line1) < 69 or len(line2) < 69:
+        return False
+    if not tle_checksum_good(line1) or not tle_checksum_good(line2):
+        return False
+    if line1[0] != '1' or line2[0] != '2' or line1[2:7] != line2[2:7]:
+        return False
+    return (line1[23] == '.' and line1[34] == '.' and line2[11] == '.' and line2[20] == '.' and
+            line2[37] == '.' and line2[46] == '.' and line2[54] == '.' and line1[61:64] == ' 0 ')
+
+
+def check_tle_catalog(blob):
+    """Returns the number of TLE sets, exits when the device would reject the catalog"""
+    lines, count = [], 0
+    for line_no, raw in enumerate(blob.decode('ascii', 'replace').splitlines(), 1):
+        line = raw.rstrip('\r')
+        if not line or (not lines and TLE_STAMP.match(line)):
+            continue
+        lines.append(line)
+        if len(lines) < 3:
+            continue
+        if not tle_good_elements(lines[1], lines[2]):
+            sys.exit("Invalid TLE set ending at line %d of %s" % (line_no, TLE_CATALOG_NAME))
+        lines, count = [], count + 1
+    if lines or count == 0:
+        sys.exit("Truncated or empty TLE catalog %s" % TLE_CATALOG_NAME)
+    return count
+
+
+def build_image(entries):
+    def align(n):
+        return (n + ASSETS_ALIGN - 1) & ~(ASSETS_ALIGN - 1)
+
+    body = bytearray(HEADER.size + len(entries) * ENTRY.size)
+    table = bytearray()
+    for name, blob in entries:
+        # 对齐填充用0xff，与擦除后的flash一致
+        body += b'\xff' * (align(len(body)) - len(body))
+        table += ENTRY.pack(name.encode('utf-8'), len(body), len(blob))
+        body += blob
+    body[:HEADER.size] = HEADER.pack(ASSETS_MAGIC, ASSETS_VERSION, len(entries), len(body))
+    body[HEADER.size:HEADER.size + len(table)] = table
+    return bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build the TallNeck asset partition image')
+    parser.add_argument('-o', '--output', required=True, help='Output image path')
+    parser.add_argument('--dir', help='Add every file of this directory, named after the file')
+    parser.add_argument('--trsp-json', help='SatNOGS transmitters JSON to convert into %s' % TRSP_DB_NAME)
+    parser.add_argument('--modes-json', help='SatNOGS modes JSON used to resolve mode_id')
+    parser.add_argument('--size', type=lambda v: int(v, 0), default=ASSETS_PARTITION_SIZE,
+                        help='Partition size (default 0x%x)' % ASSETS_PARTITION_SIZE)
+    parser.add_argument('files', nargs='*', help='NAME=PATH or PATH')
+    args = parser.parse_args()
+
+    sources = []
+    if args.dir and os.path.isdir(args.dir):
+        for name in sorted(os.listdir(args.dir)):
+            path = os.path.join(args.dir, name)
+            if os.path.isfile(path) and not name.startswith('.'):
+                sources.append((name, path))
+    for spec in args.files:
+        name, sep, path = spec.partition('=')
+        sources.append((name, path) if sep else (os.path.basename(spec), spec))
+
+    entries = []
+    for name, path in sources:
+        with open(path, 'rb') as f:
+            entries.append((name, f.read()))
+    if args.trsp_json:
+        entries.append((TRSP_DB_NAME, build_trsp_db(args.trsp_json, args.modes_json)))
+
+    names = set()
+    for name, _ in entries:
+        if len(name.encode('utf-8')) >= ASSETS_NAME_LEN:
+            sys.exit("Asset name too long (max %d bytes): %s" % (ASSETS_NAME_LEN - 1, name))
+        if name in names:
+            sys.exit("Duplicate asset name: %s" % name)
+        names.add(name)
+    for name, blob in entries:
+        if name == TLE_CATALOG_NAME:
+            print("%s: %d TLE sets" % (name, check_tle_catalog(blob)))
+
+    image = build_image(entries)
+    if len(image) > args.size:
+        sys.exit("Asset image is %d bytes, partition holds %d" % (len(image), args.size))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    for name, blob in entries:
+        print("  %-24s %8d bytes" % (name, len(blob)))
+    print("Wrote %s: %d assets, %d of %d bytes" % (args.output, len(entries), len(image), args.size))
+
+
+if __name__ == '__main__':
+    main()
@@ -2,23 +2,35 @@
 # SPDX-License-Identifier: Apache-2.0
 
 import logging
+import socket
 import time
 
 import pytest
 from common_test_methods import get_env_config_variable, get_my_interface_by_dest_ip
 from pytest_embedded import Dut
 
-try:
-    from run_tcp_client import tcp_client
-except ImportError:
-    import os
-    import sys
-    sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'scripts')))
-    from run_tcp_client import tcp_client
+# 不需要硬件的测试见host/：rotctld_host + rotctld_loadgen
 
 
-PORT = 3333
-MESSAGE = 'Data to ESP'
+def rotctld_exchange(host: str, port: int) -> None:
+    """Set a position, read it back and check the rotctld replies."""
+    family = socket.AF_INET6 if ':' in host else socket.AF_INET
+    with socket.socket(family, socket.SOCK_STREAM) as s:
+        s.settimeout(5)
+        s.connect(socket.getaddrinfo(host, port, family, socket.SOCK_STREAM)[0][4])
+        f = s.makefile('rw', newline='\n')
+        f.write('P 180.00 45.00\n')
+        f.flush()
+        reply = f.readline().strip()
+        if reply != 'RPRT 0':
+            raise AssertionError(f'set_pos replied {reply!r}')
+        f.write('p\n')
+        f.flush()
+        az, el = float(f.readline()), float(f.readline())
+        if abs(az - 180.0) > 0.01 or abs(el - 45.0) > 0.01:
+            raise AssertionError(f'get_pos replied {az} {el}')
+        f.write('q\n')
+        f.flush()
 
 
 @pytest.mark.esp32
@@ -39,10 +51,7 @@ def test_examples_tcp_server_ipv4(dut: Dut) -> None:
     time.sleep(1)
 
     # test IPv4
-    received = tcp_client(ipv4, PORT, MESSAGE)
-    if not received == MESSAGE:
-        raise
-    dut.expect(MESSAGE)
+    rotctld_exchange(ipv4, int(dut.app.sdkconfig.get('EXAMPLE_PORT')))
 
 
 @pytest.mark.esp32
@@ -67,7 +76,4 @@ def test_examples_tcp_server_ipv6(dut: Dut) -> None:
 
     interface = get_my_interface_by_dest_ip(ipv4)
     # test IPv6
-    received = tcp_client('{}%{}'.format(ipv6, interface), PORT, MESSAGE)
-    if not received == MESSAGE:
-        raise
-    dut.expect(MESSAGE)
+    rotctld_exchange('{}%{}'.format(ipv6, interface), int(dut.app.sdkconfig.get('EXAMPLE_PORT')))
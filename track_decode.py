@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Tracking Recording Decoder
+Converts the pointing telemetry written by the firmware's track recorder
+(/littlefs/rec/track*.bin, see main/include/track_recorder.h) into CSV.
+
+Each file is a sequence of blocks: a 16-byte header followed by records of
+zigzag varints. The first record of a block is absolute, the following ones
+are deltas from the previous record.
+
+Examples:
+    python track_decode.py track.bin > pass.csv
+    python track_decode.py track.3.bin track.2.bin track.1.bin track.bin -o all.csv
+"""
+
+import sys
+import csv
+import struct
+import argparse
+from datetime import datetime, timezone
+
+TRACK_REC_MAGIC = 0x5254
+TRACK_REC_VERSION = 1
+BLOCK_HEADER = struct.Struct('<HBBHHiI')
+
+COLUMNS = ['time_utc', 'catnr', 'azi_cmd', 'ele_cmd', 'azi', 'ele', 'range_rate_kms', 'rot_state']
+# 定点数比例：时间ms，角度0.01度，距离变化率m/s
+SCALES = [1, 100, 100, 100, 100, 1000, 1]
+ROT_STATES = {0: 'idle', 1: 'tracking'}
+
+
+def read_varint(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("truncated record")
+        b = data[pos]
+        pos += 1
+        result |= (b & 0x7f) << shift
+        if b < 0x80:
+            break
+        shift += 7
+    return (result >> 1) ^ -(result & 1), pos
+
+
+def decode_blocks(data, name):
+    pos = 0
+    while pos + BLOCK_HEADER.size <= len(data):
+        magic, version, fields, count, length, catnr, _ = BLOCK_HEADER.unpack_from(data, pos)
+        if magic != TRACK_REC_MAGIC or version != TRACK_REC_VERSION:
+            sys.stderr.write("%s: bad block header at offset %d, stopping\n" % (name, pos))
+            return
+        payload = data[pos + BLOCK_HEADER.size:pos + BLOCK_HEADER.size + length]
+        pos += BLOCK_HEADER.size + length
+        if len(payload) != length:
+            sys.stderr.write("%s: truncated block at the end\n" % name)
+            return
+
+        values = [0] * fields
+        p = 0
+        for _ in range(count):
+            for i in range(fields):
+                delta, p = read_varint(payload, p)
+                values[i] += delta
+            yield catnr, list(values)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode TallNeck tracking recordings to CSV')
+    parser.add_argument('files', nargs='+', help='Recording files, oldest first')
+    parser.add_argument('-o', '--output', help='Output CSV (default stdout)')
+    args = parser.parse_args()
+
+    out = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow(COLUMNS)
+    rows = 0
+    for path in args.files:
+        with open(path, 'rb') as f:
+            data = f.read()
+        for catnr, values in decode_blocks(data, path):
+            t = datetime.fromtimestamp(values[0] / 1000.0, tz=timezone.utc)
+            scaled = [values[i] / SCALES[i] for i in range(1, 6)]
+            writer.writerow([t.strftime('%Y-%m-%d %H:%M:%S.%f')[:-3], catnr] +
+                            ['%.2f' % v for v in scaled[:4]] + ['%.3f' % scaled[4]] +
+                            [ROT_STATES.get(values[6], values[6])])
+            rows += 1
+    if args.output:
+        out.close()
+    sys.stderr.write("%d records\n" % rows)
+
+
+if __name__ == '__main__':
+    main()
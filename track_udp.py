@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""
+Tracking State Stream Receiver
+Listens for the binary state packets sent by the firmware's UDP stream
+(CONFIG_TALLNECK_UDP_STREAM, see main/include/udp_stream.h) and prints them
+as text or CSV. Any number of receivers can join the multicast group.
+
+Packet layout (little endian, 56 bytes):
+    magic u16 "TN", version u8, flags u8, seq u32, time_ms i64, catnr i32,
+    azi, ele, range, range_rate, lat, lon, alt, rot_azi, rot_ele : f32
+
+Examples:
+    python track_udp.py
+    python track_udp.py --group 239.255.45.33 --port 4534 --csv > stream.csv
+    python track_udp.py --group '' --port 4534      # unicast to this host
+"""
+
+import sys
+import csv
+import socket
+import struct
+import argparse
+from datetime import datetime, timezone
+
+UDP_STREAM_MAGIC = 0x4E54
+UDP_STREAM_VERSION = 1
+PACKET = struct.Struct('<HBBIqi9f')
+
+FLAG_TRACKING = 0x01
+FLAG_ECLIPSED = 0x02
+FLAG_DEEP_SPACE = 0x04
+FLAG_IN_PASS = 0x08
+FLAG_ROTATOR = 0x10
+
+COLUMNS = ['seq', 'time_utc', 'catnr', 'azi', 'ele', 'range_km', 'range_rate_kms',
+           'lat', 'lon', 'alt_km', 'eclipsed', 'in_pass', 'rot_azi', 'rot_ele']
+
+
+def decode(data):
+    """Return a dict for a valid packet, None otherwise."""
+    if len(data) != PACKET.size:
+        return None
+    (magic, version, flags, seq, time_ms, catnr,
+     azi, ele, rng, rate, lat, lon, alt, rot_azi, rot_ele) = PACKET.unpack(data)
+    if magic != UDP_STREAM_MAGIC or version != UDP_STREAM_VERSION:
+        return None
+    return {
+        'seq': seq,
+        'time': datetime.fromtimestamp(time_ms / 1000.0, tz=timezone.utc),
+        'tracking': bool(flags & FLAG_TRACKING),
+        'catnr': catnr,
+        'azi': azi, 'ele': ele, 'range': rng, 'range_rate': rate,
+        'lat': lat, 'lon': lon, 'alt': alt,
+        'eclipsed': bool(flags & FLAG_ECLIPSED),
+        'deep_space': bool(flags & FLAG_DEEP_SPACE),
+        'in_pass': bool(flags & FLAG_IN_PASS),
+        'rotator': bool(flags & FLAG_ROTATOR),
+        'rot_azi': rot_azi, 'rot_ele': rot_ele,
+    }
+
+
+def open_socket(group, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('', port))
+    if group:
+        mreq = struct.pack('4s4s', socket.inet_aton(group), socket.inet_aton('0.0.0.0'))
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return sock
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Receive the TallNeck UDP state stream')
+    parser.add_argument('--group', default='239.255.45.33', help="Multicast group to join, '' for unicast")
+    parser.add_argument('--port', type=int, default=4534)
+    parser.add_argument('--csv', action='store_true', help='Write CSV to stdout')
+    args = parser.parse_args()
+
+    sock = open_socket(args.group, args.port)
+    writer = csv.writer(sys.stdout) if args.csv else None
+    if writer:
+        writer.writerow(COLUMNS)
+    last_seq = {}
+    lost = 0
+    try:
+        while True:
+            data, addr = sock.recvfrom(512)
+            p = decode(data)
+            if p is None:
+                continue
+            # 按发送方统计序号跳变
+            prev = last_seq.get(addr[0])
+            if prev is not None and p['seq'] > prev + 1:
+                lost += p['seq'] - prev - 1
+            last_seq[addr[0]] = p['seq']
+
+            t = p['time'].strftime('%Y-%m-%d %H:%M:%S.%f')[:-3]
+            rot = ('%.2f' % p['rot_azi'], '%.2f' % p['rot_ele']) if p['rotator'] else ('', '')
+            if writer:
+                if p['tracking']:
+                    writer.writerow([p['seq'], t, p['catnr'], '%.2f' % p['azi'], '%.2f' % p['ele'],
+                                     '%.1f' % p['range'], '%.3f' % p['range_rate'], '%.3f' % p['lat'],
+                                     '%.3f' % p['lon'], '%.1f' % p['alt'], int(p['eclipsed']),
+                                     int(p['in_pass'])] + list(rot))
+                sys.stdout.flush()
+            elif p['tracking']:
+                print("#%u %s %d azi %6.2f ele %6.2f range %8.1f km rate %6.3f km/s%s rot %s/%s lost %d" %
+                      (p['seq'], t, p['catnr'], p['azi'], p['ele'], p['range'], p['range_rate'],
+                       ' eclipsed' if p['eclipsed'] else '', rot[0] or '-', rot[1] or '-', lost))
+            else:
+                print("#%u %s not tracking, rot %s/%s" % (p['seq'], t, rot[0] or '-', rot[1] or '-'))
+    except KeyboardInterrupt:
+        pass
+    sys.stderr.write("%d packets lost\n" % lost)
+
+
+if __name__ == '__main__':
+    main()
@@ -5,17 +5,27 @@
 TLE Update Script
 This script downloads TLE data from Celestrak every 48 hours
 and saves it to the littlefsflash/tle_eph file.
+
+With --mirror it also keeps a versioned copy of the TLE and SatNOGS
+transponder catalog and serves it to the devices on the LAN over plain
+HTTP, so a fleet refresh costs one upstream fetch.
 """
 
 import os
 import sys
+import gzip
+import json
 import time
+import hashlib
 import logging
+import threading
 import requests
 import schedule
 import argparse
 from datetime import datetime
 from pathlib import Path
+from functools import partial
+from http.server import ThreadingHTTPServer, SimpleHTTPRequestHandler
 
 # Configure logging
 logging.basicConfig(
@@ -30,9 +40,20 @@ logger = logging.getLogger("TLE_Updater")
 
 # Constants
 TLE_URL = "https://celestrak.org/NORAD/elements/gp.php?GROUP=amateur&FORMAT=tle"
+TLE_GROUP_URLS = [
+    TLE_URL,
+    "https://celestrak.org/NORAD/elements/gp.php?GROUP=weather&FORMAT=tle",
+    "https://celestrak.org/NORAD/elements/gp.php?GROUP=cubesat&FORMAT=tle",
+]
+TRSP_URL = "https://db.satnogs.org/api/transmitters/?format=json"
 OUTPUT_FILE = "littlefsflash/tle_eph.txt"
 UPDATE_INTERVAL_HOURS = 48
 
+# LAN mirror
+MIRROR_DIR = "mirror"
+MIRROR_PORT = 8080
+MIRROR_KEEP_VERSIONS = 8   # deltas are published from this many previous versions
+
 def download_tle():
     """Download TLE data from Celestrak and save it to the output file."""
     try:
@@ -58,20 +79,218 @@ def download_tle():
         logger.error(f"Error downloading TLE data: {e}")
         return False
 
+def parse_tle_records(text):
+    """Split TLE text into {catnr: (name, line1, line2)}."""
+    records = {}
+    lines = [line.rstrip() for line in text.splitlines() if line.strip()]
+    i = 0
+    while i + 2 < len(lines):
+        name, line1, line2 = lines[i], lines[i + 1], lines[i + 2]
+        if line1.startswith("1 ") and line2.startswith("2 ") and line1[2:7].strip().isdigit():
+            records[int(line1[2:7])] = (name, line1, line2)
+            i += 3
+        else:
+            i += 1
+    return records
+
+
+def format_tle_records(records):
+    return "".join(f"{n}\n{l1}\n{l2}\n" for n, l1, l2 in
+                   (records[k] for k in sorted(records)))
+
+
+class CatalogMirror:
+    """Versioned TLE/transponder catalog with precomputed gzip packages.
+
+    Layout under the mirror directory:
+        manifest.json               latest version and package paths
+        full/<ver>.tle.gz           complete TLE catalog
+        full/<ver>.trsp.json.gz     complete SatNOGS transmitter list
+        delta/<from>-<ver>.tle.gz   changes since an older version:
+                                    "-<catnr>" lines remove a satellite,
+                                    3-line TLE sets add or replace one
+    """
+
+    def __init__(self, root):
+        self.root = Path(root)
+        (self.root / "full").mkdir(parents=True, exist_ok=True)
+        (self.root / "delta").mkdir(parents=True, exist_ok=True)
+        self.state_file = self.root / "state.json"
+        self.lock = threading.Lock()
+        if self.state_file.exists():
+            self.state = json.loads(self.state_file.read_text())
+        else:
+            self.state = {"version": 0, "tle_sha256": "", "trsp_sha256": "", "history": []}
+
+    @staticmethod
+    def _write_gz(path, data):
+        tmp = path.with_suffix(path.suffix + ".tmp")
+        with gzip.open(tmp, "wb", compresslevel=9) as f:
+            f.write(data)
+        os.replace(tmp, path)
+
+    def _load_full_tle(self, version):
+        path = self.root / "full" / f"{version}.tle.gz"
+        if not path.exists():
+            return None
+        with gzip.open(path, "rt") as f:
+            return parse_tle_records(f.read())
+
+    def publish(self, tle_text, trsp_json):
+        """Publish a new catalog version if anything changed upstream."""
+        records = parse_tle_records(tle_text)
+        tle_data = format_tle_records(records).encode()
+        tle_sha = hashlib.sha256(tle_data).hexdigest()
+        trsp_sha = hashlib.sha256(trsp_json).hexdigest() if trsp_json else self.state["trsp_sha256"]
+
+        with self.lock:
+            if tle_sha == self.state["tle_sha256"] and trsp_sha == self.state["trsp_sha256"]:
+                logger.info(f"Mirror catalog unchanged at version {self.state['version']}")
+                return self.state["version"]
+
+            old_version = self.state["version"]
+            version = old_version + 1
+            self._write_gz(self.root / "full" / f"{version}.tle.gz", tle_data)
+            if trsp_json:
+                self._write_gz(self.root / "full" / f"{version}.trsp.json.gz", trsp_json)
+            elif old_version:
+                # Transponder fetch failed, carry the previous list forward
+                prev = self.root / "full" / f"{old_version}.trsp.json.gz"
+                if prev.exists():
+                    os.link(prev, self.root / "full" / f"{version}.trsp.json.gz")
+
+            history = [v for v in self.state["history"] + [old_version] if v][-MIRROR_KEEP_VERSIONS:]
+            deltas = {}
+            for base in history:
+                base_records = self._load_full_tle(base)
+                if base_records is None:
+                    continue
+                lines = [f"-{catnr}\n" for catnr in sorted(set(base_records) - set(records))]
+                changed = {k: v for k, v in records.items() if base_records.get(k) != v}
+                delta = ("".join(lines) + format_tle_records(changed)).encode()
+                name = f"{base}-{version}.tle.gz"
+                self._write_gz(self.root / "delta" / name, delta)
+                deltas[str(base)] = f"/delta/{name}"
+
+            manifest = {
+                "version": version,
+                "generated": datetime.utcnow().strftime("%Y-%m-%dT%H:%M:%SZ"),
+                "tle": f"/full/{version}.tle.gz",
+                "trsp": f"/full/{version}.trsp.json.gz",
+                "tle_count": len(records),
+                "deltas": deltas,
+            }
+            tmp = self.root / "manifest.json.tmp"
+            tmp.write_text(json.dumps(manifest, indent=1))
+            os.replace(tmp, self.root / "manifest.json")
+
+            self.state.update(version=version, tle_sha256=tle_sha, trsp_sha256=trsp_sha, history=history)
+            self.state_file.write_text(json.dumps(self.state))
+            self._prune(history + [version])
+
+        logger.info(f"Mirror catalog published as version {version} "
+                    f"({len(records)} satellites, {len(deltas)} deltas)")
+        return version
+
+    def _prune(self, keep):
+        keep = {str(v) for v in keep}
+        for path in (self.root / "full").glob("*.gz"):
+            if path.name.split(".")[0] not in keep:
+                path.unlink()
+        for path in (self.root / "delta").glob("*.gz"):
+            if path.name.split(".")[0].split("-")[1] not in keep:
+                path.unlink()
+
+
+class MirrorRequestHandler(SimpleHTTPRequestHandler):
+    """Static file handler; packages are already compressed, manifest is tiny.
+
+    The .gz packages are sent as Content-Encoding: gzip so the firmware
+    inflates them on the fly with the same code path as Celestrak/SatNOGS.
+    """
+
+    def guess_type(self, path):
+        if str(path).endswith(".json.gz"):
+            return "application/json"
+        if str(path).endswith(".gz"):
+            return "text/plain"
+        return super().guess_type(path)
+
+    def end_headers(self):
+        if self.path.split("?")[0].endswith(".gz"):
+            self.send_header("Content-Encoding", "gzip")
+        self.send_header("Cache-Control", "no-cache")
+        super().end_headers()
+
+    def log_message(self, fmt, *args):
+        logger.info("mirror %s - %s", self.address_string(), fmt % args)
+
+
+def serve_mirror(root, port):
+    handler = partial(MirrorRequestHandler, directory=str(root))
+    server = ThreadingHTTPServer(("", port), handler)
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    logger.info(f"Serving LAN catalog mirror from {root} on port {port}")
+    return server
+
+
+def download_catalog():
+    """Fetch all TLE groups and the transmitter list once for the mirror."""
+    session = requests.Session()   # one TLS session for all Celestrak groups
+    texts = []
+    for url in TLE_GROUP_URLS:
+        try:
+            response = session.get(url, timeout=30)
+            response.raise_for_status()
+            texts.append(response.text)
+        except Exception as e:
+            logger.error(f"Error downloading {url}: {e}")
+    trsp = None
+    try:
+        response = session.get(TRSP_URL, timeout=60)
+        response.raise_for_status()
+        trsp = response.content
+    except Exception as e:
+        logger.error(f"Error downloading transponder data: {e}")
+    return "\n".join(texts), trsp
+
+
+def update_mirror(mirror):
+    tle_text, trsp = download_catalog()
+    if not tle_text.strip():
+        logger.error("No TLE data downloaded, mirror left at the previous version")
+        return False
+    mirror.publish(tle_text, trsp)
+    return True
+
+
 def main():
     """Main function to set up the scheduler and run the initial download."""
     parser = argparse.ArgumentParser(description='TLE Data Updater')
     parser.add_argument('--once', action='store_true', help='Run once and exit')
+    parser.add_argument('--mirror', action='store_true', help='Serve the catalog to the LAN over HTTP')
+    parser.add_argument('--mirror-dir', default=MIRROR_DIR, help='Directory for the mirror packages')
+    parser.add_argument('--port', type=int, default=MIRROR_PORT, help='HTTP port of the mirror')
     args = parser.parse_args()
     
     logger.info("Starting TLE update service")
     
     # Perform initial download
     download_tle()
+
+    mirror = None
+    if args.mirror:
+        mirror = CatalogMirror(args.mirror_dir)
+        update_mirror(mirror)
     
     if args.once:
         logger.info("Running in single-shot mode, exiting after download")
         return
+
+    if mirror is not None:
+        serve_mirror(mirror.root, args.port)
+        schedule.every(UPDATE_INTERVAL_HOURS).hours.do(update_mirror, mirror)
     
     # Schedule regular updates
     schedule.every(UPDATE_INTERVAL_HOURS).hours.do(download_tle)